@@ -0,0 +1,106 @@
+// Heap allocations per dispatched task on the in-process hot path: decode
+// the submitted task, queue it, pop it and encode the NewTask frame, then
+// decode it again as the worker does. Compares fresh buffers per message
+// with the connection arenas and per-thread encode scratch the server and
+// worker use. The database is not involved.
+//
+//   ./alloc_bench [tasks] [payload-bytes]
+#include "BufferPool.h"
+#include "MessageCodec.h"
+#include "ReadyQueue.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<uint64_t> allocations{0};
+}
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+    struct Setup {
+        bool pooled;
+        Encoding encoding;
+    };
+
+    double perTask(const std::vector<std::string>& frames, Setup setup) {
+        auto queue = ReadyQueue::create(QueueOptions());
+        PayloadArena serverArena;
+        PayloadArena workerArena;
+        PayloadArena* serverSide = setup.pooled ? &serverArena : nullptr;
+        PayloadArena* workerSide = setup.pooled ? &workerArena : nullptr;
+        size_t sink = 0;
+
+        uint64_t before = allocations.load();
+        for (const auto& frame : frames) {
+            queue->push(decodeTask(frame, setup.encoding, serverSide));
+            Task task = queue->pop();
+
+            std::string fresh;
+            std::string& out = setup.pooled ? encodeScratch() : fresh;
+            std::string_view tail = encodeTaskParts(out, task, setup.encoding);
+            sink += out.size() + tail.size();
+
+            // The worker receives the same payload bytes the client sent
+            Task received = decodeTask(frame, setup.encoding, workerSide);
+            sink += received.getData().size();
+        }
+        uint64_t used = allocations.load() - before;
+        if (sink == 0) {
+            std::puts("");
+        }
+        return static_cast<double>(used) / frames.size();
+    }
+
+    double perBatchedTask(const std::vector<Task>& tasks) {
+        SubmitBatchMessage batch{1, tasks};
+        std::string payload;
+        encodeMessage(payload, batch, Encoding::Binary);
+
+        uint64_t before = allocations.load();
+        SubmitBatchMessage decoded{};
+        decodeMessage(payload, Encoding::Binary, decoded);
+        uint64_t used = allocations.load() - before;
+        return static_cast<double>(used) / tasks.size();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc >= 2 ? std::stoi(argv[1]) : 100000;
+    size_t payloadBytes = argc >= 3 ? std::stoul(argv[2]) : 256;
+
+    std::vector<Task> tasks;
+    tasks.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        tasks.emplace_back("DataProcessing", std::string(payloadBytes, 'x'));
+    }
+
+    std::printf("%d tasks, %zu-byte payload; heap allocations per task\n", count, payloadBytes);
+    std::printf("%-24s %10s %10s\n", "path", "fresh", "pooled");
+    for (Encoding encoding : {Encoding::Binary, Encoding::Json}) {
+        std::vector<std::string> frames;
+        frames.reserve(count);
+        for (const auto& task : tasks) {
+            frames.emplace_back();
+            encodeTask(frames.back(), task, encoding);
+        }
+        std::printf("%-24s %10.2f %10.2f\n",
+                    encoding == Encoding::Binary ? "dispatch (binary)" : "dispatch (json)",
+                    perTask(frames, Setup{false, encoding}), perTask(frames, Setup{true, encoding}));
+    }
+    std::printf("%-24s %10s %10.2f\n", "submit batch (binary)", "-", perBatchedTask(tasks));
+    return 0;
+}
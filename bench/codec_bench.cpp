@@ -0,0 +1,73 @@
+// Encode/decode cost of the JSON and binary payload encodings.
+//
+//   ./codec_bench [iterations]
+#include "MessageCodec.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <Poco/UUIDGenerator.h>
+
+namespace {
+    template <class Fn>
+    double nsPerOp(int iterations, Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    }
+
+    const char* encodingName(Encoding encoding) {
+        return encoding == Encoding::Binary ? "binary" : "json";
+    }
+
+    volatile size_t sink;
+
+    template <class Message>
+    void benchMessage(const char* name, const Message& message, Encoding encoding, int iterations) {
+        std::string payload;
+        double encodeNs = nsPerOp(iterations, [&] {
+            payload.clear();
+            encodeMessage(payload, message, encoding);
+            sink = payload.size();
+        });
+        double decodeNs = nsPerOp(iterations, [&] {
+            Message decoded{};
+            decodeMessage(payload, encoding, decoded);
+            sink = sizeof(decoded);
+        });
+        std::printf("%-16s %-7s %8zu %12.1f %12.1f\n", name, encodingName(encoding), payload.size(), encodeNs, decodeNs);
+    }
+
+    void benchTask(const Task& task, Encoding encoding, int iterations) {
+        std::string payload;
+        double encodeNs = nsPerOp(iterations, [&] {
+            payload.clear();
+            encodeTask(payload, task, encoding);
+            sink = payload.size();
+        });
+        double decodeNs = nsPerOp(iterations, [&] {
+            Task decoded = decodeTask(payload, encoding);
+            sink = decoded.getData().size();
+        });
+        std::printf("%-16s %-7s %8zu %12.1f %12.1f\n", "task", encodingName(encoding), payload.size(), encodeNs, decodeNs);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc >= 2 ? std::stoi(argv[1]) : 200000;
+
+    Task task("DataProcessing", "Process customer data batch #1234");
+    task.setPriority(5);
+    Poco::UUID workerId = Poco::UUIDGenerator::defaultGenerator().createOne();
+
+    std::printf("%-16s %-7s %8s %12s %12s\n", "message", "codec", "bytes", "encode ns/op", "decode ns/op");
+    for (Encoding encoding : {Encoding::Json, Encoding::Binary}) {
+        benchTask(task, encoding, iterations);
+        benchMessage("heartbeat", HeartbeatMessage{workerId, 0.42f}, encoding, iterations);
+        benchMessage("task_completed", TaskCompletedMessage{task.getId(), workerId}, encoding, iterations);
+        benchMessage("check_status", CheckStatusMessage{task.getId()}, encoding, iterations);
+    }
+    return 0;
+}
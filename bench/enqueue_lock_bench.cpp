@@ -0,0 +1,89 @@
+// Queue mutex contention for the enqueue path, before and after moving
+// persistence out of the critical section. "locked-io" holds a queue lock
+// across a simulated database round trip (a fixed sleep) and the ReadyQueue
+// push, as enqueue used to. "split" is TaskQueue::addTask itself, on a
+// TaskQueue without a database: the change is handed to the write-behind
+// writer, which is not started, and the task is published; its figures are
+// the ready queue's own lockStats(). Runs without YugabyteDB.
+//
+//   ./enqueue_lock_bench [producers] [tasks-per-producer] [persist-us]
+#include "LockStats.h"
+#include "ReadyQueue.h"
+#include "TaskQueue.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    void simulatePersist(std::chrono::microseconds latency) {
+        std::this_thread::sleep_for(latency);
+    }
+
+    struct NoBacklog : PendingTaskCursor {
+        bool fetch(size_t, std::vector<Task>&) override { return false; }
+    };
+
+    struct Result {
+        LockStatsSnapshot stats;
+        double seconds;
+    };
+
+    template <class Enqueue>
+    Result run(int producers, int perProducer, Enqueue&& enqueue) {
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < perProducer; ++i) {
+                    enqueue(Task("bench", "payload"));
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return Result{LockStatsSnapshot{}, std::chrono::duration<double>(elapsed).count()};
+    }
+
+    void print(const char* name, const Result& result, int total) {
+        const auto& s = result.stats;
+        std::printf("%-14s %10.0f %12.1f %12.1f %12.1f\n", name, total / result.seconds,
+                    s.averageHoldNs() / 1000.0, s.maxHoldNs / 1000.0, s.averageWaitNs() / 1000.0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int producers = argc >= 2 ? std::stoi(argv[1]) : 8;
+    int perProducer = argc >= 3 ? std::stoi(argv[2]) : 2000;
+    std::chrono::microseconds persist(argc >= 4 ? std::stoi(argv[3]) : 200);
+    int total = producers * perProducer;
+
+    std::printf("%-14s %10s %12s %12s %12s\n", "path", "tasks/s", "avg hold us", "max hold us", "avg wait us");
+
+    {
+        // Before: persistence inside the critical section
+        auto queue = ReadyQueue::create(QueueOptions());
+        std::mutex mutex;
+        LockStats stats;
+        Result result = run(producers, perProducer, [&](Task task) {
+            TimedLock lock(mutex, stats);
+            simulatePersist(persist);
+            queue->push(std::move(task));
+        });
+        result.stats = stats.snapshot();
+        print("locked-io", result, total);
+    }
+
+    {
+        // After: persist first, then a short publish
+        TaskQueue queue(std::make_unique<NoBacklog>(), QueueOptions());
+        queue.waitForRecovery(std::chrono::seconds(5));
+        Result result = run(producers, perProducer, [&](Task task) { queue.addTask(task); });
+        result.stats = queue.lockStats();
+        print("split", result, total);
+    }
+    return 0;
+}
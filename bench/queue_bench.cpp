@@ -0,0 +1,54 @@
+// Throughput of the ready-queue backends: mutex + condvar priority scheduler
+// versus the lock-free MpmcRing. Half the threads produce, half consume with
+// blocking pops.
+//
+//   ./queue_bench [tasks-per-run]
+#include "ReadyQueue.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    // threads is even: threads / 2 producer-consumer pairs
+    double run(QueueBackend backend, int threads, int total) {
+        QueueOptions options;
+        options.backend = backend;
+        auto queue = ReadyQueue::create(options);
+
+        int pairs = threads / 2;
+        int perThread = total / pairs;
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < pairs; ++i) {
+            workers.emplace_back([&] {
+                for (int n = 0; n < perThread; ++n) {
+                    queue->push(Task("bench", "payload"));
+                }
+            });
+            workers.emplace_back([&] {
+                for (int n = 0; n < perThread; ++n) {
+                    queue->pop();
+                }
+            });
+        }
+        for (auto& t : workers) {
+            t.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return pairs * perThread / std::chrono::duration<double>(elapsed).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int total = argc >= 2 ? std::stoi(argv[1]) : 400000;
+
+    std::printf("%8s %16s %16s\n", "threads", "mutex ops/s", "ring ops/s");
+    for (int threads = 2; threads <= 64; threads *= 2) {
+        double mutexOps = run(QueueBackend::Mutex, threads, total);
+        double ringOps = run(QueueBackend::LockFreeRing, threads, total);
+        std::printf("%8d %16.0f %16.0f\n", threads, mutexOps, ringOps);
+    }
+    return 0;
+}
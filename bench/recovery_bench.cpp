@@ -0,0 +1,199 @@
+// Startup recovery of a large backlog: how soon the first task is
+// dispatchable and how long until all of it is loaded.
+//
+//   row-at-time  the old path: one round trip per row, every row becomes a
+//                Task with its own payload allocation, and the queue is
+//                filled only once the whole backlog is in memory.
+//   streamed     a real TaskQueue whose recovery thread reads a generated
+//                backlog through the PendingTaskCursor interface, one
+//                RECOVERY_FETCH_ROWS batch per round trip.
+//   database     with TASKQUEUE_DB set: the same rows are inserted into that
+//                database and a TaskQueue recovers them through its cursor.
+//                Use a throwaway database; the rows are left behind.
+//
+// The round trip is slept once per fetch by the generated cursor. For the
+// old path it is added per row instead of slept, which would take hours.
+// Each mode runs in a forked child so memory freed by one cannot skew the
+// next.
+//
+//   ./recovery_bench [tasks] [payload-bytes] [round-trip-us]
+#include "BufferPool.h"
+#include "DatabaseManager.h"
+#include "ReadyQueue.h"
+#include "TaskQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Poco/UUIDGenerator.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* const NAMES[] = {"DataProcessing", "ImageResizing", "ReportGeneration", "EmailDispatch"};
+
+    // One FETCH worth of rows, as the cursor's column vectors
+    struct Rows {
+        std::vector<std::string> ids, names, data;
+        std::vector<int> priorities, retryCounts;
+    };
+
+    void fetchRows(Rows& rows, size_t count, const std::string& payload) {
+        rows = Rows();
+        for (size_t i = 0; i < count; ++i) {
+            rows.ids.push_back(Poco::UUIDGenerator::defaultGenerator().createOne().toString());
+            rows.names.push_back(NAMES[i % 4]);
+            rows.data.push_back(payload);
+            rows.priorities.push_back(static_cast<int>(i % 10));
+            rows.retryCounts.push_back(0);
+        }
+    }
+
+    // Stands in for the database cursor: each fetch costs one round trip
+    // and converts its rows the way DatabaseManager's cursor does.
+    class GeneratedBacklog : public PendingTaskCursor {
+    public:
+        GeneratedBacklog(size_t count, const std::string& payload, std::chrono::microseconds roundTrip)
+            : remaining_(count)
+            , payload_(payload)
+            , roundTrip_(roundTrip) {
+        }
+
+        bool fetch(size_t maxRows, std::vector<Task>& out) override {
+            size_t n = std::min(maxRows, remaining_);
+            if (n == 0) {
+                return false;
+            }
+            std::this_thread::sleep_for(roundTrip_);
+            fetchRows(rows_, n, payload_);
+            out.reserve(out.size() + n);
+            for (size_t i = 0; i < n; ++i) {
+                Task task(Poco::UUID(rows_.ids[i]), rows_.names[i], arena_.copy(rows_.data[i]), rows_.data[i].size());
+                task.setPriority(rows_.priorities[i]);
+                task.setRetryCount(rows_.retryCounts[i]);
+                out.push_back(std::move(task));
+            }
+            remaining_ -= n;
+            return true;
+        }
+
+    private:
+        size_t remaining_;
+        const std::string payload_;
+        const std::chrono::microseconds roundTrip_;
+        Rows rows_;
+        PayloadArena arena_;
+    };
+
+    double msSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct Timing {
+        double firstMs;  // until the first task was dispatchable
+        double allMs;    // until the whole backlog was loaded
+    };
+
+    // Waits for recovery started at start and reports its progress.
+    Timing timeRecovery(TaskQueue& queue, Clock::time_point start) {
+        while (!queue.hasTask() && queue.recovering()) {
+            std::this_thread::yield();
+        }
+        double firstMs = msSince(start);
+        queue.waitForRecovery(std::chrono::hours(24));
+        return Timing{firstMs, msSince(start)};
+    }
+
+    template <class Recover>
+    void measure(const char* label, Recover&& recover) {
+        std::fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            Timing timing = recover();
+            std::printf("%-12s %16.1f %14.1f\n", label, timing.firstMs, timing.allMs);
+            std::fflush(stdout);
+            _exit(0);
+        }
+        waitpid(child, nullptr, 0);
+    }
+
+    void seedDatabase(size_t count, const std::string& payload) {
+        DatabaseManager db;
+        db.init();
+        std::vector<Task> batch;
+        Rows rows;
+        for (size_t done = 0; done < count; done += DatabaseManager::RECOVERY_FETCH_ROWS) {
+            size_t n = std::min(DatabaseManager::RECOVERY_FETCH_ROWS, count - done);
+            fetchRows(rows, n, payload);
+            batch.clear();
+            for (size_t i = 0; i < n; ++i) {
+                Task task(Poco::UUID(rows.ids[i]), rows.names[i], rows.data[i]);
+                task.setPriority(rows.priorities[i]);
+                batch.push_back(std::move(task));
+            }
+            db.persistBatch(batch, {});
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc >= 2 ? std::stoul(argv[1]) : 10000000;
+    size_t payloadBytes = argc >= 3 ? std::stoul(argv[2]) : 64;
+    std::chrono::microseconds roundTrip(argc >= 4 ? std::stoul(argv[3]) : 200);
+    std::string payload(payloadBytes, 'x');
+    const size_t batchRows = DatabaseManager::RECOVERY_FETCH_ROWS;
+
+    std::printf("%zu tasks, %zu-byte payloads, %lld us round trip\n", count, payloadBytes,
+                static_cast<long long>(roundTrip.count()));
+    std::printf("%-12s %16s %14s\n", "path", "first task ms", "all tasks ms");
+
+    measure("row-at-time", [&] {
+        auto start = Clock::now();
+        auto queue = ReadyQueue::create(QueueOptions());
+        std::vector<Task> tasks;
+        Rows rows;
+        for (size_t done = 0; done < count; done += batchRows) {
+            size_t n = std::min(batchRows, count - done);
+            fetchRows(rows, n, payload);
+            for (size_t i = 0; i < n; ++i) {
+                Task task(Poco::UUID(rows.ids[i]), rows.names[i], rows.data[i]);
+                task.setPriority(rows.priorities[i]);
+                task.setRetryCount(rows.retryCounts[i]);
+                tasks.push_back(task);
+            }
+        }
+        // Nothing is dispatchable until the whole backlog is in memory
+        double roundTripsMs = std::chrono::duration<double, std::milli>(roundTrip).count() * count;
+        double firstMs = msSince(start) + roundTripsMs;
+        for (auto& task : tasks) {
+            queue->push(std::move(task));
+        }
+        return Timing{firstMs, msSince(start) + roundTripsMs};
+    });
+
+    measure("streamed", [&] {
+        auto start = Clock::now();
+        TaskQueue queue(std::make_unique<GeneratedBacklog>(count, payload, roundTrip), QueueOptions());
+        return timeRecovery(queue, start);
+    });
+
+    if (std::getenv("TASKQUEUE_DB")) {
+        seedDatabase(count, payload);
+        measure("database", [&] {
+            auto start = Clock::now();
+            TaskQueue queue;
+            Timing timing = timeRecovery(queue, start);
+            if (queue.recoveredTasks() != count) {
+                std::printf("(%zu open tasks were in the database)\n", queue.recoveredTasks());
+            }
+            return timing;
+        });
+    }
+
+    return 0;
+}
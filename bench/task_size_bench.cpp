@@ -0,0 +1,85 @@
+// Memory per queued task: sizeof and resident-set growth for a backlog of
+// tasks held in the scheduler, against a struct with the previous layout
+// (per-instance name and status strings, separately owned payload). Each
+// measurement runs in a forked child so freed memory cannot skew the next.
+//
+//   ./task_size_bench [tasks] [payload-bytes]
+#include "BufferPool.h"
+#include "TaskScheduler.h"
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <Poco/UUIDGenerator.h>
+
+namespace {
+    // The layout Task had before names were interned and status was an enum
+    struct LegacyTask {
+        Poco::UUID id;
+        std::string name;
+        std::string data;
+        int priority;
+        std::string status;
+        bool completed;
+    };
+
+    const char* const NAMES[] = {"DataProcessing", "ImageResizing", "ReportGeneration", "EmailDispatch"};
+
+    long residentBytes() {
+        long pages = 0;
+        long resident = 0;
+        FILE* statm = std::fopen("/proc/self/statm", "r");
+        if (statm) {
+            if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+                resident = 0;
+            }
+            std::fclose(statm);
+        }
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+    template <class Fill>
+    void measure(const char* label, size_t objectSize, int count, Fill&& fill) {
+        std::fflush(stdout);
+        pid_t child = fork();
+        if (child == 0) {
+            long before = residentBytes();
+            long after = fill();  // measured while the backlog is still alive
+            std::printf("%-10s %8zu %14.1f\n", label, objectSize, double(after - before) / count);
+            std::fflush(stdout);
+            _exit(0);
+        }
+        waitpid(child, nullptr, 0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc >= 2 ? std::stoi(argv[1]) : 1000000;
+    size_t payloadBytes = argc >= 3 ? std::stoul(argv[2]) : 64;
+    std::string payload(payloadBytes, 'x');
+    Poco::UUIDGenerator& generator = Poco::UUIDGenerator::defaultGenerator();
+
+    std::printf("%d queued tasks, %zu-byte payload\n", count, payloadBytes);
+    std::printf("%-10s %8s %14s\n", "layout", "sizeof", "RSS bytes/task");
+
+    measure("legacy", sizeof(LegacyTask), count, [&] {
+        std::deque<LegacyTask> backlog;
+        for (int i = 0; i < count; ++i) {
+            backlog.push_back(LegacyTask{generator.createOne(), NAMES[i % 4], payload, 1, "PENDING", false});
+        }
+        return residentBytes();
+    });
+
+    // Tasks as the server holds them: interned names, payloads sliced from
+    // a connection arena, queued in the scheduler
+    measure("compact", sizeof(Task), count, [&] {
+        TaskScheduler scheduler;
+        PayloadArena arena;
+        for (int i = 0; i < count; ++i) {
+            scheduler.push(Task(generator.createOne(), NAMES[i % 4], arena.copy(payload), payload.size()));
+        }
+        return residentBytes();
+    });
+    return 0;
+}
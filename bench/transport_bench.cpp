@@ -0,0 +1,165 @@
+// Loopback round trips through each IoLoop backend: an echo server on one
+// loop thread, and clients doing request/response on their own threads.
+// Reports messages per second and p50/p99 round-trip latency.
+//
+//   ./transport_bench [clients] [messages-per-client] [payload-bytes]
+#include "IoLoop.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    void sendAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (n <= 0) {
+                throw std::runtime_error("send failed");
+            }
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+    }
+
+    class EchoHandler : public IoHandler {
+    public:
+        explicit EchoHandler(int fd) : fd_(fd) {}
+        ~EchoHandler() override { close(fd_); }
+
+        bool onData(const char* data, size_t size) override {
+            std::memcpy(decoder_.prepare(size), data, size);
+            decoder_.commit(size);
+            out_.clear();
+            Frame frame;
+            while (decoder_.next(frame)) {
+                appendFrame(out_, frame.type, frame.payload, frame.flags);
+            }
+            try {
+                sendAll(fd_, out_.data(), out_.size());
+                return true;
+            }
+            catch (const std::exception&) {
+                return false;
+            }
+        }
+
+        void onClose() override {}
+
+    private:
+        int fd_;
+        FrameDecoder decoder_;
+        std::string out_;
+    };
+
+    int listenLoopback(uint16_t& port) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            ::listen(fd, 128) < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+            throw std::runtime_error("cannot listen on loopback");
+        }
+        port = ntohs(address.sin_port);
+        return fd;
+    }
+
+    int connectLoopback(uint16_t port) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw std::runtime_error("cannot connect to loopback");
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    // Sends one frame per round trip and waits for its echo.
+    void runClient(uint16_t port, int messages, size_t payloadBytes, std::vector<double>& latenciesUs) {
+        int fd = connectLoopback(port);
+        std::string frame = encodeFrame(MessageType::Heartbeat, std::string(payloadBytes, 'x'));
+        std::vector<char> reply(frame.size());
+        latenciesUs.reserve(messages);
+        for (int i = 0; i < messages; ++i) {
+            auto start = Clock::now();
+            sendAll(fd, frame.data(), frame.size());
+            size_t received = 0;
+            while (received < reply.size()) {
+                ssize_t n = recv(fd, reply.data() + received, reply.size() - received, 0);
+                if (n <= 0) {
+                    throw std::runtime_error("server closed the connection");
+                }
+                received += static_cast<size_t>(n);
+            }
+            latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        }
+        close(fd);
+    }
+
+    void run(IoBackend backend, int clients, int messages, size_t payloadBytes) {
+        auto loop = IoLoop::create(backend);
+        if (loop->backend() != backend) {
+            std::printf("%-10s unavailable\n", ioBackendName(backend));
+            return;
+        }
+
+        uint16_t port = 0;
+        int listenFd = listenLoopback(port);
+        loop->listen(listenFd, [](int fd) { return std::make_unique<EchoHandler>(fd); });
+        std::thread server([&] { loop->run(); });
+
+        std::vector<std::vector<double>> perClient(clients);
+        std::vector<std::thread> threads;
+        auto start = Clock::now();
+        for (int c = 0; c < clients; ++c) {
+            threads.emplace_back(runClient, port, messages, payloadBytes, std::ref(perClient[c]));
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        loop->stop();
+        server.join();
+        loop.reset();
+        close(listenFd);
+
+        std::vector<double> latencies;
+        for (auto& client : perClient) {
+            latencies.insert(latencies.end(), client.begin(), client.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double p50 = latencies[latencies.size() / 2];
+        double p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+        std::printf("%-10s %14.0f %10.1f %10.1f\n", ioBackendName(backend), latencies.size() / seconds, p50, p99);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int clients = argc >= 2 ? std::stoi(argv[1]) : 16;
+    int messages = argc >= 3 ? std::stoi(argv[2]) : 20000;
+    size_t payloadBytes = argc >= 4 ? std::stoul(argv[3]) : 128;
+
+    std::printf("%d clients x %d round trips, %zu-byte payload\n", clients, messages, payloadBytes);
+    std::printf("%-10s %14s %10s %10s\n", "backend", "msgs/s", "p50 us", "p99 us");
+    run(IoBackend::Epoll, clients, messages, payloadBytes);
+    run(IoBackend::IoUring, clients, messages, payloadBytes);
+    return 0;
+}
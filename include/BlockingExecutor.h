@@ -0,0 +1,50 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed thread pool for work that may block on the database, so it never
+// runs on an I/O loop. Jobs must not throw; an escaping exception is logged
+// and dropped.
+class BlockingExecutor {
+public:
+    // Runs the jobs posted through it one at a time and in posting order,
+    // on whichever pool thread is free. Used per connection so offloaded
+    // requests keep their order without tying up a thread.
+    class Strand : public std::enable_shared_from_this<Strand> {
+    public:
+        explicit Strand(BlockingExecutor& executor) : executor_(executor), scheduled_(false) {}
+        void post(std::function<void()> job);
+
+    private:
+        void drain();
+
+        BlockingExecutor& executor_;
+        std::mutex mutex_;
+        std::deque<std::function<void()>> jobs_;
+        bool scheduled_;
+    };
+
+    explicit BlockingExecutor(size_t threads);
+    ~BlockingExecutor();
+
+    void post(std::function<void()> job);
+    std::shared_ptr<Strand> makeStrand() { return std::make_shared<Strand>(*this); }
+
+    // Runs everything already queued, then joins the threads.
+    void stop();
+
+private:
+    void run();
+    static void runJob(const std::function<void()>& job);
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::function<void()>> jobs_;
+    bool stopping_;
+    std::vector<std::thread> threads_;
+};
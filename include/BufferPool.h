@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Task.h"
+
+// Recycles fixed-size byte blocks. A block handed out by acquire() returns
+// to the pool when its last shared_ptr goes away, so steady traffic reuses
+// the same few blocks instead of going back to the allocator.
+class BufferPool {
+public:
+    BufferPool(size_t blockSize, size_t maxCached);
+    ~BufferPool();
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    std::shared_ptr<char> acquire();
+    size_t blockSize() const { return blockSize_; }
+    size_t cached() const;
+
+    // Shared by every PayloadArena. Never destroyed, so blocks released
+    // during static destruction still have somewhere to go.
+    static BufferPool& payloadBlocks();
+
+private:
+    void release(char* block);
+
+    const size_t blockSize_;
+    const size_t maxCached_;
+    mutable std::mutex mutex_;
+    std::vector<char*> free_;
+};
+
+// Bump allocator for task payloads. Each copy() lands in the current block
+// and returns a Task::Payload that keeps that block alive, so a connection
+// or a decoded batch pays for one block rather than one allocation per
+// task. A block is only recycled once every task sliced from it is gone,
+// which is the price: one long-queued task pins its whole block. Payloads
+// over a quarter of a block get a block of their own.
+//
+// Not thread-safe; use one arena per connection or per batch.
+class PayloadArena {
+public:
+    explicit PayloadArena(BufferPool& pool = BufferPool::payloadBlocks());
+
+    Task::Payload copy(std::string_view bytes);
+
+private:
+    BufferPool& pool_;
+    std::shared_ptr<char> block_;
+    size_t used_;
+};
+
+// Per-thread scratch string for encoding outgoing payloads. Cleared on
+// every call but keeps its capacity; valid until the same thread asks again,
+// so finish sending before encoding the next message.
+std::string& encodeScratch();
@@ -1,25 +1,126 @@
-#pragma once
-#include <Poco/Data/SessionPool.h>
-#include "Task.h"
-#include <vector>
-
-class DatabaseManager {
-public:
-    DatabaseManager();
-    ~DatabaseManager();
-
-    bool init();
-    void addTask(const Task& task);
-    void addSampleTasks();
-    std::vector<Task> getCompletedTasks();
-    void updateTaskStatus(const Poco::UUID& taskId, const std::string& status);
-    std::vector<Task> getPendingTasks();
-    Task getTask(const Poco::UUID& id);
-    void updateTaskAssignment(const Poco::UUID& taskId, const Poco::UUID& workerId, const std::string& status);
-    void markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId);
-    void addCompletedTask(const Task& task, const std::string& workerId, const Poco::DateTime& completedAt);
-
-private:
-    Poco::Data::SessionPool* sessionPool_;
-    static const std::string CONNECTION_STRING;
-};
+#pragma once
+#include <Poco/Data/SessionPool.h>
+#include "BufferPool.h"
+#include "DbMetrics.h"
+#include "PgConnectionPool.h"
+#include "Task.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A status change recorded by the write-behind pipeline.
+struct TaskUpdate {
+    Poco::UUID taskId;
+    TaskStatus status;
+    Poco::UUID workerId;
+    int retryCount = -1;  // new tasks.retry_count, or -1 to leave it alone
+};
+
+// The claim queries behind cluster mode (see TaskClaimer). An owner holds
+// the rows it claimed until it releases them or stops renewing them.
+class ClaimStore {
+public:
+    virtual ~ClaimStore() = default;
+
+    // Takes ownership of up to limit open rows nobody owns (or whose owner
+    // let the claim lapse), highest priority first. Rows another server is
+    // claiming at the same moment are skipped, not waited for.
+    virtual std::vector<Task> claimTasks(const Poco::UUID& owner, size_t limit,
+                                         std::chrono::milliseconds ownership) = 0;
+    // Extends every open claim of owner; returns how many rows it holds.
+    virtual size_t renewClaims(const Poco::UUID& owner, std::chrono::milliseconds ownership) = 0;
+    // Gives owner's open rows back, so others can claim them at once.
+    virtual size_t releaseClaims(const Poco::UUID& owner) = 0;
+    // The same for just the given rows.
+    virtual size_t releaseTasks(const Poco::UUID& owner, const std::vector<Poco::UUID>& taskIds) = 0;
+};
+
+// The open backlog (PENDING and IN_PROGRESS tasks) as startup recovery
+// reads it, highest priority first, in batches. DatabaseManager streams the
+// rows through a server-side cursor, so neither side holds the whole
+// backlog as one result set; its rows are those visible when the cursor
+// opened, and destroying it closes the cursor and ends its transaction.
+// Not thread-safe.
+class PendingTaskCursor {
+public:
+    virtual ~PendingTaskCursor() = default;
+
+    // Appends up to maxRows tasks to out and returns whether there were any.
+    virtual bool fetch(size_t maxRows, std::vector<Task>& out) = 0;
+};
+
+// Schema: tasks holds open work (pending, in progress, dead-lettered) and
+// a partial index over pending and in-progress rows by priority; a task
+// that completes moves to tasks_archive, hash-partitioned by id, so the hot
+// table and its index only grow with the backlog, not with history.
+//
+// Cold paths (schema migrations, recovery, reports) go through Poco::Data.
+// The hot queries - inserts, status updates, lookups - use PgConnectionPool
+// instead, so each is prepared once per connection, and persistBatch sends
+// its statements in one libpq pipeline. Every hot query's latency and the
+// wait for a connection are recorded in metrics().
+//
+// Several servers may share the database (see TaskClaimer): each open row
+// then records the server that owns it and until when, and a server only
+// dispatches rows it has claimed. The connection string can be overridden
+// with the TASKQUEUE_DB environment variable.
+class DatabaseManager : public ClaimStore {
+public:
+    DatabaseManager();
+    ~DatabaseManager();
+
+    // Connects and brings the schema up to date by applying migrations the
+    // database has not recorded in schema_migrations. Existing rows are kept.
+    bool init();
+    void addTask(const Task& task);
+    void addSampleTasks();
+    std::vector<Task> getCompletedTasks();  // from tasks_archive
+    void updateTaskStatus(const Poco::UUID& taskId, TaskStatus status);
+    std::vector<Task> getPendingTasks();
+    std::unique_ptr<PendingTaskCursor> openPendingTasks();
+    Task getTask(const Poco::UUID& id);
+    void updateTaskAssignment(const Poco::UUID& taskId, const Poco::UUID& workerId, TaskStatus status);
+    void markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    // Archives a task completed outside this queue (workerId may be empty),
+    // replacing its live row if there is one.
+    void addCompletedTask(const Task& task, const std::string& workerId, const Poco::DateTime& completedAt);
+
+    // Applies a batch in one transaction: a prepared INSERT per new task, then
+    // a prepared UPDATE per status change (completions are archived), pipelined.
+    void persistBatch(const std::vector<Task>& inserts, const std::vector<TaskUpdate>& updates);
+
+    // Status of each id, in request order; "UNKNOWN" for ids with no row.
+    std::vector<std::string> getTaskStatuses(const std::vector<Poco::UUID>& taskIds);
+
+    // Cluster mode: tasks inserted from now on are owned by owner for the
+    // given time, so other servers leave them alone, and status updates
+    // skip rows some other owner holds. Call before persisting anything.
+    void setClaimOwner(const Poco::UUID& owner, std::chrono::milliseconds ownership);
+    // A claim whose rows cannot be turned into Tasks is released before
+    // claimTasks() throws.
+    std::vector<Task> claimTasks(const Poco::UUID& owner, size_t limit,
+                                 std::chrono::milliseconds ownership) override;
+    size_t renewClaims(const Poco::UUID& owner, std::chrono::milliseconds ownership) override;
+    size_t releaseClaims(const Poco::UUID& owner) override;
+    size_t releaseTasks(const Poco::UUID& owner, const std::vector<Poco::UUID>& taskIds) override;
+
+    const DbMetrics& metrics() const { return metrics_; }
+
+    static constexpr size_t RECOVERY_FETCH_ROWS = 10000;  // rows per cursor FETCH
+
+private:
+    // Returns whether the tasks table did not exist beforehand. A database
+    // from before schema_migrations has one, so upgrading it returns false.
+    bool migrate(Poco::Data::Session& session);
+    static std::string connectionString();
+
+    Poco::Data::SessionPool* sessionPool_;
+    DbMetrics metrics_;
+    std::unique_ptr<PgConnectionPool> statements_;  // declared after metrics_, which it references
+    std::string claimOwner_;        // empty outside cluster mode
+    std::string claimOwnershipMs_;
+    static const std::string CONNECTION_STRING;
+    static constexpr size_t MAX_ROWS_PER_STATEMENT = 1000;  // ids per status lookup
+    static constexpr size_t PREPARED_CONNECTIONS = 10;
+};
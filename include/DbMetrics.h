@@ -0,0 +1,111 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct LatencySnapshot {
+    static constexpr size_t BUCKETS = 48;
+
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    std::array<uint64_t, BUCKETS> buckets{};  // buckets[i]: samples in [2^i, 2^(i+1)) ns
+
+    double averageNs() const { return count ? double(totalNs) / count : 0.0; }
+    // Upper bound of the bucket holding the q-th sample (0 < q <= 1), so
+    // within a factor of two of the true percentile.
+    uint64_t percentileNs(double q) const;
+};
+
+// Latency histogram with power-of-two buckets; record() is a few relaxed
+// atomic adds, so it can sit on every query.
+class LatencyStats {
+public:
+    void record(uint64_t ns) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        totalNs_.fetch_add(ns, std::memory_order_relaxed);
+        buckets_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = maxNs_.load(std::memory_order_relaxed);
+        while (ns > max && !maxNs_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    LatencySnapshot snapshot() const {
+        LatencySnapshot s;
+        s.count = count_.load(std::memory_order_relaxed);
+        s.totalNs = totalNs_.load(std::memory_order_relaxed);
+        s.maxNs = maxNs_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < LatencySnapshot::BUCKETS; ++i) {
+            s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+private:
+    static size_t bucketOf(uint64_t ns) {
+        size_t bucket = 0;
+        while (ns > 1 && bucket + 1 < LatencySnapshot::BUCKETS) {
+            ns >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> totalNs_{0};
+    std::atomic<uint64_t> maxNs_{0};
+    std::array<std::atomic<uint64_t>, LatencySnapshot::BUCKETS> buckets_{};
+};
+
+// Records the time from construction to destruction.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyStats& stats)
+        : stats_(stats)
+        , start_(std::chrono::steady_clock::now()) {
+    }
+
+    ~ScopedLatency() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stats_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyStats& stats_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+enum class DbQuery : uint8_t {
+    AddTask,
+    GetTask,
+    UpdateStatus,
+    AssignTask,
+    CompleteTask,
+    PersistBatch,
+    GetStatuses,
+    AddCompletedTask,
+    ClaimTasks,
+    RenewClaims,
+    ReleaseClaims,
+    Count
+};
+
+const char* dbQueryName(DbQuery query);
+
+// What DatabaseManager exports: latency per kind of query, and how long
+// callers waited for a pooled connection.
+struct DbMetrics {
+    std::array<LatencyStats, static_cast<size_t>(DbQuery::Count)> queries;
+    LatencyStats poolWait;
+
+    LatencyStats& query(DbQuery query) { return queries[static_cast<size_t>(query)]; }
+
+    // One line per metric with samples: calls, then avg/p50/p99/max in µs.
+    std::string report() const;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <climits>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Lets consumers of a lock-free structure sleep when it is empty without
+// putting a lock on the fast path. Producers pay one fence and one load when
+// nobody is waiting; the futex syscall is only made when a waiter exists.
+//
+// Consumer protocol:
+//     if (tryPop(x)) return x;
+//     auto key = events.prepareWait();
+//     if (tryPop(x)) { events.cancelWait(); return x; }
+//     events.wait(key);          // then retry from the top
+//
+// Producer: publish the item, then call notifyOne()/notifyAll().
+class EventCount {
+public:
+    using Key = uint32_t;
+
+    Key prepareWait() {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    void cancelWait() {
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wait(Key key) {
+#ifdef __linux__
+        while (epoch_.load(std::memory_order_acquire) == key) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+        }
+#else
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [&] { return epoch_.load(std::memory_order_acquire) != key; });
+#endif
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void notifyOne() { notify(1); }
+    void notifyAll() { notify(INT_MAX); }
+
+private:
+    void notify(int count) {
+        // Pairs with the fetch_add in prepareWait: either the waiter sees the
+        // published item on its re-check, or we see it in waiters_.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        epoch_.fetch_add(1, std::memory_order_acq_rel);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count == 1) {
+            condition_.notify_one();
+        } else {
+            condition_.notify_all();
+        }
+#endif
+    }
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit int");
+
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> waiters_{0};
+#ifndef __linux__
+    std::mutex mutex_;
+    std::condition_variable condition_;
+#endif
+};
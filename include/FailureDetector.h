@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <Poco/UUID.h>
+#include "TimingWheel.h"
+#include "UuidHash.h"
+
+struct FailureDetectorOptions {
+    std::chrono::milliseconds suspectAfter{3000};  // silence before a worker stops getting tasks
+    std::chrono::milliseconds deadAfter{10000};    // silence before it is evicted
+    std::chrono::milliseconds tick{100};
+};
+
+enum class WorkerHealth { Alive, Suspect, Dead };
+
+// Heartbeat-timeout failure detector with two thresholds. A heartbeat only
+// stamps the worker's last-seen time (O(1), no timer work). Each worker has
+// one entry in a TimingWheel due when it would turn suspect; when the entry
+// fires it is rescheduled from the latest heartbeat, so a healthy worker
+// costs one wheel operation per suspectAfter, never a scan of all workers.
+//
+// The listener runs on the sweeper thread, outside the detector's lock, and
+// is only told that a worker's health changed; it should read health(),
+// which may have moved on by then (a heartbeat can revive a suspect).
+// Dead workers are forgotten, so health() reports Dead for them.
+class FailureDetector {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Listener = std::function<void(const Poco::UUID& workerId)>;
+
+    explicit FailureDetector(const FailureDetectorOptions& options = FailureDetectorOptions());
+    ~FailureDetector();
+
+    void start();
+    void stop();
+
+    // Starts (or restarts) watching a worker as Alive.
+    void track(const Poco::UUID& workerId);
+    void forget(const Poco::UUID& workerId);
+    // False if the worker is not tracked (never registered, or declared dead).
+    bool heartbeat(const Poco::UUID& workerId);
+    WorkerHealth health(const Poco::UUID& workerId) const;
+
+    // Applies every transition due by now. Called by the sweeper thread;
+    // exposed for tests. Returns the number of workers that changed.
+    size_t expire(Clock::time_point now);
+
+    void setListener(Listener listener);
+
+private:
+    struct Watch {
+        Clock::time_point lastSeen;
+        WorkerHealth health;
+        uint64_t generation;  // tells this watch's wheel entry from a forgotten one's
+    };
+
+    struct Timer {
+        Poco::UUID workerId;
+        uint64_t generation;
+    };
+
+    void run();
+
+    const FailureDetectorOptions options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<Poco::UUID, Watch, UuidHash> workers_;
+    TimingWheel<Timer> wheel_;
+    uint64_t nextGeneration_;
+    std::shared_ptr<const Listener> listener_;  // accessed via std::atomic_load/store
+
+    std::mutex sweepMutex_;
+    std::condition_variable sweepCondition_;
+    bool running_;
+    std::thread thread_;
+};
+
+const char* workerHealthName(WorkerHealth health);
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+enum class IoBackend {
+    Epoll,
+    IoUring,  // multishot accept/recv into a kernel-registered buffer ring
+};
+
+// Receives the bytes of one connection, always on its loop's thread.
+class IoHandler {
+public:
+    virtual ~IoHandler() = default;
+
+    // The data is only valid during the call. Return false to drop the
+    // connection (e.g. on a protocol error).
+    virtual bool onData(const char* data, size_t size) = 0;
+
+    // The connection ended: peer closed, read error, or onData returned
+    // false. Called once, right before the loop destroys the handler.
+    virtual void onClose() = 0;
+};
+
+// Minimal single-threaded readiness/completion loop for the accept and read
+// side of the protocol. Writes stay synchronous on the callers' threads (see
+// WorkerSession), so the loop never closes a descriptor: whoever handed it in
+// keeps ownership and must outlive the registration.
+class IoLoop {
+public:
+    // Returns the handler for a freshly accepted connection, or nullptr to
+    // ignore it. The handler owns the new descriptor.
+    using AcceptHandler = std::function<std::unique_ptr<IoHandler>(int fd)>;
+
+    // Falls back to epoll when io_uring is not compiled in (WITH_IO_URING)
+    // or the running kernel cannot provide it.
+    static std::unique_ptr<IoLoop> create(IoBackend preferred);
+
+    virtual ~IoLoop() = default;
+
+    virtual IoBackend backend() const = 0;
+
+    // Registration is only safe before run() or from the loop's own thread.
+    virtual void listen(int fd, AcceptHandler onAccept) = 0;
+    virtual void add(int fd, std::unique_ptr<IoHandler> handler) = 0;
+
+    // Waits up to timeoutMs (-1 = forever) and dispatches what completed.
+    virtual void runOnce(int timeoutMs) = 0;
+
+    // run() dispatches until stop(), which may be called from any thread.
+    void run();
+    void stop();
+
+protected:
+    IoLoop() : stopping_(false) {}
+
+    // Interrupts a runOnce() blocked in the kernel.
+    virtual void wake() = 0;
+
+    std::atomic<bool> stopping_;
+};
+
+const char* ioBackendName(IoBackend backend);
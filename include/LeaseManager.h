@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <Poco/UUID.h>
+#include "Task.h"
+#include "TimingWheel.h"
+#include "UuidHash.h"
+
+struct LeaseOptions {
+    std::chrono::milliseconds timeout{30000};  // visibility timeout of a delivered task
+    std::chrono::milliseconds tick{100};       // expiry resolution
+    int maxRetries = 3;                        // redeliveries before a task is dead-lettered
+};
+
+// A delivered task and the worker that holds it until the deadline.
+struct Lease {
+    Task task;
+    Poco::UUID workerId;
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t grant;  // distinguishes redeliveries of the same task
+};
+
+// Visibility timeouts for dispatched tasks, as in SQS: every delivery holds
+// a lease that the worker completes, extends or lets lapse. A sweeper
+// thread advances a TimingWheel once per tick and hands lapsed leases to
+// the expiry listener, which requeues or dead-letters the task.
+//
+// Extending only moves the deadline in the lease table; the wheel entry
+// stays where it is and, when it fires early, is rescheduled for the new
+// deadline. Completed or regranted leases leave stale wheel entries behind
+// that are dropped when they fire.
+class LeaseManager {
+public:
+    using Clock = std::chrono::steady_clock;
+    using ExpiryListener = std::function<void(Lease lease)>;
+
+    explicit LeaseManager(const LeaseOptions& options = LeaseOptions());
+    ~LeaseManager();
+
+    void start();
+    void stop();
+
+    // Records that task was delivered to workerId; the lease runs for
+    // options().timeout from now.
+    void grant(const Task& task, const Poco::UUID& workerId);
+    // Ends the lease if workerId still holds it. False means it already
+    // lapsed (or was never granted), so the task may have been redelivered.
+    bool release(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    // Pushes the deadline to options().timeout from now; false if workerId
+    // no longer holds the lease.
+    bool extend(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    // Ends every lease workerId holds and hands them to the expiry listener
+    // as if they had lapsed; for workers declared dead.
+    size_t revoke(const Poco::UUID& workerId);
+
+    // Expires every lease due by now and notifies the listener outside the
+    // lock. Called by the sweeper thread; exposed for tests.
+    size_t expire(Clock::time_point now);
+
+    size_t size() const;
+    const LeaseOptions& options() const { return options_; }
+
+    void setExpiryListener(ExpiryListener listener);
+
+private:
+    struct Timer {
+        Poco::UUID taskId;
+        uint64_t grant;
+    };
+
+    void run();
+    void forgetHolder(const Lease& lease);
+    void notify(std::vector<Lease>& ended);
+
+    const LeaseOptions options_;
+    mutable std::mutex mutex_;
+    std::unordered_map<Poco::UUID, Lease, UuidHash> leases_;
+    std::unordered_map<Poco::UUID, std::unordered_set<Poco::UUID, UuidHash>, UuidHash> byWorker_;
+    TimingWheel<Timer> wheel_;
+    uint64_t nextGrant_;
+    std::shared_ptr<const ExpiryListener> listener_;  // accessed via std::atomic_load/store
+
+    std::mutex sweepMutex_;
+    std::condition_variable sweepCondition_;
+    bool running_;
+    std::thread thread_;
+};
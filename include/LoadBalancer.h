@@ -1,17 +1,90 @@
-#pragma once
-#include <vector>
-#include <mutex>
-#include "Worker.h"
-
-class LoadBalancer {
-public:
-    void addWorker(const Worker& worker);
-    void removeWorker(const Poco::UUID& workerId);
-    Worker* getNextAvailableWorker();
-    void updateWorkerStatus(const Poco::UUID& workerId, bool available);
-
-private:
-    std::vector<Worker> workers_;
-    mutable std::mutex mutex_;
-    size_t currentWorkerIndex_ = 0;
-};
\ No newline at end of file
+#pragma once
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include "FailureDetector.h"
+#include "UuidHash.h"
+#include "Worker.h"
+#include "WorkerSelector.h"
+
+// Tracks connected workers and picks which one gets the next task.
+//
+// A worker is eligible for a task while it is online, alive (see
+// FailureDetector: a suspect worker gets nothing new) and holds a free
+// credit. A worker the detector declares dead is evicted, and the eviction
+// listener is told so its in-flight tasks can be requeued.
+//
+// Credits work like AMQP basic.qos prefetch: a worker grants K at
+// registration, every dispatched task consumes one and every completion
+// returns it, so up to K tasks are pipelined to the worker instead of one
+// per completion round trip. Capacity is the execution slots it
+// advertised. Eligible workers are kept in a WorkerSelector for the
+// configured policy, so picking never scans the whole worker list.
+// Policies that look at load use
+//   score = reported load + busy slots / capacity
+// where busy slots is the larger of the server's in-flight count and what
+// the worker last reported as occupied.
+class LoadBalancer {
+public:
+    // maxCredits caps what any worker may request.
+    explicit LoadBalancer(SelectionPolicy policy = SelectionPolicy::LeastLoaded, int maxCredits = 256,
+                          const FailureDetectorOptions& detector = FailureDetectorOptions());
+    ~LoadBalancer();
+
+    // Runs the failure detector's sweeper.
+    void start();
+    void stop();
+
+    void addWorker(const Worker& worker);
+    void removeWorker(const Poco::UUID& workerId);
+
+    // Picks a worker and reserves one of its task slots in one step, so
+    // concurrent distributor threads never oversubscribe a worker. Every
+    // successful acquire must be matched by a releaseWorker().
+    std::optional<Poco::UUID> acquireAvailableWorker();
+    void releaseWorker(const Poco::UUID& workerId);
+
+    // Online/offline transitions (connect, disconnect).
+    void updateWorkerStatus(const Poco::UUID& workerId, bool available);
+    // False if the worker is unknown, e.g. evicted while its connection
+    // stayed up; the caller should register it again.
+    bool recordHeartbeat(const Poco::UUID& workerId);
+    bool recordHeartbeat(const Poco::UUID& workerId, double load, int freeSlots);
+    void setWorkerWeight(const Poco::UUID& workerId, int weight);
+    // Per-worker prefetch tuning; takes effect for the next dispatch.
+    void setWorkerCredits(const Poco::UUID& workerId, int credits);
+
+    // Invoked (under the balancer lock) when a worker becomes eligible for a task.
+    void setAvailabilityListener(std::function<void()> listener);
+    // Invoked (outside the lock, on the detector's thread) after a dead
+    // worker has been removed.
+    void setEvictionListener(std::function<void(const Poco::UUID& workerId)> listener);
+
+private:
+    struct WorkerState {
+        Worker worker;
+        double load = 0.0;
+        int inFlight = 0;
+        int capacity = 1;
+        int credits = 1;
+        int reportedFreeSlots = 0;
+        int weight = 1;
+        WorkerHealth health = WorkerHealth::Alive;
+        bool indexed = false;  // currently in selector_
+    };
+
+    WorkerState* find(const Poco::UUID& workerId);
+    WorkerState* pickLocked();
+    void refresh(WorkerState& state);
+    void onHealthChanged(const Poco::UUID& workerId);
+
+    std::unordered_map<Poco::UUID, WorkerState, UuidHash> workers_;
+    std::unique_ptr<WorkerSelector> selector_;
+    const int maxCredits_;
+    mutable std::mutex mutex_;
+    std::function<void()> listener_;
+    std::function<void(const Poco::UUID&)> evictionListener_;  // guarded by mutex_
+    FailureDetector detector_;  // lock order: mutex_, then the detector's
+};
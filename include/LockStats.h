@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+struct LockStatsSnapshot {
+    uint64_t acquisitions = 0;
+    uint64_t totalWaitNs = 0;
+    uint64_t totalHoldNs = 0;
+    uint64_t maxHoldNs = 0;
+
+    double averageHoldNs() const { return acquisitions ? double(totalHoldNs) / acquisitions : 0.0; }
+    double averageWaitNs() const { return acquisitions ? double(totalWaitNs) / acquisitions : 0.0; }
+};
+
+// Contention counters for a mutex: how long callers waited to acquire it and
+// how long they held it.
+class LockStats {
+public:
+    void record(uint64_t waitNs, uint64_t holdNs) {
+        acquisitions_.fetch_add(1, std::memory_order_relaxed);
+        totalWaitNs_.fetch_add(waitNs, std::memory_order_relaxed);
+        totalHoldNs_.fetch_add(holdNs, std::memory_order_relaxed);
+        uint64_t max = maxHoldNs_.load(std::memory_order_relaxed);
+        while (holdNs > max && !maxHoldNs_.compare_exchange_weak(max, holdNs, std::memory_order_relaxed)) {
+        }
+    }
+
+    LockStatsSnapshot snapshot() const {
+        LockStatsSnapshot s;
+        s.acquisitions = acquisitions_.load(std::memory_order_relaxed);
+        s.totalWaitNs = totalWaitNs_.load(std::memory_order_relaxed);
+        s.totalHoldNs = totalHoldNs_.load(std::memory_order_relaxed);
+        s.maxHoldNs = maxHoldNs_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() {
+        acquisitions_ = 0;
+        totalWaitNs_ = 0;
+        totalHoldNs_ = 0;
+        maxHoldNs_ = 0;
+    }
+
+private:
+    std::atomic<uint64_t> acquisitions_{0};
+    std::atomic<uint64_t> totalWaitNs_{0};
+    std::atomic<uint64_t> totalHoldNs_{0};
+    std::atomic<uint64_t> maxHoldNs_{0};
+};
+
+// unique_lock that reports its wait and hold time to a LockStats on release.
+class TimedLock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimedLock(std::mutex& mutex, LockStats& stats)
+        : stats_(stats)
+        , requested_(Clock::now())
+        , lock_(mutex)
+        , acquired_(Clock::now()) {
+    }
+
+    ~TimedLock() {
+        if (lock_.owns_lock()) {
+            unlock();
+        }
+    }
+
+    TimedLock(const TimedLock&) = delete;
+    TimedLock& operator=(const TimedLock&) = delete;
+
+    // For condition variables. Call restartHold() after a wait returns so the
+    // blocked time is not counted as hold time.
+    std::unique_lock<std::mutex>& get() { return lock_; }
+    void restartHold() { acquired_ = Clock::now(); }
+
+    void unlock() {
+        auto released = Clock::now();
+        lock_.unlock();
+        stats_.record(nanos(acquired_ - requested_), nanos(released - acquired_));
+    }
+
+private:
+    static uint64_t nanos(Clock::duration d) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+    }
+
+    LockStats& stats_;
+    Clock::time_point requested_;
+    std::unique_lock<std::mutex> lock_;
+    Clock::time_point acquired_;
+};
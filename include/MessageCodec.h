@@ -0,0 +1,147 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Poco/UUID.h>
+#include "Protocol.h"
+#include "Task.h"
+
+// Payload encodings. JSON is always understood; the compact binary form is
+// negotiated per connection (see RegisterMessage / RegisterAckMessage). Each
+// frame's flags record the encoding it was written with, so a receiver can
+// always decode regardless of what was negotiated.
+//
+// Binary layout: UUIDs as 16 raw bytes, integers as LEB128 varints (signed
+// values zigzag-encoded), strings as varint length + bytes, floats as 4
+// little-endian bytes, booleans as one byte.
+enum class Encoding : uint8_t {
+    Json = 0,
+    Binary = 1,
+};
+
+constexpr uint8_t FRAME_FLAG_BINARY = 0x01;
+
+inline uint8_t frameFlags(Encoding encoding) {
+    return encoding == Encoding::Binary ? FRAME_FLAG_BINARY : 0;
+}
+
+inline Encoding frameEncoding(const Frame& frame) {
+    return (frame.flags & FRAME_FLAG_BINARY) ? Encoding::Binary : Encoding::Json;
+}
+
+struct RegisterMessage {
+    Poco::UUID workerId;
+    bool supportsBinary;
+    uint32_t slots = 1;     // tasks the worker can execute concurrently
+    uint32_t prefetch = 0;  // credits: tasks it accepts before completing any; 0 = slots
+};
+
+struct RegisterAckMessage {
+    Encoding encoding;
+};
+
+struct HeartbeatMessage {
+    Poco::UUID workerId;
+    float load;
+    uint32_t freeSlots = 0;  // execution slots neither running nor holding a queued task
+};
+
+struct TaskCompletedMessage {
+    Poco::UUID taskId;
+    Poco::UUID workerId;
+};
+
+struct TaskCompletedAckMessage {
+    Poco::UUID taskId;
+};
+
+// Sent periodically for tasks a worker is still running, so their leases
+// do not lapse (see LeaseManager).
+struct ExtendLeaseMessage {
+    Poco::UUID workerId;
+    std::vector<Poco::UUID> taskIds;
+};
+
+struct CheckStatusMessage {
+    Poco::UUID taskId;
+};
+
+struct StatusReplyMessage {
+    Poco::UUID taskId;
+    bool completed;
+};
+
+// Client batch API. Requests carry an id that the reply echoes, so a client
+// can keep many requests in flight on one connection.
+struct SubmitBatchMessage {
+    uint64_t requestId;
+    std::vector<Task> tasks;
+};
+
+struct SubmitAckMessage {
+    uint64_t requestId;
+    uint32_t accepted;
+};
+
+struct StatusQueryMessage {
+    uint64_t requestId;
+    std::vector<Poco::UUID> taskIds;
+};
+
+struct TaskStatusEntry {
+    Poco::UUID taskId;
+    std::string status;  // tasks.status, or "UNKNOWN" if the id does not exist
+};
+
+struct StatusBatchReplyMessage {
+    uint64_t requestId;
+    std::vector<TaskStatusEntry> statuses;
+};
+
+class PayloadArena;
+
+// Task payloads (NewTask, SubmitTask)
+void encodeTask(std::string& out, const Task& task, Encoding encoding);
+// Same payload split in two: out gets everything up to the task data and
+// the returned view is the rest, pointing into the task's shared buffer, so
+// a sender can write both without copying the data (see sendFrameParts).
+// JSON escapes the data inline, so there the view is empty.
+std::string_view encodeTaskParts(std::string& out, const Task& task, Encoding encoding);
+// With an arena, binary task data is copied into it instead of a heap
+// allocation of its own. Decoding a SubmitBatch always uses one arena for
+// the whole batch.
+Task decodeTask(std::string_view payload, Encoding encoding, PayloadArena* arena = nullptr);
+
+// Control messages. Decoding throws on malformed input.
+void encodeMessage(std::string& out, const RegisterMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const RegisterAckMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const HeartbeatMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const TaskCompletedMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const TaskCompletedAckMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const ExtendLeaseMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const CheckStatusMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const StatusReplyMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const SubmitBatchMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const SubmitAckMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const StatusQueryMessage& message, Encoding encoding);
+void encodeMessage(std::string& out, const StatusBatchReplyMessage& message, Encoding encoding);
+
+void decodeMessage(std::string_view payload, Encoding encoding, RegisterMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, RegisterAckMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, HeartbeatMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, TaskCompletedMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, TaskCompletedAckMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, ExtendLeaseMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, CheckStatusMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, StatusReplyMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, SubmitBatchMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, SubmitAckMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, StatusQueryMessage& message);
+void decodeMessage(std::string_view payload, Encoding encoding, StatusBatchReplyMessage& message);
+
+template <class Message>
+Message decodeMessage(const Frame& frame) {
+    Message message{};
+    decodeMessage(frame.payload, frameEncoding(frame), message);
+    return message;
+}
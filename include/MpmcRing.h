@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// Bounded lock-free multi-producer/multi-consumer ring (Dmitry Vyukov's
+// design). Every slot carries a sequence number that tells producers and
+// consumers whose turn it is, so a push or pop costs one CAS on the shared
+// cursor plus one release store on the slot. Neither operation ever blocks:
+// tryPush fails when the ring is full and tryPop fails when it is empty.
+template <class T>
+class MpmcRing {
+public:
+    explicit MpmcRing(size_t capacity)
+        : mask_(capacity - 1)
+        , cells_(new Cell[capacity]) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("MpmcRing capacity must be a power of two >= 2");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    ~MpmcRing() {
+        while (tryPop()) {
+        }
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    bool tryPush(T&& value) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> tryPop() {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;  // empty
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* value = std::launder(reinterpret_cast<T*>(cell->storage));
+        std::optional<T> out(std::move(*value));
+        value->~T();
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return out;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Snapshot only; may be stale by the time the caller looks at it.
+    size_t approximateSize() const {
+        size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+        size_t head = dequeuePos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Producers and consumers hammer different cursors; keep them on
+    // separate cache lines.
+    alignas(CACHE_LINE) const size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueuePos_;
+    alignas(CACHE_LINE) std::atomic<size_t> dequeuePos_;
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DatabaseManager.h"
+#include "Task.h"
+#include "WriteAheadLog.h"
+
+struct PersistenceOptions {
+    size_t flushSize = 512;                                // flush early once this many changes are pending
+    std::chrono::milliseconds flushInterval{10};           // maximum time a change waits before a flush
+    bool durableEnqueue = false;                           // TaskQueue::addTask waits until the task is durable
+    std::string walDirectory;                              // local write-ahead log; empty keeps durability in the database
+    size_t walSegmentBytes = 64 * 1024 * 1024;
+};
+
+// One update per task: its latest, at the position of its first. A retry
+// count set earlier survives a later update that leaves it alone (-1), as
+// when a requeue is followed by the redelivery in the same batch.
+std::vector<TaskUpdate> coalesceUpdates(const std::vector<TaskUpdate>& updates);
+
+// Write-behind persistence. Hot-path callers record task state changes and
+// return immediately; a dedicated thread collects them and writes each batch
+// with DatabaseManager::persistBatch in a single transaction.
+//
+// Every recorded change gets a sequence number. Batches are applied in
+// order, so once appliedSequence() reaches n all changes up to n are in the
+// database.
+//
+// With a WAL directory configured, each change is also appended to a local
+// WriteAheadLog under its sequence number, and a change counts as durable
+// once the log has synced it, so acknowledging a submit costs a group-
+// committed fdatasync instead of a database round trip. The database is
+// then only a checkpoint target: after each applied batch the log drops
+// segments the database already holds, and recover() replays the rest
+// after a crash. Without a WAL, durable means applied.
+
+class PersistenceWriter {
+public:
+    using Sequence = uint64_t;
+
+    PersistenceWriter(DatabaseManager& dbManager, const PersistenceOptions& options = PersistenceOptions());
+    ~PersistenceWriter();
+
+    // Applies WAL records the database may not have seen and returns how
+    // many there were. Call once, before start().
+    size_t recover();
+
+    void start();
+    void stop();  // flushes whatever is still pending
+
+    Sequence insertTask(const Task& task);
+    Sequence insertTasks(const std::vector<Task>& tasks);  // one sequence number for the whole batch
+    Sequence assignTask(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    Sequence completeTask(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    // A lapsed lease: back to PENDING, or to DEAD_LETTER once out of retries.
+    Sequence requeueTask(const Poco::UUID& taskId, const Poco::UUID& workerId, int retryCount);
+    Sequence deadLetterTask(const Poco::UUID& taskId, const Poco::UUID& workerId, int retryCount);
+
+    // Crash-safe: synced to the WAL, or committed when there is none.
+    bool waitDurable(Sequence sequence, std::chrono::milliseconds timeout);
+    // Visible to database queries.
+    bool waitApplied(Sequence sequence, std::chrono::milliseconds timeout);
+    Sequence appliedSequence() const { return appliedSequence_; }
+    Sequence lastSequence();  // most recently recorded change
+
+private:
+    Sequence recordUpdate(const TaskUpdate& update);
+    Sequence logged(std::string_view record);  // called with mutex_ held
+    void run();
+    bool flush(std::vector<Task>& inserts, std::vector<TaskUpdate>& updates, bool stopping);
+
+    DatabaseManager& dbManager_;
+    PersistenceOptions options_;
+    std::unique_ptr<WriteAheadLog> wal_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<Task> pendingInserts_;
+    std::vector<TaskUpdate> pendingUpdates_;
+    Sequence lastSequence_;
+    bool running_;
+
+    std::mutex appliedMutex_;
+    std::condition_variable appliedCondition_;
+    std::atomic<Sequence> appliedSequence_;
+
+    std::thread thread_;
+
+    static constexpr int MAX_RETRY_BACKOFF_MS = 5000;
+    static constexpr int SHUTDOWN_FLUSH_ATTEMPTS = 3;
+    static constexpr size_t RECOVERY_BATCH = PgPipeline::MAX_PIPELINE_DEPTH;  // replayed changes per transaction
+};
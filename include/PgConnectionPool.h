@@ -0,0 +1,110 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <libpq-fe.h>
+#include "DbMetrics.h"
+
+// SQL that is prepared once per connection under a fixed name and executed
+// by name afterwards, so the server parses and plans it only once. Define
+// instances with static storage: connections remember them by address.
+struct PreparedQuery {
+    const char* name;
+    const char* sql;
+};
+
+using PgResult = std::unique_ptr<PGresult, void (*)(PGresult*)>;
+
+// One libpq connection and the statements already prepared on it.
+// Failures throw std::runtime_error with the server's message.
+class PgConnection {
+public:
+    explicit PgConnection(const std::string& conninfo);
+    ~PgConnection();
+
+    PgConnection(const PgConnection&) = delete;
+    PgConnection& operator=(const PgConnection&) = delete;
+
+    // Text-format parameters; nullptr binds NULL.
+    PgResult execute(const PreparedQuery& query, const std::vector<const char*>& params);
+    bool healthy() const;
+
+private:
+    friend class PgPipeline;
+
+    void prepare(const PreparedQuery& query);
+    [[noreturn]] void fail(const char* what) const;
+
+    PGconn* conn_;
+    std::unordered_set<const PreparedQuery*> prepared_;
+};
+
+// Independent statements run in one transaction. In libpq pipeline mode
+// (libpq 14+) they are sent back to back and their results read after a
+// sync every MAX_PIPELINE_DEPTH statements, so N statements cost about
+// N / MAX_PIPELINE_DEPTH round trips instead of N. run() commits, or rolls
+// back and throws on the first error.
+class PgPipeline {
+public:
+    explicit PgPipeline(PgConnection& connection);
+
+    void add(const PreparedQuery& query, std::vector<std::string> params);
+    size_t size() const { return statements_.size(); }
+    void run();
+
+    static constexpr size_t MAX_PIPELINE_DEPTH = 256;
+
+private:
+    struct Statement {
+        const PreparedQuery* query;
+        std::vector<std::string> params;
+    };
+
+    void runPipelined();
+    std::vector<const char*> values(const Statement& statement) const;
+
+    PgConnection& connection_;
+    std::vector<Statement> statements_;
+};
+
+// Connections for prepared statements, opened on demand up to a maximum.
+// Time spent waiting for one (including connecting) goes to waitStats.
+class PgConnectionPool {
+public:
+    PgConnectionPool(std::string conninfo, size_t maxConnections, LatencyStats& waitStats);
+    ~PgConnectionPool();
+
+    // Returns the connection to the pool when destroyed; a connection that
+    // broke is closed instead.
+    class Lease {
+    public:
+        Lease(PgConnectionPool& pool, std::unique_ptr<PgConnection> connection);
+        Lease(Lease&& other) noexcept;
+        ~Lease();
+
+        PgConnection& operator*() const { return *connection_; }
+        PgConnection* operator->() const { return connection_.get(); }
+
+    private:
+        PgConnectionPool* pool_;
+        std::unique_ptr<PgConnection> connection_;
+    };
+
+    Lease acquire();
+
+private:
+    void release(std::unique_ptr<PgConnection> connection);
+
+    const std::string conninfo_;
+    const size_t maxConnections_;
+    LatencyStats& waitStats_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<std::unique_ptr<PgConnection>> idle_;
+    size_t open_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Poco/Net/StreamSocket.h>
+
+// Wire protocol shared by the server, workers and clients.
+//
+// Every message is a frame: a 6-byte header followed by the payload.
+//   bytes 0-3  payload length, big-endian
+//   byte  4    MessageType
+//   byte  5    flags (bit 0: payload uses the binary encoding, see MessageCodec.h)
+enum class MessageType : uint8_t {
+    Register = 1,
+    Heartbeat = 2,
+    NewTask = 3,
+    TaskCompleted = 4,
+    TaskCompletedAck = 5,
+    SubmitTask = 6,
+    CheckStatus = 7,
+    StatusReply = 8,
+    RegisterAck = 9,
+    SubmitBatch = 10,
+    SubmitAck = 11,
+    StatusQuery = 12,
+    StatusBatchReply = 13,
+    ExtendLease = 14,
+};
+
+const char* messageTypeName(MessageType type);
+
+constexpr size_t FRAME_HEADER_SIZE = 6;
+constexpr size_t DEFAULT_MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+// A decoded frame. The payload points into the decoder's buffer and is only
+// valid until the next call to FrameDecoder::prepare().
+struct Frame {
+    MessageType type;
+    uint8_t flags;
+    std::string_view payload;
+};
+
+// Incremental per-connection decoder. Callers receive straight into the
+// buffer returned by prepare(), commit() the byte count, then drain complete
+// frames with next(). Partial frames stay buffered across reads and any
+// number of frames may arrive in a single read.
+class FrameDecoder {
+public:
+    explicit FrameDecoder(size_t maxFrameSize = DEFAULT_MAX_FRAME_SIZE);
+
+    char* prepare(size_t minSpace);
+    void commit(size_t bytes);
+    bool next(Frame& frame);
+    size_t buffered() const { return writePos_ - readPos_; }
+
+private:
+    std::vector<char> buffer_;
+    size_t readPos_;
+    size_t writePos_;
+    size_t maxFrameSize_;
+};
+
+void appendFrame(std::string& out, MessageType type, std::string_view payload, uint8_t flags = 0);
+std::string encodeFrame(MessageType type, std::string_view payload, uint8_t flags = 0);
+
+// Writes a whole frame to a blocking socket; throws Poco::Exception on failure.
+void sendFrame(Poco::Net::StreamSocket& socket, MessageType type, std::string_view payload, uint8_t flags = 0);
+
+// Same, for a payload given as head + tail. Header and both parts go out in
+// one gathered send, so neither part is copied into a frame buffer.
+void sendFrameParts(Poco::Net::StreamSocket& socket, MessageType type,
+                    std::string_view head, std::string_view tail, uint8_t flags = 0);
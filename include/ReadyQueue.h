@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include "Task.h"
+#include "TaskScheduler.h"
+#include "LockStats.h"
+#include "MpmcRing.h"
+#include "EventCount.h"
+
+// In-memory store of tasks that are ready to dispatch.
+enum class QueueBackend {
+    Mutex,         // priority + aging (TaskScheduler) under a mutex/condvar
+    LockFreeRing   // FIFO MpmcRing, consumers park on an EventCount when empty
+};
+
+// How TaskQueue spreads tasks over its shards.
+enum class ShardKey {
+    TaskId,   // uniform spread
+    TaskName  // tasks of one type share a shard and its ordering
+};
+
+struct QueueOptions {
+    QueueBackend backend = QueueBackend::Mutex;
+    size_t ringCapacity = 65536;  // power of two; LockFreeRing only
+    size_t shards = 1;            // one ReadyQueue (and distributor thread) per shard
+    ShardKey shardKey = ShardKey::TaskId;
+};
+
+class ReadyQueue {
+public:
+    virtual ~ReadyQueue() = default;
+
+    virtual void push(Task task) = 0;
+    virtual std::optional<Task> tryPop() = 0;
+    virtual Task pop() = 0;  // blocks while empty
+    virtual bool empty() const = 0;
+    virtual LockStatsSnapshot lockStats() const { return LockStatsSnapshot(); }
+
+    static std::unique_ptr<ReadyQueue> create(const QueueOptions& options);
+};
+
+class MutexReadyQueue : public ReadyQueue {
+public:
+    void push(Task task) override;
+    std::optional<Task> tryPop() override;
+    Task pop() override;
+    bool empty() const override;
+    LockStatsSnapshot lockStats() const override { return lockStats_.snapshot(); }
+
+private:
+    TaskScheduler tasks_;
+    mutable std::mutex mutex_;
+    mutable LockStats lockStats_;
+    std::condition_variable condition_;
+};
+
+// Lock-free on the common path. Priorities are not honoured: tasks leave in
+// roughly the order they arrived. When the ring is full, pushes spill into a
+// mutex-protected overflow list so enqueue never fails or blocks; consumers
+// only touch the overflow while its size is non-zero.
+class RingReadyQueue : public ReadyQueue {
+public:
+    explicit RingReadyQueue(size_t capacity);
+
+    void push(Task task) override;
+    std::optional<Task> tryPop() override;
+    Task pop() override;
+    bool empty() const override;
+    LockStatsSnapshot lockStats() const override { return overflowLockStats_.snapshot(); }
+
+private:
+    MpmcRing<Task> ring_;
+    EventCount events_;
+
+    std::atomic<size_t> overflowSize_;
+    mutable std::mutex overflowMutex_;
+    mutable LockStats overflowLockStats_;
+    std::deque<Task> overflow_;
+};
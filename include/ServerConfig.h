@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "WorkerSelector.h"
+
+// Command-line settings for TaskQueueServer:
+//   TaskQueueServer [--port N] [--shards N]
+//                   [--balancer round-robin|least-loaded|p2c|weighted]
+//                   [--max-prefetch N] [--io-threads N] [--db-threads N]
+//                   [--transport reactor|epoll|io_uring]
+//                   [--lease-timeout MS] [--max-retries N]
+//                   [--suspect-after MS] [--dead-after MS]
+//                   [--wal-dir PATH] [--metrics-interval SEC]
+//                   [--cluster] [--claim-batch N] [--claim-ownership MS]
+// How connections are accepted and read: the Poco reactor, or an IoLoop
+// backend (io_uring falls back to epoll where unavailable).
+enum class ServerTransport { Reactor, Epoll, IoUring };
+
+struct ServerConfig {
+    int port = 8080;
+    size_t shards = 0;  // queue shards / distributor threads; 0 = one per core
+    SelectionPolicy selectionPolicy = SelectionPolicy::LeastLoaded;
+    int maxPrefetch = 256;  // caps the credits a worker may request
+    size_t ioThreads = 0;   // event loops; 0 = one per core
+    size_t dbThreads = 4;   // threads for requests that block on the database
+    ServerTransport transport = ServerTransport::Reactor;
+    int leaseTimeoutMs = 30000;  // a delivered task is redelivered if not completed or extended in time
+    int maxRetries = 3;          // redeliveries before a task is dead-lettered
+    int suspectAfterMs = 3000;   // heartbeat silence before a worker gets no new tasks
+    int deadAfterMs = 10000;     // heartbeat silence before it is evicted and its tasks requeued
+    std::string walDirectory;    // submits are acknowledged once synced to this local log; empty = off
+    int metricsIntervalSec = 60; // how often database latency is logged; 0 = never
+    bool cluster = false;        // share the database with other servers, claiming tasks from it
+    int claimBatch = 256;        // tasks claimed per round trip in cluster mode
+    int claimOwnershipMs = 30000;  // a dead server's claims are taken over after this
+
+    // Throws std::invalid_argument on unknown options or bad values.
+    static ServerConfig fromArgs(int argc, char* argv[]);
+
+    size_t effectiveShards() const;
+    size_t effectiveIoThreads() const;
+};
@@ -1,27 +1,82 @@
-#pragma once
-#include <string>
-#include <Poco/UUID.h>
-
-class Task {
-public:
-    Task(const std::string& name, const std::string& data);
-    Task(const Poco::UUID& id, const std::string& name, const std::string& data);
-
-    Poco::UUID getId() const;
-    std::string getName() const;
-    std::string getData() const;
-    int getPriority() const;
-    void setPriority(int priority);
-    std::string getStatus() const;
-    void setStatus(const std::string& status);
-    bool isCompleted() const;
-    void setCompleted(bool completed);
-    
-private:
-    Poco::UUID id_;
-    std::string name_;
-    std::string data_;
-    int priority_;
-    std::string status_;
-    bool completed_;
-};
\ No newline at end of file
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <Poco/UUID.h>
+
+enum class TaskStatus : uint8_t {
+    Pending,
+    InProgress,
+    Completed,
+    DeadLetter,  // lease lapsed more than LeaseOptions::maxRetries times
+};
+
+// The names stored in tasks.status and reported to clients.
+const char* taskStatusName(TaskStatus status);
+TaskStatus parseTaskStatus(const std::string& name);  // throws std::invalid_argument
+
+// Interned task names. Names are task types drawn from a small set
+// ("DataProcessing", "ImageResizing", ...), so every Task points at one
+// shared copy instead of carrying its own string. Entries live for the rest
+// of the process, so the table stops growing at MAX_NAMES: names come from
+// clients, and a Task whose name finds no room keeps a reference-counted
+// copy of its own instead.
+class TaskNames {
+public:
+    static constexpr size_t MAX_NAMES = 65536;
+
+    // nullptr when the name is new and the table is full
+    static const std::string* intern(std::string_view name);
+    static size_t size();
+};
+
+// Tasks are copied freely (scheduler buckets, batches, the write-behind
+// queue), so the payload is immutable and shared: copying a Task never
+// copies its data, and getters hand out references or views. The bytes are
+// usually a slice of a larger block shared with other tasks (see
+// PayloadArena); the Task keeps that block alive.
+//
+// Millions of tasks may sit in the queue, so the layout is kept tight:
+// a name pointer, a 32-bit payload size, a one-byte status and a 16-bit
+// retry count, ordered to avoid padding (56 bytes on LP64). The name is
+// interned unless the table was full; only then do copies touch a count.
+class Task {
+public:
+    using Payload = std::shared_ptr<const char>;
+
+    Task(std::string_view name, std::string data);
+    Task(const Poco::UUID& id, std::string_view name, std::string data);
+    Task(const Poco::UUID& id, std::string_view name, Payload data, size_t size);
+    Task(const Task& other);
+    Task(Task&& other) noexcept;
+    Task& operator=(const Task& other);
+    Task& operator=(Task&& other) noexcept;
+    ~Task();
+
+    const Poco::UUID& getId() const;
+    const std::string& getName() const;
+    std::string_view getData() const;
+    int getPriority() const;
+    void setPriority(int priority);
+    TaskStatus getStatus() const;
+    void setStatus(TaskStatus status);
+    bool isCompleted() const;
+    void setCompleted(bool completed);
+    // Deliveries whose lease lapsed (tasks.retry_count)
+    int getRetryCount() const;
+    void setRetryCount(int retryCount);
+    
+private:
+    void setName(std::string_view name);
+    void releaseName();
+
+    Poco::UUID id_;
+    Payload data_;
+    const std::string* name_;  // interned, or counted when ownsName_
+    uint32_t dataSize_;
+    int32_t priority_;
+    TaskStatus status_;
+    bool ownsName_;
+    uint16_t retryCount_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Poco/UUID.h>
+#include "DatabaseManager.h"
+#include "Task.h"
+
+// Several TaskQueueServers sharing one database. Each server is a node with
+// a random id; it dispatches the tasks submitted to it and the ones it
+// claims from the shared backlog, and nothing else.
+struct ClusterOptions {
+    bool enabled = false;
+    size_t claimBatch = 256;                      // rows claimed per round trip
+    std::chrono::milliseconds ownership{30000};   // a claim lapses unless renewed within this
+    std::chrono::milliseconds pollInterval{200};  // how often an idle node looks for unclaimed rows
+};
+
+// Claims open rows for this node in batches with one UPDATE over a
+// FOR UPDATE SKIP LOCKED subquery: nodes claiming at the same moment take
+// disjoint rows without blocking one another, so dispatch capacity grows
+// with the number of nodes and no node coordinates the others.
+//
+// Claims are renewed every ownership / 3. When a node dies its rows become
+// claimable once their ownership lapses, which redelivers whatever it had
+// in flight, as startup recovery does for a single server. A node cut off
+// from the database for longer than the ownership period may deliver a
+// task that another node has claimed meanwhile. Rows claimed but not
+// published, because the publish callback threw, are released again.
+class TaskClaimer {
+public:
+    using Backlog = std::function<size_t()>;  // tasks waiting in the node's ready queues
+    using Publish = std::function<void(std::vector<Task>&)>;
+
+    TaskClaimer(ClaimStore& store, const ClusterOptions& options, const Poco::UUID& nodeId, Backlog backlog,
+                Publish publish);
+    ~TaskClaimer();
+
+    TaskClaimer(const TaskClaimer&) = delete;
+    TaskClaimer& operator=(const TaskClaimer&) = delete;
+
+    void start();
+    void stop();     // stops claiming and renewing; claims are kept
+    void release();  // hands the node's unfinished rows back to the others
+
+    // Claims ahead: the next batch is fetched once the backlog has drained
+    // to lowWatermark(), while the rest is still being dispatched. wake()
+    // tells the claimer it has; otherwise it checks every pollInterval.
+    size_t lowWatermark() const { return options_.claimBatch / 2; }
+    void wake();
+
+    const Poco::UUID& nodeId() const { return nodeId_; }
+    uint64_t claimed() const { return claimed_; }
+
+private:
+    void run();
+    void publish(std::vector<Task>& batch);
+
+    ClaimStore& store_;
+    const ClusterOptions options_;
+    const Poco::UUID nodeId_;
+    Backlog backlog_;
+    Publish publish_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool woken_;
+    std::atomic<bool> running_;
+    std::atomic<uint64_t> claimed_;
+    std::vector<Poco::UUID> unpublished_;  // claimed but never published; released by run()
+    std::thread thread_;
+};
@@ -1,16 +1,62 @@
-#pragma once
-#include <string>
-#include <Poco/Net/SocketStream.h>
-#include <Poco/JSON/Object.h>
-#include "Task.h"
-
-class TaskClient {
-public:
-    TaskClient(const std::string& host, int port);
-    void submitTask(const Task& task);
-    bool checkTaskStatus(const Poco::UUID& taskId);
-
-private:
-    std::string host_;
-    int port_;
-};
\ No newline at end of file
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Poco/Net/StreamSocket.h>
+#include "Task.h"
+#include "Protocol.h"
+#include "MessageCodec.h"
+
+// Producer-side client. All calls share one persistent connection, opened on
+// first use and re-opened after a failure. Requests are pipelined: each
+// carries an id, a reader thread matches replies to outstanding futures, and
+// any number of requests may be in flight at once.
+class TaskClient {
+public:
+    TaskClient(const std::string& host, int port, Encoding encoding = Encoding::Json);
+    ~TaskClient();
+
+    TaskClient(const TaskClient&) = delete;
+    TaskClient& operator=(const TaskClient&) = delete;
+
+    // Fire-and-forget single submission.
+    void submitTask(const Task& task);
+    bool checkTaskStatus(const Poco::UUID& taskId);
+
+    // The future resolves with the number of tasks the server accepted, once
+    // they are queued and handed to persistence. It holds an exception if
+    // the connection drops first.
+    std::future<uint32_t> submit(const Task& task);
+    std::future<uint32_t> submitAsync(std::vector<Task> tasks);
+    uint32_t submitBatch(const std::vector<Task>& tasks);
+
+    // Statuses in request order; "UNKNOWN" for ids the server does not know.
+    std::future<std::vector<TaskStatusEntry>> checkStatusAsync(std::vector<Poco::UUID> taskIds);
+    std::vector<TaskStatusEntry> checkStatusBatch(const std::vector<Poco::UUID>& taskIds);
+
+private:
+    void ensureConnected();  // requires mutex_; may release it briefly
+    // Requires mutex_ and a connection. The frame payload is payload + tail.
+    void send(MessageType type, std::string_view payload, std::string_view tail = std::string_view());
+    void readLoop(Poco::Net::StreamSocket socket);
+    void failPending(const std::string& reason);  // requires mutex_
+
+    std::string host_;
+    int port_;
+    Encoding encoding_;
+
+    std::mutex mutex_;  // guards the connection, writes and the pending maps
+    Poco::Net::StreamSocket socket_;
+    bool connected_;
+    std::thread reader_;
+    std::atomic<uint64_t> nextRequestId_;
+    std::map<uint64_t, std::promise<uint32_t>> pendingSubmits_;
+    std::map<uint64_t, std::promise<std::vector<TaskStatusEntry>>> pendingQueries_;
+
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+};
@@ -1,25 +1,62 @@
-#pragma once
-
-#include <memory>
-#include <thread>
-#include <atomic>
-#include "TaskQueue.h"
-#include "LoadBalancer.h"
-
-class TaskDistributor {
-public:
-    TaskDistributor(std::shared_ptr<TaskQueue> taskQueue, 
-                   std::shared_ptr<LoadBalancer> loadBalancer);
-    ~TaskDistributor();
-
-    void start();
-    void stop();
-
-private:
-    void distributeTasks();
-    
-    std::shared_ptr<TaskQueue> taskQueue_;
-    std::shared_ptr<LoadBalancer> loadBalancer_;
-    std::atomic<bool> running_;
-    std::thread distributor_thread_;
-};
\ No newline at end of file
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "TaskQueue.h"
+#include "LoadBalancer.h"
+#include "LeaseManager.h"
+#include "WorkerSession.h"
+
+// Runs one dispatch thread per TaskQueue shard. A thread is woken when a
+// task lands in its shard; when a worker frees up, one thread whose shard
+// has work is woken. A thread whose own shard is empty steals from the
+// others (see TaskQueue::tryGetNextTask(size_t)).
+//
+// Every task sent to a worker is leased (see LeaseManager). When a lease
+// lapses the worker's credit is returned and the task is retried or
+// dead-lettered, so a worker that dies mid-task does not strand it. When
+// the load balancer evicts a dead worker, all of its leases end at once.
+class TaskDistributor {
+public:
+    TaskDistributor(std::shared_ptr<TaskQueue> taskQueue, 
+                   std::shared_ptr<LoadBalancer> loadBalancer,
+                   std::shared_ptr<SessionRegistry> sessions,
+                   std::shared_ptr<LeaseManager> leases);
+    ~TaskDistributor();
+
+    void start();
+    void stop();
+
+    // Wakes every dispatch thread.
+    void notify();
+    // Wakes the thread that owns the given shard.
+    void notify(size_t shard);
+
+private:
+    struct Lane {
+        std::thread thread;
+        std::mutex wakeMutex;
+        std::condition_variable wakeCondition;
+        bool wakeupPending = true;
+    };
+
+    void onWorkerAvailable();
+    void onLeaseExpired(Lease lease);
+    void distributeTasks(size_t shard);
+    size_t dispatchPending(size_t shard);
+    
+    std::shared_ptr<TaskQueue> taskQueue_;
+    std::shared_ptr<LoadBalancer> loadBalancer_;
+    std::shared_ptr<SessionRegistry> sessions_;
+    std::shared_ptr<LeaseManager> leases_;
+    std::atomic<bool> running_;
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    std::atomic<size_t> nextLane_;
+
+    // Safety net in case a wakeup is missed.
+    static constexpr int IDLE_RECHECK_MS = 1000;
+};
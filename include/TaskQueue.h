@@ -1,23 +1,125 @@
-#pragma once
-#include <queue>
-#include <mutex>
-#include <condition_variable>
-#include "Task.h"
-#include "DatabaseManager.h"
-
-class TaskQueue {
-public:
-    TaskQueue();
-    void addTask(const Task& task);
-    void markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId);
-    void assignTaskToWorker(const Poco::UUID& taskId, const Poco::UUID& workerId);
-    Task getNextTask();
-    bool hasTask() const;
-    void markTaskCompleted(const Poco::UUID& taskId);
-
-private:
-    std::queue<Task> tasks_;
-    mutable std::mutex mutex_;
-    std::condition_variable condition_;
-    DatabaseManager dbManager_;
-};
\ No newline at end of file
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "Task.h"
+#include "ReadyQueue.h"
+#include "DatabaseManager.h"
+#include "PersistenceWriter.h"
+#include "EventCount.h"
+#include "TaskClaimer.h"
+
+// Startup: the constructor migrates the schema, replays the WAL and opens a
+// cursor over the backlog, then returns. A recovery thread streams the
+// backlog into the ready queues one fetch at a time, so dispatch starts
+// after the first batch instead of after the last; until recovery finishes,
+// priority order only holds among the tasks loaded so far. Tasks submitted
+// meanwhile are not in the cursor's snapshot and are never published twice.
+//
+// In cluster mode there is no recovery cursor: the backlog belongs to every
+// server, and a TaskClaimer claims batches of it whenever the local ready
+// queues run low. Tasks submitted here are owned by this server from the
+// start. With a WAL the node keeps its id in the WAL directory; after the
+// replay on restart it releases every row it still owns, for any server to
+// claim.
+class TaskQueue {
+public:
+    explicit TaskQueue(const PersistenceOptions& persistence = PersistenceOptions(),
+                       const QueueOptions& queue = QueueOptions(),
+                       const ClusterOptions& cluster = ClusterOptions());
+    // Recovers from backlog instead of the database, which is never
+    // touched: submitted tasks are not persisted and getTaskStatuses()
+    // must not be called. For benchmarks of recovery and enqueue.
+    TaskQueue(std::unique_ptr<PendingTaskCursor> backlog, const QueueOptions& queue);
+    ~TaskQueue();
+
+    // Enqueue runs in two steps:
+    //   1. persist - the INSERT is handed to the write-behind writer outside
+    //      the queue lock (and, with durableEnqueue, committed before returning);
+    //   2. publish - the task is pushed to the in-memory ready queue.
+    // Persisting first means a task's INSERT is always sequenced before the
+    // assignment/completion UPDATEs that can only follow its dispatch.
+    //
+    // Crash semantics: by default a crash may lose tasks accepted within the
+    // last flush interval. With durableEnqueue, addTask returns only once the
+    // row is committed - or, with a WAL directory, once the local log has
+    // synced it - so every accepted task survives a crash. WAL records the
+    // database had not applied are replayed when the queue is constructed.
+    void addTask(const Task& task);
+    // Same two steps for a whole batch: one persistence record (written in
+    // one pipelined transaction) and, with durableEnqueue, one commit wait.
+    void addTasks(const std::vector<Task>& tasks);
+    // Read-your-writes: waits (up to one flush interval) for changes already
+    // recorded to reach the database before querying.
+    std::vector<std::string> getTaskStatuses(const std::vector<Poco::UUID>& taskIds);
+    void markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    void assignTaskToWorker(const Poco::UUID& taskId, const Poco::UUID& workerId);
+    Task getNextTask();
+    std::optional<Task> tryGetNextTask();
+    void requeueTask(const Task& task);
+    // A delivery whose lease lapsed: counts the retry and publishes the
+    // task again, or records it as DEAD_LETTER once it has been retried
+    // maxRetries times. Returns whether it was requeued.
+    bool retryTask(Task task, const Poco::UUID& workerId, int maxRetries);
+    bool hasTask() const;
+    void markTaskCompleted(const Poco::UUID& taskId);
+
+    // Sharding: tasks are spread over shardCount() ready queues by
+    // QueueOptions::shardKey. Each shard is meant to be drained by its own
+    // distributor thread; tryGetNextTask(shard) pops from that shard first
+    // and steals from the others only when it is empty.
+    size_t shardCount() const { return shards_.size(); }
+    size_t shardFor(const Task& task) const;
+    std::optional<Task> tryGetNextTask(size_t shard);
+    bool hasTask(size_t shard) const;
+
+    // Invoked (outside any queue lock) with the shard a task was published to.
+    void setTaskListener(std::function<void(size_t shard)> listener);
+
+    // Wait/hold times of the ready queues' locks, summed over shards.
+    LockStatsSnapshot lockStats() const;
+
+    const DbMetrics& dbMetrics() const { return dbManager_.metrics(); }
+
+    bool recovering() const { return recovering_; }
+    size_t recoveredTasks() const { return recoveredTasks_; }
+    bool waitForRecovery(std::chrono::milliseconds timeout);
+
+    // Cluster mode only; nullptr otherwise.
+    const TaskClaimer* claimer() const { return claimer_.get(); }
+
+private:
+    using Listener = std::function<void(size_t shard)>;
+
+    void publish(Task task);
+    void publishBatch(std::vector<Task>& tasks);
+    void recover(std::unique_ptr<PendingTaskCursor> cursor);
+
+    std::vector<std::unique_ptr<ReadyQueue>> shards_;
+    ShardKey shardKey_;
+    EventCount available_;  // parks getNextTask() callers across all shards
+    std::shared_ptr<const Listener> listener_;  // accessed via std::atomic_load/store
+    bool durableEnqueue_;
+    DatabaseManager dbManager_;
+    PersistenceWriter writer_;  // declared after dbManager_, which it references
+
+    std::mutex recoveryMutex_;
+    std::condition_variable recoveryCondition_;
+    std::atomic<bool> recovering_;
+    std::atomic<bool> stopRecovery_;
+    std::atomic<size_t> recoveredTasks_;
+    std::thread recoveryThread_;
+
+    // Cluster mode: tasks in the ready queues, counted (before each push,
+    // so it never underflows) only when claimer_ is set.
+    std::atomic<size_t> ready_;
+    std::unique_ptr<TaskClaimer> claimer_;  // declared after dbManager_, which it references
+
+    static constexpr int DURABLE_ENQUEUE_TIMEOUT_MS = 5000;
+};
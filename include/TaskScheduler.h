@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include "Task.h"
+
+// Priority scheduler with one FIFO bucket per priority level and a bitmap of
+// non-empty levels. Higher priority values are dispatched first, so tasks
+// recovered from the database in any order still come out by priority.
+//
+// Aging: a task gains one effective priority level for every agingInterval it
+// has waited, so low-priority work is eventually dispatched under sustained
+// high-priority load. Only bucket heads are considered, so push and pop are
+// O(1) (bounded by LEVELS) regardless of how many tasks are queued.
+class TaskScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int LEVELS = 64;
+
+    explicit TaskScheduler(std::chrono::milliseconds agingInterval = std::chrono::seconds(5));
+
+    void push(const Task& task);
+    void push(Task&& task);
+    Task pop();  // requires !empty()
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        Task task;
+        Clock::time_point enqueuedAt;
+    };
+
+    static int levelFor(int priority);
+
+    std::array<std::deque<Entry>, LEVELS> levels_;
+    uint64_t nonEmpty_;
+    size_t size_;
+    std::chrono::milliseconds agingInterval_;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hierarchical timing wheel (Varghese & Lauck, as in the Linux timer
+// wheel). Time advances in fixed ticks; LEVELS wheels of SLOTS slots each
+// cover SLOTS, SLOTS^2, ... ticks. An item goes into the coarsest slot that
+// still separates it from the present and is cascaded into finer wheels as
+// its slot comes round, so schedule() is O(1) and advance() costs O(1) per
+// tick plus the items that expire or cascade.
+//
+// Items cannot be cancelled; owners drop stale ones when they expire (see
+// LeaseManager). Deadlines past the wheel's range are parked in the top
+// wheel and re-placed each time it comes round. Not thread-safe.
+template <class T>
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t(1) << SLOT_BITS;
+    static constexpr size_t LEVELS = 4;
+
+    explicit TimingWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now())
+        : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1))
+        , start_(start)
+        , current_(0)
+        , size_(0) {
+    }
+
+    void schedule(Clock::time_point deadline, T item) {
+        place(Entry{tickOf(deadline), std::move(item)});
+        ++size_;
+    }
+
+    // Processes every tick up to now, appending due items to expired.
+    void advance(Clock::time_point now, std::vector<T>& expired) {
+        if (now < start_) {
+            return;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_);
+        uint64_t target = static_cast<uint64_t>(elapsed / tick_);
+        if (size_ == 0) {
+            current_ = std::max(current_, target + 1);
+            return;
+        }
+        while (current_ <= target) {
+            // Coarsest first: a cascaded entry never lands in a slot that
+            // has already been emptied this tick
+            for (size_t level = LEVELS - 1; level > 0; --level) {
+                if ((current_ & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) == 0) {
+                    cascade(level);
+                }
+            }
+            auto& slot = wheels_[0][current_ & (SLOTS - 1)];
+            for (auto& entry : slot) {
+                expired.push_back(std::move(entry.item));
+            }
+            size_ -= slot.size();
+            slot.clear();
+            ++current_;
+            if (size_ == 0) {
+                current_ = std::max(current_, target + 1);
+            }
+        }
+    }
+
+    size_t size() const { return size_; }
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    struct Entry {
+        uint64_t expiry;  // in ticks since start_
+        T item;
+    };
+
+    uint64_t tickOf(Clock::time_point when) const {
+        if (when <= start_) {
+            return 0;
+        }
+        // Round up so an item never fires before its deadline
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(when - start_ + tick_ - Clock::duration(1));
+        return static_cast<uint64_t>(elapsed / tick_);
+    }
+
+    void place(Entry entry) {
+        uint64_t expiry = std::max(entry.expiry, current_);
+        uint64_t delta = expiry - current_;
+        size_t level = 0;
+        while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+        uint64_t slotTick = expiry;
+        if (delta >= (uint64_t(1) << (SLOT_BITS * LEVELS))) {
+            // Beyond the top wheel: park it as far out as the wheel reaches
+            slotTick = current_ + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+        }
+        wheels_[level][(slotTick >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(std::move(entry));
+    }
+
+    void cascade(size_t level) {
+        auto& slot = wheels_[level][(current_ >> (SLOT_BITS * level)) & (SLOTS - 1)];
+        std::vector<Entry> entries;
+        entries.swap(slot);
+        for (auto& entry : entries) {
+            place(std::move(entry));
+        }
+    }
+
+    const std::chrono::milliseconds tick_;
+    const Clock::time_point start_;
+    uint64_t current_;  // next tick to process
+    size_t size_;
+    std::array<std::array<std::vector<Entry>, SLOTS>, LEVELS> wheels_;
+};
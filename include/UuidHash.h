@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <Poco/UUID.h>
+
+// FNV-1a over the raw UUID bytes, for unordered containers keyed by task
+// or worker id.
+struct UuidHash {
+    size_t operator()(const Poco::UUID& id) const {
+        char bytes[16];
+        id.copyTo(bytes);
+        size_t hash = 14695981039346656037ULL;
+        for (char b : bytes) {
+            hash = (hash ^ static_cast<unsigned char>(b)) * 1099511628211ULL;
+        }
+        return hash;
+    }
+};
@@ -1,24 +1,26 @@
-#pragma once
-#include <string>
-#include <Poco/Net/SocketAddress.h>
-#include <Poco/UUID.h>
-#include <ctime>
-
-class Worker {
-public:
-    Worker(const std::string& address, int port);
-    
-    Poco::UUID getId() const;
-    Poco::Net::SocketAddress getAddress() const;
-    bool isAvailable() const;
-    void setAvailable(bool available);
-    void updateLastHeartbeat();
-    bool isAlive() const;
-
-private:
-    Poco::UUID id_;
-    Poco::Net::SocketAddress address_;
-    bool available_;
-    std::time_t lastHeartbeat_;
-    static constexpr int HEARTBEAT_TIMEOUT = 30; // seconds
+#pragma once
+#include <string>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/UUID.h>
+
+class Worker {
+public:
+    Worker(const std::string& address, int port);
+    // credits: tasks that may be outstanding (sent, not yet completed) at
+    // once; 0 means one per execution slot.
+    Worker(const Poco::UUID& id, const Poco::Net::SocketAddress& address, int capacity = 1, int credits = 0);
+    
+    Poco::UUID getId() const;
+    Poco::Net::SocketAddress getAddress() const;
+    int getCapacity() const;  // concurrent execution slots
+    int getCredits() const;   // prefetch window
+    bool isAvailable() const;
+    void setAvailable(bool available);
+
+private:
+    Poco::UUID id_;
+    Poco::Net::SocketAddress address_;
+    int capacity_;
+    int credits_;
+    bool available_;
 };
\ No newline at end of file
@@ -1,50 +1,128 @@
-#pragma once
-
-#include "Task.h"  // Add this include
-#include <Poco/UUID.h>
-#include <Poco/UUIDGenerator.h>
-#include <Poco/Net/StreamSocket.h>
-#include <Poco/Thread.h>
-#include <string>
-#include <thread>
-#include <atomic>
-#include <random>
-
-class WorkerNode;
-
-class HeartbeatRunnable : public Poco::Runnable {
-public:
-    explicit HeartbeatRunnable(WorkerNode* worker) : worker_(worker) {}
-    void run() override;
-private:
-    WorkerNode* worker_;
-};
-
-class WorkerNode {
-    friend class HeartbeatRunnable;
-public:
-    WorkerNode(const std::string& serverHost, int serverPort);
-    ~WorkerNode();
-
-    void start();
-    void stop();
-    bool isRunning() const { return running_; }
-    void processTask(const Task& task);  // Now Task is properly declared
-    float getCurrentLoad() const { return currentLoad_; }
-    void drawStats() const;
-
-private:
-    void updateLoad();
-
-    std::string serverHost_;
-    int serverPort_;
-    std::atomic<bool> running_;
-    Poco::UUID workerId_;
-    Poco::Net::StreamSocket socket_;
-    Poco::Thread heartbeatThread_;
-    HeartbeatRunnable* heartbeatRunnable_;
-    std::thread taskThread_;
-    std::atomic<float> currentLoad_;
-    std::mt19937 rng_;
-    std::uniform_real_distribution<float> loadDist_;
+#pragma once
+
+#include "Task.h"  // Add this include
+#include "Protocol.h"
+#include "MessageCodec.h"
+#include "BufferPool.h"
+#include <Poco/UUID.h>
+#include <Poco/UUIDGenerator.h>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Thread.h>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+class WorkerNode;
+
+class HeartbeatRunnable : public Poco::Runnable {
+public:
+    explicit HeartbeatRunnable(WorkerNode* worker) : worker_(worker) {}
+    void run() override;
+private:
+    WorkerNode* worker_;
+};
+
+class WorkerNode {
+    friend class HeartbeatRunnable;
+public:
+    // slots: tasks executed concurrently; 0 = one per core.
+    // prefetch: credits granted to the server, i.e. tasks it may send ahead
+    // of completions; 0 = twice the slots, so each slot has one queued.
+    // ioUring: receive through an io_uring IoLoop (epoll where unavailable)
+    // instead of blocking reads.
+    WorkerNode(const std::string& serverHost, int serverPort, size_t slots = 0, size_t prefetch = 0,
+               bool ioUring = false);
+    ~WorkerNode();
+
+    void start();
+    void stop();
+    bool isRunning() const { return running_; }
+    void processTask(const Task& task);  // Now Task is properly declared
+    float getCurrentLoad() const { return currentLoad_; }
+    size_t getSlots() const { return slots_; }
+    size_t getFreeSlots() const;
+    void drawStats() const;
+
+private:
+    void updateLoad();
+    void connect();
+    void disconnect();
+
+    // Three decoupled stages: the receive thread only decodes and queues
+    // tasks, so the socket is always drained; slots_ executor threads run
+    // them; the reporter thread sends completions.
+    void receiveLoop();
+    void receiveWithLoop();
+    void executorLoop();
+    void reporterLoop();
+    void handleFrame(const Frame& frame);
+    void reportCompletion(const Poco::UUID& taskId);
+    // Keeps the server from redelivering tasks this worker still holds
+    void extendLeases();
+    bool sendLocked(MessageType type, const std::string& payload, uint8_t flags);
+
+    // Encodes with the encoding negotiated for the current connection.
+    template <class Message>
+    bool sendMessage(MessageType type, const Message& message) {
+        std::lock_guard<std::mutex> lock(sendMutex_);
+        Encoding encoding = encoding_;
+        std::string& payload = encodeScratch();
+        encodeMessage(payload, message, encoding);
+        return sendLocked(type, payload, frameFlags(encoding));
+    }
+
+    class LoopReceiver;
+
+    std::string serverHost_;
+    int serverPort_;
+    std::atomic<bool> running_;
+    Poco::UUID workerId_;
+
+    // Single persistent session carrying registration, heartbeats, task
+    // pushes and completions. sendMutex_ guards socket_ writes and reconnects.
+    Poco::Net::StreamSocket socket_;
+    std::mutex sendMutex_;
+    std::atomic<bool> connected_;
+    std::atomic<Encoding> encoding_;  // JSON until the server acks binary
+
+    // Completions not yet acknowledged by the server; resent after a reconnect.
+    std::set<Poco::UUID> unackedCompletions_;
+    std::mutex outboxMutex_;
+
+    // Tasks received but not yet picked up by an executor. Their payloads
+    // are sliced from arena_, which only the receiving thread touches.
+    PayloadArena arena_;
+    std::deque<Task> inbox_;
+    std::set<Poco::UUID> runningTasks_;  // also guarded by inboxMutex_
+    mutable std::mutex inboxMutex_;
+    std::condition_variable inboxCondition_;
+
+    // Completions waiting for the reporter thread
+    std::deque<Poco::UUID> completions_;
+    std::mutex completionsMutex_;
+    std::condition_variable completionsCondition_;
+
+    const size_t slots_;
+    const size_t prefetch_;
+    const bool ioUring_;
+    std::atomic<size_t> busySlots_;
+    std::vector<std::thread> executors_;
+    std::thread reporterThread_;
+
+    Poco::Thread heartbeatThread_;
+    HeartbeatRunnable* heartbeatRunnable_;
+    std::thread taskThread_;
+    std::atomic<float> currentLoad_;
+
+    static constexpr int INITIAL_BACKOFF_MS = 100;
+    static constexpr int MAX_BACKOFF_MS = 5000;
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+    static constexpr int RECEIVE_POLL_MS = 1000;
+    // Well inside the server's default 30 s lease timeout
+    static constexpr int LEASE_EXTEND_EVERY_HEARTBEATS = 10;
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include <Poco/UUID.h>
+
+enum class SelectionPolicy {
+    RoundRobin,
+    LeastLoaded,         // lowest score, O(log n)
+    PowerOfTwoChoices,   // better of two random picks, O(1)
+    WeightedRoundRobin   // stride scheduling by weight, O(log n)
+};
+
+// Index of the workers that can take a task right now. LoadBalancer keeps it
+// in sync: update() whenever an eligible worker's score or weight changes,
+// remove() when it stops being eligible. pick() does not remove the worker;
+// the caller updates or removes it after accounting for the new task.
+//
+// score is lower-is-better (reported load plus in-flight share).
+// weight is a positive relative capacity used by WeightedRoundRobin.
+class WorkerSelector {
+public:
+    virtual ~WorkerSelector() = default;
+
+    virtual void update(const Poco::UUID& id, double score, int weight) = 0;
+    virtual void remove(const Poco::UUID& id) = 0;
+    virtual std::optional<Poco::UUID> pick() = 0;
+    virtual size_t size() const = 0;
+
+    static std::unique_ptr<WorkerSelector> create(SelectionPolicy policy);
+};
+
+class RoundRobinSelector : public WorkerSelector {
+public:
+    void update(const Poco::UUID& id, double score, int weight) override;
+    void remove(const Poco::UUID& id) override;
+    std::optional<Poco::UUID> pick() override;
+    size_t size() const override { return workers_.size(); }
+
+private:
+    std::set<Poco::UUID> workers_;
+    Poco::UUID last_;
+};
+
+class LeastLoadedSelector : public WorkerSelector {
+public:
+    void update(const Poco::UUID& id, double score, int weight) override;
+    void remove(const Poco::UUID& id) override;
+    std::optional<Poco::UUID> pick() override;
+    size_t size() const override { return scores_.size(); }
+
+private:
+    std::set<std::pair<double, Poco::UUID>> byScore_;
+    std::map<Poco::UUID, double> scores_;
+};
+
+class PowerOfTwoSelector : public WorkerSelector {
+public:
+    PowerOfTwoSelector();
+
+    void update(const Poco::UUID& id, double score, int weight) override;
+    void remove(const Poco::UUID& id) override;
+    std::optional<Poco::UUID> pick() override;
+    size_t size() const override { return entries_.size(); }
+
+private:
+    struct Entry {
+        Poco::UUID id;
+        double score;
+    };
+
+    // Dense array for O(1) random sampling; the map locates an entry for
+    // swap-with-last removal.
+    std::vector<Entry> entries_;
+    std::map<Poco::UUID, size_t> index_;
+    std::mt19937_64 rng_;
+};
+
+// Stride scheduling: every worker has a virtual "pass"; the lowest pass is
+// picked and advanced by STRIDE / weight, so a worker of weight w is chosen
+// w times as often as one of weight 1.
+class WeightedRoundRobinSelector : public WorkerSelector {
+public:
+    void update(const Poco::UUID& id, double score, int weight) override;
+    void remove(const Poco::UUID& id) override;
+    std::optional<Poco::UUID> pick() override;
+    size_t size() const override { return workers_.size(); }
+
+private:
+    struct State {
+        uint64_t pass;
+        int weight;
+    };
+
+    std::set<std::pair<uint64_t, Poco::UUID>> byPass_;
+    std::map<Poco::UUID, State> workers_;
+    uint64_t globalPass_ = 0;  // pass of the last pick; newcomers start here
+
+    static constexpr uint64_t STRIDE = 1 << 20;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/UUID.h>
+#include "Protocol.h"
+#include "MessageCodec.h"
+#include "Task.h"
+#include "BufferPool.h"
+
+// A long-lived, bidirectional connection to one worker. The distributor pushes
+// tasks through it while the reactor thread writes replies, so writes are
+// serialized by sendMutex_.
+class WorkerSession {
+public:
+    explicit WorkerSession(const Poco::Net::StreamSocket& socket);
+
+    bool send(MessageType type, std::string_view payload, uint8_t flags = 0);
+    bool sendTask(MessageType type, const Task& task);
+
+    // Encodes with the encoding negotiated for this connection.
+    template <class Message>
+    bool sendMessage(MessageType type, const Message& message) {
+        Encoding encoding = encoding_;
+        std::string& payload = encodeScratch();
+        encodeMessage(payload, message, encoding);
+        return send(type, payload, frameFlags(encoding));
+    }
+
+    void setEncoding(Encoding encoding) { encoding_ = encoding; }
+    Encoding encoding() const { return encoding_; }
+    void close();
+    bool isOpen() const { return open_; }
+    Poco::Net::SocketAddress peerAddress() const;
+
+private:
+    bool sendParts(MessageType type, std::string_view head, std::string_view tail, uint8_t flags);
+
+    Poco::Net::StreamSocket socket_;
+    std::mutex sendMutex_;
+    std::atomic<bool> open_;
+    std::atomic<Encoding> encoding_;
+};
+
+// Maps worker ids to their current session. A reconnecting worker rebinds its
+// id to the new session; unbinding only succeeds for the session still bound.
+class SessionRegistry {
+public:
+    void bind(const Poco::UUID& workerId, std::shared_ptr<WorkerSession> session);
+    bool unbind(const Poco::UUID& workerId, const std::shared_ptr<WorkerSession>& session);
+    std::shared_ptr<WorkerSession> find(const Poco::UUID& workerId) const;
+    bool sendTask(const Poco::UUID& workerId, const Task& task);
+
+private:
+    std::map<Poco::UUID, std::shared_ptr<WorkerSession>> sessions_;
+    mutable std::mutex mutex_;
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct WalOptions {
+    std::string directory;
+    size_t segmentBytes = 64 * 1024 * 1024;  // a segment is closed once it grows past this
+    // Extra wait before each sync so more appenders can join the group
+    // (like PostgreSQL's commit_delay). Zero still batches everything that
+    // arrives while the previous sync is running.
+    std::chrono::microseconds commitDelay{0};
+};
+
+// Segmented append-only log on local disk with group commit.
+//
+// append() only copies the record into a buffer; a single writer thread
+// writes whatever has accumulated and makes it durable with one
+// fdatasync, so concurrent appenders share the cost of a sync. Records
+// carry caller-assigned, strictly increasing sequence numbers (LSNs).
+//
+// Files are named wal-<first LSN, 16 hex digits>.log. Each record is
+//   u32 length | u32 CRC-32 of the rest | u64 LSN | payload
+// in host byte order. Recovery maps each segment read-only and replays
+// records until the first torn or corrupt one, then truncates the log
+// there. checkpoint() deletes closed segments whose records have all been
+// applied elsewhere (the database) and closes the open one once it is fully
+// applied too, so the log does not keep replaying work already done.
+class WriteAheadLog {
+public:
+    using Lsn = uint64_t;
+    using Replay = std::function<void(Lsn lsn, std::string_view payload)>;
+
+    explicit WriteAheadLog(const WalOptions& options);  // creates the directory if needed
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Replays every intact record in LSN order and returns the last LSN
+    // (0 for an empty log). Call once, before start().
+    Lsn recover(const Replay& replay);
+
+    void start();
+    void stop();  // syncs whatever was appended
+
+    void append(Lsn lsn, std::string_view payload);
+    bool waitDurable(Lsn lsn, std::chrono::milliseconds timeout);
+    Lsn durableLsn() const { return durableLsn_; }
+
+    // Every record up to lsn has been applied elsewhere; closed segments
+    // that hold nothing newer are deleted. If the open segment holds
+    // nothing newer either, the next write starts a new one, and stop()
+    // deletes it.
+    void checkpoint(Lsn lsn);
+
+    uint64_t syncs() const { return syncs_; }
+    size_t segmentCount() const;
+
+    static constexpr size_t RECORD_HEADER_SIZE = 16;
+
+private:
+    struct Segment {
+        std::string path;
+        Lsn firstLsn;
+        Lsn lastLsn;
+    };
+
+    void run();
+    void writeBatch(const std::string& bytes, Lsn firstLsn, Lsn lastLsn);
+    void openSegment(Lsn firstLsn);
+    void removeApplied(bool includingNewest);  // deletes segments fully covered by checkpointLsn_
+    std::string segmentPath(Lsn firstLsn) const;
+
+    const WalOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::string pending_;
+    Lsn pendingFirst_;
+    Lsn pendingLast_;
+    bool running_;
+
+    // Writer thread only (and recover(), before it starts)
+    int fd_;
+    size_t segmentSize_;
+    std::atomic<bool> rotate_;  // set by checkpoint(): the open segment is fully applied
+
+    mutable std::mutex segmentsMutex_;
+    std::vector<Segment> segments_;  // oldest first; the last one is open
+    Lsn checkpointLsn_;
+
+    std::mutex durableMutex_;
+    std::condition_variable durableCondition_;
+    std::atomic<Lsn> durableLsn_;
+    std::atomic<uint64_t> syncs_;
+
+    std::thread thread_;
+};
@@ -0,0 +1,90 @@
+#include "BlockingExecutor.h"
+#include <algorithm>
+#include <iostream>
+
+BlockingExecutor::BlockingExecutor(size_t threads)
+    : stopping_(false) {
+    for (size_t i = 0; i < std::max<size_t>(1, threads); ++i) {
+        threads_.emplace_back(&BlockingExecutor::run, this);
+    }
+}
+
+BlockingExecutor::~BlockingExecutor() {
+    stop();
+}
+
+void BlockingExecutor::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    condition_.notify_one();
+}
+
+void BlockingExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void BlockingExecutor::run() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        runJob(job);
+    }
+}
+
+void BlockingExecutor::runJob(const std::function<void()>& job) {
+    try {
+        job();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error in background job: " << e.what() << std::endl;
+    }
+}
+
+void BlockingExecutor::Strand::post(std::function<void()> job) {
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+        schedule = !scheduled_;
+        scheduled_ = true;
+    }
+    if (schedule) {
+        auto self = shared_from_this();
+        executor_.post([self] { self->drain(); });
+    }
+}
+
+void BlockingExecutor::Strand::drain() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (jobs_.empty()) {
+                scheduled_ = false;
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        runJob(job);
+    }
+}
@@ -0,0 +1,81 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <cstring>
+
+BufferPool::BufferPool(size_t blockSize, size_t maxCached)
+    : blockSize_(blockSize)
+    , maxCached_(maxCached) {
+}
+
+BufferPool::~BufferPool() {
+    for (char* block : free_) {
+        delete[] block;
+    }
+}
+
+std::shared_ptr<char> BufferPool::acquire() {
+    char* block = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            block = free_.back();
+            free_.pop_back();
+        }
+    }
+    if (!block) {
+        block = new char[blockSize_];
+    }
+    return std::shared_ptr<char>(block, [this](char* released) { release(released); });
+}
+
+void BufferPool::release(char* block) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.size() < maxCached_) {
+            free_.push_back(block);
+            return;
+        }
+    }
+    delete[] block;
+}
+
+size_t BufferPool::cached() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+BufferPool& BufferPool::payloadBlocks() {
+    static BufferPool* pool = new BufferPool(64 * 1024, 256);
+    return *pool;
+}
+
+PayloadArena::PayloadArena(BufferPool& pool)
+    : pool_(pool)
+    , used_(0) {
+}
+
+Task::Payload PayloadArena::copy(std::string_view bytes) {
+    if (bytes.empty()) {
+        return Task::Payload();
+    }
+    if (bytes.size() > pool_.blockSize() / 4) {
+        // Large payload: exact-size block of its own, leaving the current one
+        std::shared_ptr<char> own(new char[bytes.size()], std::default_delete<char[]>());
+        std::memcpy(own.get(), bytes.data(), bytes.size());
+        return Task::Payload(own, own.get());
+    }
+    if (!block_ || pool_.blockSize() - used_ < bytes.size()) {
+        block_ = pool_.acquire();
+        used_ = 0;
+    }
+    char* at = block_.get() + used_;
+    std::memcpy(at, bytes.data(), bytes.size());
+    used_ += bytes.size();
+    return Task::Payload(block_, at);
+}
+
+std::string& encodeScratch() {
+    thread_local std::string scratch;
+    scratch.clear();
+    return scratch;
+}
@@ -1,320 +1,764 @@
-#include <set>
-#include "DatabaseManager.h"
-#include <Poco/Data/PostgreSQL/Connector.h>
-#include <Poco/Data/PostgreSQL/PostgreSQL.h>
-#include <Poco/Data/SessionFactory.h>
-#include <Poco/Data/Statement.h>
-#include <iostream>
-#include <chrono>
-#include <ctime>
-#include <random>
-
-using namespace Poco::Data::Keywords;
-using Poco::Data::Statement;
-using Poco::Data::Session;
-
-DatabaseManager::DatabaseManager() 
-    : sessionPool_(nullptr) {  
-    Poco::Data::PostgreSQL::Connector::registerConnector();
-}
-
-DatabaseManager::~DatabaseManager() {
-    delete sessionPool_;  
-    Poco::Data::PostgreSQL::Connector::unregisterConnector();
-}
-
-const std::string DatabaseManager::CONNECTION_STRING =
-"host=127.0.1.1 port=5433 dbname=taskqueue1 user=yugabyte password=yugabyte";
-
-bool DatabaseManager::init() {
-    try {
-        std::cout << "\n=== Initializing Database Connection ===\n" << std::endl;
-        sessionPool_ = new Poco::Data::SessionPool("PostgreSQL", CONNECTION_STRING, 1, 10, 5);
-        Poco::Data::Session session = sessionPool_->get();
-
-        // Test connection
-        session << "SELECT 1", now;
-        std::cout << "✓ Database connected successfully\n" << std::endl;
-
-        // Create tasks table
-        session << "DROP TABLE IF EXISTS tasks", now;
-        session << "CREATE TABLE tasks ("
-                  "id UUID PRIMARY KEY,"
-                  "name VARCHAR(255),"
-                  "data TEXT,"
-                  "priority INTEGER,"
-                  "status VARCHAR(50) DEFAULT 'PENDING',"
-                  "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
-                  "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
-                  "completed_at TIMESTAMP,"
-                  "assigned_worker UUID,"
-                  "retry_count INTEGER DEFAULT 0,"
-                  "max_retries INTEGER DEFAULT 3"
-                  ")", now;
-
-        std::cout << "✓ Tasks table created successfully\n" << std::endl;
-
-        // Add sample tasks
-        addSampleTasks();
-        return true;
-
-    } catch (const Poco::Exception& exc) {
-        std::cerr << "❌ Database initialization error: " << exc.displayText() << std::endl;
-        return false;
-    } catch (...) {
-        std::cerr << "❌ Unknown error occurred during database initialization." << std::endl;
-        return false;
-    }
-}
-
-
-void DatabaseManager::addSampleTasks() {
-    std::vector<std::pair<std::string, std::string>> sampleTasks = {
-        {"DataProcessing", "Process customer data batch #1234"},
-        {"ImageResizing", "Resize product images for mobile app"},
-        {"EmailCampaign", "Send newsletter to subscribers"},
-        {"DatabaseBackup", "Perform weekly database backup"},
-        {"LogAnalysis", "Analyze system logs for errors"},
-        {"ReportGeneration", "Generate monthly sales report"},
-        {"UserSync", "Synchronize user data with CRM"},
-        {"SecurityScan", "Perform security vulnerability scan"}
-    };
-
-    // Create a set to track used priorities
-    std::set<int> usedPriorities;
-    
-    for (const auto& taskData : sampleTasks) {
-        Task newTask(taskData.first, taskData.second);
-        
-        // Generate a unique random priority
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(1, static_cast<int>(sampleTasks.size()));
-        
-        int priority;
-        do {
-            priority = dis(gen);
-        } while (usedPriorities.find(priority) != usedPriorities.end());
-        
-        usedPriorities.insert(priority);
-        newTask.setPriority(priority);
-        addTask(newTask);
-    }
-    
-    std::cout << "✓ Sample tasks added successfully\n" << std::endl;
-}
-
-std::set<int> assignedPriorities;
-
-
-Task DatabaseManager::getTask(const Poco::UUID& taskId) {
-    try {
-        Session session = sessionPool_->get();
-        std::string id = taskId.toString();
-        std::string name, data, status;
-        int priority;
-
-        Statement select(session);
-        select << "SELECT name, data, status, priority FROM tasks WHERE id = $1",
-            bind(id),
-            into(name),
-            into(data),
-            into(status),
-            into(priority),
-            now;
-
-        Task task(taskId, name, data);
-        task.setPriority(priority);
-        task.setStatus(status);
-        return task;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error getting task: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-void DatabaseManager::updateTaskStatus(const Poco::UUID& taskId, const std::string& status) {
-    try {
-        Session session = sessionPool_->get();
-        std::string id = taskId.toString();
-        bool completed = (status == "COMPLETED");
-        
-        std::string idCopy = id;
-        std::string statusCopy = status;
-
-        session << "UPDATE tasks SET status = ?, updated_at = CURRENT_TIMESTAMP, "
-                  "completed_at = CASE WHEN ? = true THEN CURRENT_TIMESTAMP ELSE NULL END "
-                  "WHERE id = ?",
-            use(statusCopy),
-            use(completed),
-            use(idCopy),
-            now;
-
-        std::cout << "Task " << id << " status updated to: " << status 
-                 << " (completed: " << (completed ? "true" : "false") << ")" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Error updating task status: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-std::vector<Task> DatabaseManager::getPendingTasks() {
-    try {
-        Session session = sessionPool_->get();
-        std::vector<Task> tasks;
-        
-        std::string id, name, data, status;
-        int priority;
-        
-        Statement select(session);
-        select << "SELECT id, name, data, status, priority FROM tasks "
-                 "WHERE status = 'PENDING' ORDER BY priority DESC, created_at ASC",
-            into(id),
-            into(name),
-            into(data),
-            into(status),
-            into(priority),
-            range(0, 1);
-
-        while (!select.done()) {
-            select.execute();
-            Task task(Poco::UUID(id), name, data);
-            task.setPriority(priority);
-            tasks.push_back(task);
-        }
-
-        return tasks;
-    } catch (const std::exception& e) {
-        std::cerr << "Error getting pending tasks: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-// New function to get completed tasks ordered by priority
-std::vector<Task> DatabaseManager::getCompletedTasks() {
-    try {
-        Session session = sessionPool_->get();
-        std::vector<Task> tasks;
-        
-        std::string id, name, data, status;
-        int priority;
-        
-        Statement select(session);
-        select << "SELECT id, name, data, status, priority FROM tasks "
-                 "WHERE status = 'COMPLETED' ORDER BY priority ASC",
-            into(id),
-            into(name),
-            into(data),
-            into(status),
-            into(priority),
-            range(0, 9);
-
-        while (!select.done()) {
-            select.execute();
-            Task task(Poco::UUID(id), name, data);
-            task.setPriority(priority);
-            tasks.push_back(task);
-        }
-
-        return tasks;
-    } catch (const std::exception& e) {
-        std::cerr << "Error getting completed tasks: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-void DatabaseManager::updateTaskAssignment(const Poco::UUID& taskId, const Poco::UUID& workerId, const std::string& status) {
-    try {
-        Session session = sessionPool_->get();
-        std::string id = taskId.toString();
-        std::string worker_id = workerId.toString();
-        std::string statusCopy = status;
-        
-        // Get current timestamp
-        std::string timestamp = Poco::DateTimeFormatter::format(
-            Poco::DateTime(),
-            "%Y-%m-%d %H:%M:%S"
-        );
-
-        session << "UPDATE tasks SET "
-                  "assigned_worker = $1, "
-                  "status = $2, "
-                  "updated_at = CURRENT_TIMESTAMP, "
-                  "completed_at = CASE WHEN $2 = 'COMPLETED' THEN CURRENT_TIMESTAMP ELSE NULL END "
-                  "WHERE id = $3",
-            use(worker_id),
-            use(statusCopy),
-            use(id),
-            now;
-
-        std::cout << "✓ Task " << id << " assigned to worker " << worker_id 
-                  << " with status: " << status << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error updating task assignment: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-void DatabaseManager::markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId) {
-    try {
-        Session session = sessionPool_->get();
-        std::string id = taskId.toString();
-        std::string worker_id = workerId.toString();
-        std::string status = "COMPLETED";
-
-        session << "UPDATE tasks SET "
-                  "status = $1, "
-                  "completed_at = CURRENT_TIMESTAMP, "
-                  "updated_at = CURRENT_TIMESTAMP, "
-                  "assigned_worker = $2 "
-                  "WHERE id = $3",
-            use(status),
-            use(worker_id),
-            use(id),
-            now;
-
-        std::cout << "✓ Task " << id << " marked as completed by worker " << worker_id << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error marking task as completed: " << e.what() << std::endl;
-        throw;
-    }
-}
-
-void DatabaseManager::addTask(const Task& task) {
-    try {
-        Session session = sessionPool_->get();
-
-        std::string id = task.getId().toString();
-        std::string name = task.getName();
-        std::string data = task.getData();
-        std::string status = "PENDING";
-        int priority = task.getPriority();
-        int retryCount = 0;
-        int maxRetries = 3;
-
-        Statement insert(session);
-        insert << "INSERT INTO tasks "
-                  "(id, name, data, status, priority, retry_count, max_retries) "
-                  "VALUES ($1, $2, $3, $4, $5, $6, $7)",
-            bind(id),
-            bind(name),
-            bind(data),
-            bind(status),
-            bind(priority),
-            bind(retryCount),
-            bind(maxRetries);
-
-        insert.execute();
-        std::cout << "✓ Added task: " << name << " (Priority: " << priority << ")" << std::endl;
-    }
-    catch (const Poco::Exception& exc) {
-        std::cerr << "❌ Error adding task: " << exc.displayText() << std::endl;
-        throw;
-    }
-}
-
-
-
+#include <set>
+#include <map>
+#include <algorithm>
+#include "DatabaseManager.h"
+#include <Poco/Data/PostgreSQL/Connector.h>
+#include <Poco/Data/PostgreSQL/PostgreSQL.h>
+#include <Poco/Data/SessionFactory.h>
+#include <Poco/Data/Statement.h>
+#include <Poco/DateTimeFormatter.h>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <stdexcept>
+
+using namespace Poco::Data::Keywords;
+using Poco::Data::Statement;
+using Poco::Data::Session;
+
+DatabaseManager::DatabaseManager() 
+    : sessionPool_(nullptr) {  
+    Poco::Data::PostgreSQL::Connector::registerConnector();
+}
+
+DatabaseManager::~DatabaseManager() {
+    delete sessionPool_;  
+    Poco::Data::PostgreSQL::Connector::unregisterConnector();
+}
+
+const std::string DatabaseManager::CONNECTION_STRING =
+"host=127.0.1.1 port=5433 dbname=taskqueue1 user=yugabyte password=yugabyte";
+
+std::string DatabaseManager::connectionString() {
+    const char* configured = std::getenv("TASKQUEUE_DB");
+    return configured && *configured ? configured : CONNECTION_STRING;
+}
+
+namespace {
+    // Hot queries, prepared once per pooled connection. Parameters are text;
+    // the casts tell the server their types when it prepares them.
+    // WAL replay may repeat inserts the database already has: a task still
+    // open hits ON CONFLICT, one already completed is found in tasks_archive
+    // and must not come back as PENDING.
+    const PreparedQuery INSERT_TASK{
+        "insert_task",
+        "INSERT INTO tasks (id, name, data, status, priority, retry_count, max_retries) "
+        "SELECT $1::uuid, $2::varchar, $3::text, 'PENDING', $4::integer, 0, 3 "
+        "WHERE NOT EXISTS (SELECT 1 FROM tasks_archive WHERE id = $1::uuid) "
+        "ON CONFLICT (id) DO NOTHING"};
+
+    // Cluster mode: the inserting server owns the task; $5 owner, $6 ms
+    const PreparedQuery INSERT_OWNED_TASK{
+        "insert_owned_task",
+        "INSERT INTO tasks (id, name, data, status, priority, retry_count, max_retries, owner, lease_until) "
+        "SELECT $1::uuid, $2::varchar, $3::text, 'PENDING', $4::integer, 0, 3, $5::uuid, "
+        "CURRENT_TIMESTAMP + $6::integer * INTERVAL '1 millisecond' "
+        "WHERE NOT EXISTS (SELECT 1 FROM tasks_archive WHERE id = $1::uuid) "
+        "ON CONFLICT (id) DO NOTHING"};
+
+    // Concurrent claimers lock disjoint rows: SKIP LOCKED passes over rows
+    // another transaction is claiming instead of queueing behind it, and
+    // the owner test is re-checked on the locked row, so a row claimed and
+    // committed meanwhile is not taken twice. The subquery walks
+    // tasks_open_by_priority. $1 owner, $2 rows, $3 ms of ownership.
+    const PreparedQuery CLAIM_TASKS{
+        "claim_tasks",
+        "UPDATE tasks SET owner = $1::uuid, "
+        "lease_until = CURRENT_TIMESTAMP + $3::integer * INTERVAL '1 millisecond' "
+        "WHERE id IN (SELECT id FROM tasks "
+        "WHERE status IN ('PENDING', 'IN_PROGRESS') "
+        "AND (owner IS NULL OR lease_until < CURRENT_TIMESTAMP) "
+        "ORDER BY priority DESC, created_at ASC "
+        "LIMIT $2::integer FOR UPDATE SKIP LOCKED) "
+        "RETURNING id::text, name, data, priority, retry_count"};
+
+    const PreparedQuery RENEW_CLAIMS{
+        "renew_claims",
+        "UPDATE tasks SET lease_until = CURRENT_TIMESTAMP + $2::integer * INTERVAL '1 millisecond' "
+        "WHERE owner = $1::uuid AND status IN ('PENDING', 'IN_PROGRESS')"};
+
+    const PreparedQuery RELEASE_CLAIMS{
+        "release_claims",
+        "UPDATE tasks SET owner = NULL, lease_until = NULL "
+        "WHERE owner = $1::uuid AND status IN ('PENDING', 'IN_PROGRESS')"};
+
+    const PreparedQuery RELEASE_TASKS{
+        "release_tasks",
+        "UPDATE tasks SET owner = NULL, lease_until = NULL "
+        "WHERE owner = $1::uuid AND id = ANY($2::uuid[])"};
+
+    // $4 is the new retry_count, or -1 to leave it alone
+    const PreparedQuery UPDATE_TASK{
+        "update_task",
+        "UPDATE tasks SET "
+        "status = $2::varchar, "
+        "assigned_worker = $3::uuid, "
+        "retry_count = CASE WHEN $4::integer < 0 THEN retry_count ELSE $4::integer END, "
+        "updated_at = CURRENT_TIMESTAMP, "
+        "completed_at = CASE WHEN $2::varchar = 'COMPLETED' THEN CURRENT_TIMESTAMP ELSE NULL END "
+        "WHERE id = $1::uuid"};
+
+    // Cluster mode: leaves rows another node has claimed alone, e.g. when a
+    // restarted node replays WAL records from before its rows were taken
+    // over. $5 owner. Completions are archived regardless: the work is done.
+    const PreparedQuery UPDATE_OWNED_TASK{
+        "update_owned_task",
+        "UPDATE tasks SET "
+        "status = $2::varchar, "
+        "assigned_worker = $3::uuid, "
+        "retry_count = CASE WHEN $4::integer < 0 THEN retry_count ELSE $4::integer END, "
+        "updated_at = CURRENT_TIMESTAMP, "
+        "completed_at = CASE WHEN $2::varchar = 'COMPLETED' THEN CURRENT_TIMESTAMP ELSE NULL END "
+        "WHERE id = $1::uuid AND (owner IS NULL OR owner = $5::uuid)"};
+
+    const PreparedQuery UPDATE_STATUS{
+        "update_status",
+        "UPDATE tasks SET status = $2::varchar, updated_at = CURRENT_TIMESTAMP WHERE id = $1::uuid"};
+
+    // Completion moves the row to tasks_archive, keeping the hot table (and
+    // its pending index) down to work that is still open. $3 as in
+    // UPDATE_TASK. Idempotent: a repeat finds nothing left to delete.
+    const PreparedQuery ARCHIVE_TASK{
+        "archive_task",
+        "WITH done AS (DELETE FROM tasks WHERE id = $1::uuid "
+        "RETURNING id, name, data, priority, created_at, retry_count) "
+        "INSERT INTO tasks_archive "
+        "(id, name, data, priority, status, created_at, completed_at, assigned_worker, retry_count) "
+        "SELECT id, name, data, priority, 'COMPLETED', created_at, CURRENT_TIMESTAMP, $2::uuid, "
+        "CASE WHEN $3::integer < 0 THEN retry_count ELSE $3::integer END FROM done "
+        "ON CONFLICT (id) DO NOTHING"};
+
+    // A task completed outside this queue; replaces its live row if there is one.
+    const PreparedQuery ADD_COMPLETED_TASK{
+        "add_completed_task",
+        "WITH gone AS (DELETE FROM tasks WHERE id = $1::uuid RETURNING created_at, retry_count) "
+        "INSERT INTO tasks_archive "
+        "(id, name, data, priority, status, created_at, completed_at, assigned_worker, retry_count) "
+        "VALUES ($1::uuid, $2, $3, $4::integer, 'COMPLETED', "
+        "COALESCE((SELECT created_at FROM gone), $5::timestamp), $5::timestamp, $6::uuid, "
+        "COALESCE((SELECT retry_count FROM gone), 0)) "
+        "ON CONFLICT (id) DO NOTHING"};
+
+    const PreparedQuery GET_TASK{
+        "get_task",
+        "SELECT name, data, status, priority FROM tasks WHERE id = $1::uuid "
+        "UNION ALL "
+        "SELECT name, data, status, priority FROM tasks_archive WHERE id = $1::uuid"};
+
+    const PreparedQuery GET_STATUSES{
+        "get_statuses",
+        "SELECT id::text, status FROM tasks WHERE id = ANY($1::uuid[]) "
+        "UNION ALL "
+        "SELECT id::text, status FROM tasks_archive WHERE id = ANY($1::uuid[])"};
+}
+
+namespace {
+    // Append only: a released version is never edited, since databases that
+    // already applied it would not see the change.
+    struct Migration {
+        int version;
+        const char* description;
+        std::vector<std::string> statements;
+    };
+
+    constexpr int ARCHIVE_PARTITIONS = 8;
+
+    std::vector<std::string> archiveStatements() {
+        // Hash-partitioned on id, so the primary key (and ON CONFLICT (id))
+        // is enforced per partition and lookups by id touch one partition.
+        std::vector<std::string> statements = {
+            "CREATE TABLE IF NOT EXISTS tasks_archive ("
+            "id UUID NOT NULL,"
+            "name VARCHAR(255),"
+            "data TEXT,"
+            "priority INTEGER,"
+            "status VARCHAR(50) NOT NULL,"
+            "created_at TIMESTAMP,"
+            "completed_at TIMESTAMP,"
+            "assigned_worker UUID,"
+            "retry_count INTEGER DEFAULT 0,"
+            "PRIMARY KEY (id)"
+            ") PARTITION BY HASH (id)"};
+        for (int i = 0; i < ARCHIVE_PARTITIONS; ++i) {
+            statements.push_back("CREATE TABLE IF NOT EXISTS tasks_archive_" + std::to_string(i) +
+                                 " PARTITION OF tasks_archive FOR VALUES WITH (MODULUS " +
+                                 std::to_string(ARCHIVE_PARTITIONS) + ", REMAINDER " + std::to_string(i) + ")");
+        }
+        statements.push_back(
+            "WITH done AS (DELETE FROM tasks WHERE status = 'COMPLETED' "
+            "RETURNING id, name, data, priority, status, created_at, completed_at, assigned_worker, retry_count) "
+            "INSERT INTO tasks_archive "
+            "(id, name, data, priority, status, created_at, completed_at, assigned_worker, retry_count) "
+            "SELECT * FROM done ON CONFLICT (id) DO NOTHING");
+        return statements;
+    }
+
+    const std::vector<Migration>& migrations() {
+        static const std::vector<Migration> all = {
+            {1, "create tasks",
+             {"CREATE TABLE IF NOT EXISTS tasks ("
+              "id UUID PRIMARY KEY,"
+              "name VARCHAR(255),"
+              "data TEXT,"
+              "priority INTEGER,"
+              "status VARCHAR(50) DEFAULT 'PENDING',"
+              "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+              "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,"
+              "completed_at TIMESTAMP,"
+              "assigned_worker UUID,"
+              "retry_count INTEGER DEFAULT 0,"
+              "max_retries INTEGER DEFAULT 3"
+              ")"}},
+            // Partial: only open work is indexed, so the index stays the size
+            // of the backlog. Its order is the recovery cursor's ORDER BY, so
+            // the backlog streams out highest priority first with no sort.
+            // Range-ordered (not hashed) on YugabyteDB because of the DESC.
+            {2, "index open tasks by priority",
+             {"CREATE INDEX IF NOT EXISTS tasks_open_by_priority "
+              "ON tasks (priority DESC, created_at ASC) "
+              "WHERE status IN ('PENDING', 'IN_PROGRESS')"}},
+            {3, "archive completed tasks", archiveStatements()},
+            // Which server owns an open row, and until when (cluster mode).
+            // NULL for rows of a single server, which claims nothing.
+            {4, "claim ownership",
+             {"ALTER TABLE tasks ADD COLUMN IF NOT EXISTS owner UUID",
+              "ALTER TABLE tasks ADD COLUMN IF NOT EXISTS lease_until TIMESTAMP",
+              "CREATE INDEX IF NOT EXISTS tasks_by_owner ON tasks (owner) WHERE owner IS NOT NULL"}},
+        };
+        return all;
+    }
+}
+
+bool DatabaseManager::init() {
+    try {
+        std::cout << "\n=== Initializing Database Connection ===\n" << std::endl;
+        if (!sessionPool_) {
+            std::string connection = connectionString();
+            sessionPool_ = new Poco::Data::SessionPool("PostgreSQL", connection, 1, 10, 5);
+            statements_ = std::make_unique<PgConnectionPool>(connection, PREPARED_CONNECTIONS, metrics_.poolWait);
+        }
+        Poco::Data::Session session = sessionPool_->get();
+
+        // Test connection
+        session << "SELECT 1", now;
+        std::cout << "✓ Database connected successfully\n" << std::endl;
+
+        if (migrate(session)) {
+            // Add sample tasks to a fresh database
+            addSampleTasks();
+        }
+        return true;
+
+    } catch (const Poco::Exception& exc) {
+        std::cerr << "❌ Database initialization error: " << exc.displayText() << std::endl;
+        return false;
+    } catch (...) {
+        std::cerr << "❌ Unknown error occurred during database initialization." << std::endl;
+        return false;
+    }
+}
+
+bool DatabaseManager::migrate(Session& session) {
+    session << "CREATE TABLE IF NOT EXISTS schema_migrations ("
+              "version INTEGER PRIMARY KEY,"
+              "description VARCHAR(255),"
+              "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+              ")", now;
+
+    int current = 0;
+    session << "SELECT COALESCE(MAX(version), 0) FROM schema_migrations", into(current), now;
+    // A database from before schema_migrations has tasks but no versions
+    int missingTasks = 0;
+    session << "SELECT CASE WHEN to_regclass('tasks') IS NULL THEN 1 ELSE 0 END", into(missingTasks), now;
+
+    for (const Migration& migration : migrations()) {
+        if (migration.version <= current) {
+            continue;
+        }
+        // Each migration and its version row commit together
+        session.begin();
+        try {
+            for (const std::string& statement : migration.statements) {
+                session << statement, now;
+            }
+            int version = migration.version;
+            std::string description = migration.description;
+            session << "INSERT INTO schema_migrations (version, description) VALUES ($1, $2)",
+                use(version), use(description), now;
+            session.commit();
+        }
+        catch (...) {
+            session.rollback();
+            // Servers starting together race to apply the same migration;
+            // the losers fail on its version row and carry on from there
+            int applied = 0;
+            session << "SELECT COALESCE(MAX(version), 0) FROM schema_migrations", into(applied), now;
+            if (applied < migration.version) {
+                throw;
+            }
+            std::cout << "✓ Schema migration " << migration.version << " applied by another server" << std::endl;
+            continue;
+        }
+        std::cout << "✓ Applied schema migration " << migration.version << ": " << migration.description
+                  << std::endl;
+    }
+    return missingTasks == 1;
+}
+
+
+void DatabaseManager::addSampleTasks() {
+    std::vector<std::pair<std::string, std::string>> sampleTasks = {
+        {"DataProcessing", "Process customer data batch #1234"},
+        {"ImageResizing", "Resize product images for mobile app"},
+        {"EmailCampaign", "Send newsletter to subscribers"},
+        {"DatabaseBackup", "Perform weekly database backup"},
+        {"LogAnalysis", "Analyze system logs for errors"},
+        {"ReportGeneration", "Generate monthly sales report"},
+        {"UserSync", "Synchronize user data with CRM"},
+        {"SecurityScan", "Perform security vulnerability scan"}
+    };
+
+    // Create a set to track used priorities
+    std::set<int> usedPriorities;
+    
+    for (const auto& taskData : sampleTasks) {
+        Task newTask(taskData.first, taskData.second);
+        
+        // Generate a unique random priority
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_int_distribution<> dis(1, static_cast<int>(sampleTasks.size()));
+        
+        int priority;
+        do {
+            priority = dis(gen);
+        } while (usedPriorities.find(priority) != usedPriorities.end());
+        
+        usedPriorities.insert(priority);
+        newTask.setPriority(priority);
+        addTask(newTask);
+    }
+    
+    std::cout << "✓ Sample tasks added successfully\n" << std::endl;
+}
+
+std::set<int> assignedPriorities;
+
+
+Task DatabaseManager::getTask(const Poco::UUID& taskId) {
+    ScopedLatency latency(metrics_.query(DbQuery::GetTask));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = taskId.toString();
+        PgResult result = connection->execute(GET_TASK, {id.c_str()});
+        if (PQntuples(result.get()) == 0) {
+            throw std::runtime_error("No task " + id);
+        }
+
+        Task task(taskId, PQgetvalue(result.get(), 0, 0), PQgetvalue(result.get(), 0, 1));
+        task.setPriority(std::atoi(PQgetvalue(result.get(), 0, 3)));
+        task.setStatus(parseTaskStatus(PQgetvalue(result.get(), 0, 2)));
+        return task;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error getting task: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::updateTaskStatus(const Poco::UUID& taskId, TaskStatus status) {
+    ScopedLatency latency(metrics_.query(DbQuery::UpdateStatus));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = taskId.toString();
+        const char* statusName = taskStatusName(status);
+        if (status == TaskStatus::Completed) {
+            connection->execute(ARCHIVE_TASK, {id.c_str(), nullptr, "-1"});
+        } else {
+            connection->execute(UPDATE_STATUS, {id.c_str(), statusName});
+        }
+
+        std::cout << "Task " << id << " status updated to: " << statusName
+                 << " (completed: " << (status == TaskStatus::Completed ? "true" : "false") << ")" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error updating task status: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+std::vector<Task> DatabaseManager::getPendingTasks() {
+    std::vector<Task> tasks;
+    auto cursor = openPendingTasks();
+    while (cursor->fetch(RECOVERY_FETCH_ROWS, tasks)) {
+    }
+    return tasks;
+}
+
+namespace {
+    class DbPendingTaskCursor : public PendingTaskCursor {
+    public:
+        explicit DbPendingTaskCursor(Session session);
+        ~DbPendingTaskCursor() override;
+
+        bool fetch(size_t maxRows, std::vector<Task>& out) override;
+
+    private:
+        Session session_;
+        PayloadArena arena_;  // recovered payloads are packed into shared blocks
+        bool done_;
+    };
+}
+
+DbPendingTaskCursor::DbPendingTaskCursor(Session session)
+    : session_(session)
+    , done_(false) {
+}
+
+DbPendingTaskCursor::~DbPendingTaskCursor() {
+    try {
+        // Read-only: ending the transaction closes the cursor
+        session_.rollback();
+    }
+    catch (const Poco::Exception& exc) {
+        std::cerr << "Error closing pending task cursor: " << exc.displayText() << std::endl;
+    }
+}
+
+bool DbPendingTaskCursor::fetch(size_t maxRows, std::vector<Task>& out) {
+    if (done_) {
+        return false;
+    }
+    std::vector<std::string> ids, names, data;
+    std::vector<int> priorities, retryCounts;
+    Statement select(session_);
+    select << "FETCH FORWARD " + std::to_string(maxRows) + " FROM pending_tasks",
+        into(ids), into(names), into(data), into(priorities), into(retryCounts), now;
+
+    out.reserve(out.size() + ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        Task task(Poco::UUID(ids[i]), names[i], arena_.copy(data[i]), data[i].size());
+        task.setPriority(priorities[i]);
+        task.setRetryCount(retryCounts[i]);
+        out.push_back(std::move(task));
+    }
+    done_ = ids.size() < maxRows;
+    return !ids.empty();
+}
+
+std::unique_ptr<PendingTaskCursor> DatabaseManager::openPendingTasks() {
+    try {
+        Session session = sessionPool_->get();
+        session.begin();
+        // IN_PROGRESS rows were delivered by a previous run whose leases
+        // died with it, so they are redelivered too. The filter and order
+        // match tasks_open_by_priority, so rows come off the index without a
+        // sort and the first batch holds the most urgent work.
+        session << "DECLARE pending_tasks NO SCROLL CURSOR FOR "
+                  "SELECT id::text, name, data, priority, retry_count FROM tasks "
+                  "WHERE status IN ('PENDING', 'IN_PROGRESS') "
+                  "ORDER BY priority DESC, created_at ASC", now;
+        return std::make_unique<DbPendingTaskCursor>(session);
+    }
+    catch (const Poco::Exception& exc) {
+        std::cerr << "❌ Error opening pending task cursor: " << exc.displayText() << std::endl;
+        throw;
+    }
+}
+
+// New function to get completed tasks ordered by priority
+std::vector<Task> DatabaseManager::getCompletedTasks() {
+    try {
+        Session session = sessionPool_->get();
+        std::vector<Task> tasks;
+        
+        std::string id, name, data, status;
+        int priority;
+        
+        Statement select(session);
+        select << "SELECT id, name, data, status, priority FROM tasks_archive "
+                 "ORDER BY priority ASC",
+            into(id),
+            into(name),
+            into(data),
+            into(status),
+            into(priority),
+            range(0, 9);
+
+        while (!select.done()) {
+            select.execute();
+            Task task(Poco::UUID(id), name, data);
+            task.setPriority(priority);
+            tasks.push_back(task);
+        }
+
+        return tasks;
+    } catch (const std::exception& e) {
+        std::cerr << "Error getting completed tasks: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::updateTaskAssignment(const Poco::UUID& taskId, const Poco::UUID& workerId, TaskStatus status) {
+    ScopedLatency latency(metrics_.query(DbQuery::AssignTask));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = taskId.toString();
+        std::string worker_id = workerId.toString();
+        const char* statusName = taskStatusName(status);
+        if (status == TaskStatus::Completed) {
+            connection->execute(ARCHIVE_TASK, {id.c_str(), worker_id.c_str(), "-1"});
+        } else {
+            if (claimOwner_.empty()) {
+                connection->execute(UPDATE_TASK, {id.c_str(), statusName, worker_id.c_str(), "-1"});
+            } else {
+                connection->execute(UPDATE_OWNED_TASK, {id.c_str(), statusName, worker_id.c_str(), "-1",
+                                                        claimOwner_.c_str()});
+            }
+        }
+
+        std::cout << "✓ Task " << id << " assigned to worker " << worker_id
+                  << " with status: " << statusName << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error updating task assignment: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    ScopedLatency latency(metrics_.query(DbQuery::CompleteTask));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = taskId.toString();
+        std::string worker_id = workerId.toString();
+        connection->execute(ARCHIVE_TASK, {id.c_str(), worker_id.c_str(), "-1"});
+
+        std::cout << "✓ Task " << id << " marked as completed by worker " << worker_id << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error marking task as completed: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::addCompletedTask(const Task& task, const std::string& workerId,
+                                       const Poco::DateTime& completedAt) {
+    ScopedLatency latency(metrics_.query(DbQuery::AddCompletedTask));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = task.getId().toString();
+        std::string data(task.getData());
+        std::string priority = std::to_string(task.getPriority());
+        std::string timestamp = Poco::DateTimeFormatter::format(completedAt, "%Y-%m-%d %H:%M:%S.%F");
+        connection->execute(ADD_COMPLETED_TASK, {id.c_str(), task.getName().c_str(), data.c_str(), priority.c_str(),
+                                                 timestamp.c_str(), workerId.empty() ? nullptr : workerId.c_str()});
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error archiving completed task: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::addTask(const Task& task) {
+    ScopedLatency latency(metrics_.query(DbQuery::AddTask));
+    try {
+        auto connection = statements_->acquire();
+        std::string id = task.getId().toString();
+        std::string data(task.getData());
+        std::string priority = std::to_string(task.getPriority());
+        if (claimOwner_.empty()) {
+            connection->execute(INSERT_TASK, {id.c_str(), task.getName().c_str(), data.c_str(), priority.c_str()});
+        } else {
+            connection->execute(INSERT_OWNED_TASK, {id.c_str(), task.getName().c_str(), data.c_str(),
+                                                    priority.c_str(), claimOwner_.c_str(),
+                                                    claimOwnershipMs_.c_str()});
+        }
+        std::cout << "✓ Added task: " << task.getName() << " (Priority: " << priority << ")" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error adding task: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+
+
+
+void DatabaseManager::persistBatch(const std::vector<Task>& inserts, const std::vector<TaskUpdate>& updates) {
+    ScopedLatency latency(metrics_.query(DbQuery::PersistBatch));
+    try {
+        auto connection = statements_->acquire();
+        PgPipeline pipeline(*connection);
+        for (const Task& task : inserts) {
+            if (claimOwner_.empty()) {
+                pipeline.add(INSERT_TASK, {task.getId().toString(), task.getName(), std::string(task.getData()),
+                                           std::to_string(task.getPriority())});
+            } else {
+                pipeline.add(INSERT_OWNED_TASK, {task.getId().toString(), task.getName(),
+                                                 std::string(task.getData()), std::to_string(task.getPriority()),
+                                                 claimOwner_, claimOwnershipMs_});
+            }
+        }
+        for (const TaskUpdate& update : updates) {
+            if (update.status == TaskStatus::Completed) {
+                pipeline.add(ARCHIVE_TASK, {update.taskId.toString(), update.workerId.toString(),
+                                            std::to_string(update.retryCount)});
+            } else if (claimOwner_.empty()) {
+                pipeline.add(UPDATE_TASK, {update.taskId.toString(), taskStatusName(update.status),
+                                           update.workerId.toString(), std::to_string(update.retryCount)});
+            } else {
+                pipeline.add(UPDATE_OWNED_TASK, {update.taskId.toString(), taskStatusName(update.status),
+                                                 update.workerId.toString(), std::to_string(update.retryCount),
+                                                 claimOwner_});
+            }
+        }
+        pipeline.run();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error persisting batch: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+std::vector<std::string> DatabaseManager::getTaskStatuses(const std::vector<Poco::UUID>& taskIds) {
+    ScopedLatency latency(metrics_.query(DbQuery::GetStatuses));
+    try {
+        auto connection = statements_->acquire();
+        std::map<Poco::UUID, std::string> found;
+
+        for (size_t offset = 0; offset < taskIds.size(); offset += MAX_ROWS_PER_STATEMENT) {
+            size_t end = std::min(taskIds.size(), offset + MAX_ROWS_PER_STATEMENT);
+            // One array parameter, so the statement is the same for any count
+            std::string ids = "{";
+            for (size_t i = offset; i < end; ++i) {
+                if (i > offset) {
+                    ids += ",";
+                }
+                ids += taskIds[i].toString();
+            }
+            ids += "}";
+
+            PgResult result = connection->execute(GET_STATUSES, {ids.c_str()});
+            for (int row = 0; row < PQntuples(result.get()); ++row) {
+                found[Poco::UUID(PQgetvalue(result.get(), row, 0))] = PQgetvalue(result.get(), row, 1);
+            }
+        }
+
+        std::vector<std::string> result;
+        result.reserve(taskIds.size());
+        for (const auto& taskId : taskIds) {
+            auto it = found.find(taskId);
+            result.push_back(it != found.end() ? it->second : "UNKNOWN");
+        }
+        return result;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error getting task statuses: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+void DatabaseManager::setClaimOwner(const Poco::UUID& owner, std::chrono::milliseconds ownership) {
+    claimOwner_ = owner.toString();
+    claimOwnershipMs_ = std::to_string(ownership.count());
+}
+
+std::vector<Task> DatabaseManager::claimTasks(const Poco::UUID& owner, size_t limit,
+                                              std::chrono::milliseconds ownership) {
+    ScopedLatency latency(metrics_.query(DbQuery::ClaimTasks));
+    try {
+        auto connection = statements_->acquire();
+        std::string ownerId = owner.toString();
+        std::string rows = std::to_string(limit);
+        std::string ownershipMs = std::to_string(ownership.count());
+        PgResult result = connection->execute(CLAIM_TASKS, {ownerId.c_str(), rows.c_str(), ownershipMs.c_str()});
+
+        std::vector<Task> tasks;
+        try {
+            tasks.reserve(PQntuples(result.get()));
+            for (int row = 0; row < PQntuples(result.get()); ++row) {
+                Task task(Poco::UUID(PQgetvalue(result.get(), row, 0)), PQgetvalue(result.get(), row, 1),
+                          PQgetvalue(result.get(), row, 2));
+                task.setPriority(std::atoi(PQgetvalue(result.get(), row, 3)));
+                task.setRetryCount(std::atoi(PQgetvalue(result.get(), row, 4)));
+                tasks.push_back(std::move(task));
+            }
+        }
+        catch (...) {
+            // The claim has committed: give the rows back, or renewal would
+            // keep them owned here and never dispatched
+            std::string ids = "{";
+            for (int row = 0; row < PQntuples(result.get()); ++row) {
+                if (row > 0) {
+                    ids += ",";
+                }
+                ids += PQgetvalue(result.get(), row, 0);
+            }
+            ids += "}";
+            connection->execute(RELEASE_TASKS, {ownerId.c_str(), ids.c_str()});
+            throw;
+        }
+        // UPDATE ... RETURNING does not keep the subquery's order
+        std::stable_sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) {
+            return a.getPriority() > b.getPriority();
+        });
+        return tasks;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error claiming tasks: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+size_t DatabaseManager::renewClaims(const Poco::UUID& owner, std::chrono::milliseconds ownership) {
+    ScopedLatency latency(metrics_.query(DbQuery::RenewClaims));
+    try {
+        auto connection = statements_->acquire();
+        std::string ownerId = owner.toString();
+        std::string ownershipMs = std::to_string(ownership.count());
+        PgResult result = connection->execute(RENEW_CLAIMS, {ownerId.c_str(), ownershipMs.c_str()});
+        return std::strtoul(PQcmdTuples(result.get()), nullptr, 10);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error renewing claims: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+size_t DatabaseManager::releaseClaims(const Poco::UUID& owner) {
+    ScopedLatency latency(metrics_.query(DbQuery::ReleaseClaims));
+    try {
+        auto connection = statements_->acquire();
+        std::string ownerId = owner.toString();
+        PgResult result = connection->execute(RELEASE_CLAIMS, {ownerId.c_str()});
+        return std::strtoul(PQcmdTuples(result.get()), nullptr, 10);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error releasing claims: " << e.what() << std::endl;
+        throw;
+    }
+}
+
+size_t DatabaseManager::releaseTasks(const Poco::UUID& owner, const std::vector<Poco::UUID>& taskIds) {
+    ScopedLatency latency(metrics_.query(DbQuery::ReleaseClaims));
+    try {
+        auto connection = statements_->acquire();
+        std::string ownerId = owner.toString();
+        std::string ids = "{";
+        for (size_t i = 0; i < taskIds.size(); ++i) {
+            if (i > 0) {
+                ids += ",";
+            }
+            ids += taskIds[i].toString();
+        }
+        ids += "}";
+        PgResult result = connection->execute(RELEASE_TASKS, {ownerId.c_str(), ids.c_str()});
+        return std::strtoul(PQcmdTuples(result.get()), nullptr, 10);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "❌ Error releasing claimed tasks: " << e.what() << std::endl;
+        throw;
+    }
+}
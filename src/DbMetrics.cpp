@@ -0,0 +1,62 @@
+#include "DbMetrics.h"
+#include <cstdio>
+
+uint64_t LatencySnapshot::percentileNs(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * double(count));
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            // The last bucket is open-ended; maxNs bounds every bucket anyway
+            uint64_t upper = (uint64_t(1) << (i + 1)) - 1;
+            return upper < maxNs ? upper : maxNs;
+        }
+    }
+    return maxNs;
+}
+
+const char* dbQueryName(DbQuery query) {
+    switch (query) {
+        case DbQuery::AddTask: return "add_task";
+        case DbQuery::GetTask: return "get_task";
+        case DbQuery::UpdateStatus: return "update_status";
+        case DbQuery::AssignTask: return "assign_task";
+        case DbQuery::CompleteTask: return "complete_task";
+        case DbQuery::PersistBatch: return "persist_batch";
+        case DbQuery::GetStatuses: return "get_statuses";
+        case DbQuery::AddCompletedTask: return "add_completed";
+        case DbQuery::ClaimTasks: return "claim_tasks";
+        case DbQuery::RenewClaims: return "renew_claims";
+        case DbQuery::ReleaseClaims: return "release_claims";
+        case DbQuery::Count: break;
+    }
+    return "unknown";
+}
+
+namespace {
+    void appendLine(std::string& out, const char* name, const LatencySnapshot& s) {
+        if (s.count == 0) {
+            return;
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-14s %10llu  avg %9.1f  p50 %9.1f  p99 %9.1f  max %9.1f\n", name,
+                      static_cast<unsigned long long>(s.count), s.averageNs() / 1000.0,
+                      s.percentileNs(0.5) / 1000.0, s.percentileNs(0.99) / 1000.0, s.maxNs / 1000.0);
+        out += line;
+    }
+}
+
+std::string DbMetrics::report() const {
+    std::string out = "Database latency (calls, us):\n";
+    for (size_t i = 0; i < queries.size(); ++i) {
+        appendLine(out, dbQueryName(static_cast<DbQuery>(i)), queries[i].snapshot());
+    }
+    appendLine(out, "pool_wait", poolWait.snapshot());
+    return out;
+}
@@ -0,0 +1,141 @@
+#include "FailureDetector.h"
+#include <iostream>
+
+FailureDetector::FailureDetector(const FailureDetectorOptions& options)
+    : options_(options)
+    , wheel_(options.tick)
+    , nextGeneration_(0)
+    , running_(false) {
+}
+
+FailureDetector::~FailureDetector() {
+    stop();
+}
+
+void FailureDetector::start() {
+    std::lock_guard<std::mutex> lock(sweepMutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&FailureDetector::run, this);
+}
+
+void FailureDetector::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex_);
+        running_ = false;
+    }
+    sweepCondition_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void FailureDetector::track(const Poco::UUID& workerId) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t generation = ++nextGeneration_;
+    workers_.insert_or_assign(workerId, Watch{now, WorkerHealth::Alive, generation});
+    wheel_.schedule(now + options_.suspectAfter, Timer{workerId, generation});
+}
+
+void FailureDetector::forget(const Poco::UUID& workerId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    workers_.erase(workerId);
+}
+
+bool FailureDetector::heartbeat(const Poco::UUID& workerId) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = workers_.find(workerId);
+    if (it == workers_.end()) {
+        return false;
+    }
+    it->second.lastSeen = now;
+    if (it->second.health == WorkerHealth::Suspect) {
+        // The pending entry is the dead-after one; it reschedules itself.
+        it->second.health = WorkerHealth::Alive;
+    }
+    return true;
+}
+
+WorkerHealth FailureDetector::health(const Poco::UUID& workerId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = workers_.find(workerId);
+    return it != workers_.end() ? it->second.health : WorkerHealth::Dead;
+}
+
+size_t FailureDetector::expire(Clock::time_point now) {
+    std::vector<Timer> due;
+    std::vector<Poco::UUID> changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wheel_.advance(now, due);
+        for (const Timer& timer : due) {
+            auto it = workers_.find(timer.workerId);
+            if (it == workers_.end() || it->second.generation != timer.generation) {
+                continue;
+            }
+            Watch& watch = it->second;
+            Clock::duration silent = now - watch.lastSeen;
+            if (silent >= options_.deadAfter) {
+                workers_.erase(it);
+                changed.push_back(timer.workerId);
+                continue;
+            }
+            if (silent >= options_.suspectAfter) {
+                if (watch.health != WorkerHealth::Suspect) {
+                    watch.health = WorkerHealth::Suspect;
+                    changed.push_back(timer.workerId);
+                }
+                wheel_.schedule(watch.lastSeen + options_.deadAfter, timer);
+                continue;
+            }
+            wheel_.schedule(watch.lastSeen + options_.suspectAfter, timer);
+        }
+    }
+
+    auto listener = std::atomic_load(&listener_);
+    if (listener) {
+        for (const auto& workerId : changed) {
+            (*listener)(workerId);
+        }
+    }
+    return changed.size();
+}
+
+void FailureDetector::setListener(Listener listener) {
+    std::shared_ptr<const Listener> shared;
+    if (listener) {
+        shared = std::make_shared<const Listener>(std::move(listener));
+    }
+    std::atomic_store(&listener_, std::move(shared));
+}
+
+void FailureDetector::run() {
+    std::unique_lock<std::mutex> lock(sweepMutex_);
+    while (running_) {
+        sweepCondition_.wait_for(lock, options_.tick, [this] { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+        try {
+            expire(Clock::now());
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error checking worker heartbeats: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+const char* workerHealthName(WorkerHealth health) {
+    switch (health) {
+        case WorkerHealth::Alive: return "alive";
+        case WorkerHealth::Suspect: return "suspect";
+        case WorkerHealth::Dead: return "dead";
+    }
+    return "unknown";
+}
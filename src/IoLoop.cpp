@@ -0,0 +1,171 @@
+#include "IoLoop.h"
+#include <cerrno>
+#include <iostream>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef TASKQUEUE_HAVE_IO_URING
+// Defined in IoUringLoop.cpp; returns nullptr if the kernel refuses.
+std::unique_ptr<IoLoop> makeIoUringLoop();
+#endif
+
+namespace {
+    [[noreturn]] void throwErrno(const char* what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    // Level-triggered epoll with one recv per readiness event, like the
+    // Poco reactor it replaces. Reads use MSG_DONTWAIT so a stale event for
+    // a descriptor that was just closed and reused cannot block the loop.
+    class EpollLoop : public IoLoop {
+    public:
+        EpollLoop()
+            : epollFd_(epoll_create1(EPOLL_CLOEXEC))
+            , wakeFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+            , buffer_(READ_BUFFER_SIZE) {
+            if (epollFd_ < 0 || wakeFd_ < 0) {
+                throwErrno("epoll loop");
+            }
+            watch(wakeFd_);
+        }
+
+        ~EpollLoop() override {
+            close(wakeFd_);
+            close(epollFd_);
+        }
+
+        IoBackend backend() const override { return IoBackend::Epoll; }
+
+        void listen(int fd, AcceptHandler onAccept) override {
+            // Another loop may win the race for a pending connection
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            listeners_[fd] = std::move(onAccept);
+            watch(fd);
+        }
+
+        void add(int fd, std::unique_ptr<IoHandler> handler) override {
+            handlers_[fd] = std::move(handler);
+            watch(fd);
+        }
+
+        void runOnce(int timeoutMs) override {
+            epoll_event events[MAX_EVENTS];
+            int n = epoll_wait(epollFd_, events, MAX_EVENTS, timeoutMs);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    return;
+                }
+                throwErrno("epoll_wait");
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd_) {
+                    uint64_t value;
+                    ssize_t ignored = read(wakeFd_, &value, sizeof(value));
+                    (void)ignored;
+                } else if (listeners_.count(fd)) {
+                    accept(fd);
+                } else {
+                    receive(fd);
+                }
+            }
+        }
+
+    protected:
+        void wake() override {
+            uint64_t one = 1;
+            ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+            (void)ignored;
+        }
+
+    private:
+        void watch(int fd) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                throwErrno("epoll_ctl");
+            }
+        }
+
+        void accept(int listenFd) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    std::cerr << "Error accepting connection: " << std::generic_category().message(errno) << std::endl;
+                }
+                return;
+            }
+            auto handler = listeners_[listenFd](fd);
+            if (handler) {
+                add(fd, std::move(handler));
+            }
+        }
+
+        void receive(int fd) {
+            auto it = handlers_.find(fd);
+            if (it == handlers_.end()) {
+                return;
+            }
+            ssize_t n = recv(fd, buffer_.data(), buffer_.size(), MSG_DONTWAIT);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                return;
+            }
+            if (n > 0 && it->second->onData(buffer_.data(), static_cast<size_t>(n))) {
+                return;
+            }
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+            std::unique_ptr<IoHandler> handler = std::move(it->second);
+            handlers_.erase(it);
+            handler->onClose();
+        }
+
+        static constexpr int MAX_EVENTS = 256;
+        static constexpr size_t READ_BUFFER_SIZE = 64 * 1024;
+
+        int epollFd_;
+        int wakeFd_;
+        std::vector<char> buffer_;
+        std::unordered_map<int, AcceptHandler> listeners_;
+        std::unordered_map<int, std::unique_ptr<IoHandler>> handlers_;
+    };
+}
+
+std::unique_ptr<IoLoop> IoLoop::create(IoBackend preferred) {
+    if (preferred == IoBackend::IoUring) {
+#ifdef TASKQUEUE_HAVE_IO_URING
+        if (auto loop = makeIoUringLoop()) {
+            return loop;
+        }
+        std::cerr << "io_uring is not available on this kernel, falling back to epoll" << std::endl;
+#else
+        std::cerr << "Built without io_uring support (WITH_IO_URING), falling back to epoll" << std::endl;
+#endif
+    }
+    return std::make_unique<EpollLoop>();
+}
+
+void IoLoop::run() {
+    while (!stopping_) {
+        runOnce(-1);
+    }
+}
+
+void IoLoop::stop() {
+    stopping_ = true;
+    wake();
+}
+
+const char* ioBackendName(IoBackend backend) {
+    switch (backend) {
+        case IoBackend::Epoll: return "epoll";
+        case IoBackend::IoUring: return "io_uring";
+    }
+    return "unknown";
+}
@@ -0,0 +1,269 @@
+// io_uring backend for IoLoop; only built with WITH_IO_URING (liburing >= 2.4).
+#include "IoLoop.h"
+#include <liburing.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+std::unique_ptr<IoLoop> makeIoUringLoop();
+
+namespace {
+    // Every request carries its kind and a connection id in user_data. Ids
+    // are never reused, so a late completion cannot reach a newer
+    // connection that happens to get the same descriptor.
+    enum class Op : uint64_t { Wake, Accept, Recv, Cancel };
+
+    uint64_t tag(Op op, uint64_t id) {
+        return (static_cast<uint64_t>(op) << 56) | id;
+    }
+    Op tagOp(uint64_t data) { return static_cast<Op>(data >> 56); }
+    uint64_t tagId(uint64_t data) { return data & ((uint64_t(1) << 56) - 1); }
+
+    // Multishot recv needs 6.0; buffer rings and multishot accept 5.19.
+    bool kernelSupportsMultishotRecv() {
+        utsname name{};
+        int major = 0;
+        int minor = 0;
+        return uname(&name) == 0 && std::sscanf(name.release, "%d.%d", &major, &minor) == 2 && major >= 6;
+    }
+
+    // Accepts and receives with multishot requests, so one submission keeps
+    // delivering until the socket closes. Received data lands in a buffer
+    // ring registered with the kernel; each buffer goes back to the ring as
+    // soon as its handler returns. New and re-armed requests are only queued
+    // here and reach the kernel together in the next runOnce().
+    class IoUringLoop : public IoLoop {
+    public:
+        IoUringLoop() : ringReady_(false), bufferRing_(nullptr), buffers_(BUFFER_COUNT * BUFFER_SIZE), wakeFd_(-1), wakeValue_(0), nextId_(1) {}
+
+        ~IoUringLoop() override {
+            if (ringReady_) {
+                if (bufferRing_) {
+                    io_uring_free_buf_ring(&ring_, bufferRing_, BUFFER_COUNT, BUFFER_GROUP);
+                }
+                io_uring_queue_exit(&ring_);
+            }
+            if (wakeFd_ >= 0) {
+                close(wakeFd_);
+            }
+        }
+
+        // Returns false if the kernel lacks any of the required features.
+        bool init() {
+            if (io_uring_queue_init(QUEUE_DEPTH, &ring_, 0) < 0) {
+                return false;
+            }
+            ringReady_ = true;
+            int ret = 0;
+            bufferRing_ = io_uring_setup_buf_ring(&ring_, BUFFER_COUNT, BUFFER_GROUP, 0, &ret);
+            if (!bufferRing_) {
+                return false;
+            }
+            for (unsigned i = 0; i < BUFFER_COUNT; ++i) {
+                io_uring_buf_ring_add(bufferRing_, buffers_.data() + i * BUFFER_SIZE, BUFFER_SIZE, i,
+                                      io_uring_buf_ring_mask(BUFFER_COUNT), i);
+            }
+            io_uring_buf_ring_advance(bufferRing_, BUFFER_COUNT);
+
+            wakeFd_ = eventfd(0, EFD_CLOEXEC);
+            if (wakeFd_ < 0) {
+                return false;
+            }
+            armWake();
+            return true;
+        }
+
+        IoBackend backend() const override { return IoBackend::IoUring; }
+
+        void listen(int fd, AcceptHandler onAccept) override {
+            uint64_t id = nextId_++;
+            listeners_[id] = Listener{fd, std::move(onAccept)};
+            armAccept(id, fd);
+        }
+
+        void add(int fd, std::unique_ptr<IoHandler> handler) override {
+            uint64_t id = nextId_++;
+            connections_[id] = Connection{fd, std::move(handler), false};
+            armRecv(id, fd);
+        }
+
+        void runOnce(int timeoutMs) override {
+            io_uring_cqe* cqe = nullptr;
+            __kernel_timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000LL};
+            int ret = io_uring_submit_and_wait_timeout(&ring_, &cqe, 1, timeoutMs >= 0 ? &timeout : nullptr, nullptr);
+            if (ret < 0 && ret != -ETIME && ret != -EINTR) {
+                throw std::system_error(-ret, std::generic_category(), "io_uring_submit_and_wait_timeout");
+            }
+
+            unsigned head;
+            unsigned seen = 0;
+            io_uring_for_each_cqe(&ring_, head, cqe) {
+                ++seen;
+                complete(*cqe);
+            }
+            io_uring_cq_advance(&ring_, seen);
+        }
+
+    protected:
+        void wake() override {
+            uint64_t one = 1;
+            ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+            (void)ignored;
+        }
+
+    private:
+        struct Listener {
+            int fd;
+            AcceptHandler onAccept;
+        };
+
+        struct Connection {
+            int fd;
+            std::unique_ptr<IoHandler> handler;
+            bool closing;  // cancel requested; waiting for the final completion
+        };
+
+        io_uring_sqe* nextSqe() {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+            if (!sqe) {
+                // Submission queue full: flush what is queued and retry
+                io_uring_submit(&ring_);
+                sqe = io_uring_get_sqe(&ring_);
+            }
+            if (!sqe) {
+                throw std::runtime_error("io_uring submission queue exhausted");
+            }
+            return sqe;
+        }
+
+        void armWake() {
+            io_uring_sqe* sqe = nextSqe();
+            io_uring_prep_read(sqe, wakeFd_, &wakeValue_, sizeof(wakeValue_), 0);
+            io_uring_sqe_set_data64(sqe, tag(Op::Wake, 0));
+        }
+
+        void armAccept(uint64_t id, int fd) {
+            io_uring_sqe* sqe = nextSqe();
+            io_uring_prep_multishot_accept(sqe, fd, nullptr, nullptr, SOCK_CLOEXEC);
+            io_uring_sqe_set_data64(sqe, tag(Op::Accept, id));
+        }
+
+        void armRecv(uint64_t id, int fd) {
+            io_uring_sqe* sqe = nextSqe();
+            io_uring_prep_recv_multishot(sqe, fd, nullptr, 0, 0);
+            sqe->flags |= IOSQE_BUFFER_SELECT;
+            sqe->buf_group = BUFFER_GROUP;
+            io_uring_sqe_set_data64(sqe, tag(Op::Recv, id));
+        }
+
+        void cancel(uint64_t id) {
+            io_uring_sqe* sqe = nextSqe();
+            io_uring_prep_cancel64(sqe, tag(Op::Recv, id), 0);
+            io_uring_sqe_set_data64(sqe, tag(Op::Cancel, id));
+        }
+
+        void complete(const io_uring_cqe& cqe) {
+            uint64_t data = io_uring_cqe_get_data64(&cqe);
+            switch (tagOp(data)) {
+                case Op::Wake:
+                    armWake();
+                    break;
+                case Op::Accept:
+                    accepted(tagId(data), cqe);
+                    break;
+                case Op::Recv:
+                    received(tagId(data), cqe);
+                    break;
+                case Op::Cancel:
+                    break;
+            }
+        }
+
+        void accepted(uint64_t id, const io_uring_cqe& cqe) {
+            auto it = listeners_.find(id);
+            if (it == listeners_.end()) {
+                return;
+            }
+            if (cqe.res >= 0) {
+                if (auto handler = it->second.onAccept(cqe.res)) {
+                    add(cqe.res, std::move(handler));
+                }
+            } else {
+                std::cerr << "Error accepting connection: " << std::strerror(-cqe.res) << std::endl;
+            }
+            if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping_) {
+                armAccept(id, it->second.fd);
+            }
+        }
+
+        void received(uint64_t id, const io_uring_cqe& cqe) {
+            auto it = connections_.find(id);
+            if (it == connections_.end()) {
+                return;
+            }
+            Connection& connection = it->second;
+
+            if (cqe.res > 0) {
+                unsigned bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                char* data = buffers_.data() + bufferId * BUFFER_SIZE;
+                bool keep = connection.closing || connection.handler->onData(data, static_cast<size_t>(cqe.res));
+                io_uring_buf_ring_add(bufferRing_, data, BUFFER_SIZE, bufferId,
+                                      io_uring_buf_ring_mask(BUFFER_COUNT), 0);
+                io_uring_buf_ring_advance(bufferRing_, 1);
+                if (!keep) {
+                    connection.closing = true;
+                    cancel(id);
+                }
+            }
+
+            if (cqe.flags & IORING_CQE_F_MORE) {
+                return;
+            }
+            // The multishot request ended. Running out of ring buffers is
+            // only back-pressure; anything else ends the connection.
+            bool ended = connection.closing || cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS);
+            if (!ended) {
+                armRecv(id, connection.fd);
+                return;
+            }
+            std::unique_ptr<IoHandler> handler = std::move(connection.handler);
+            connections_.erase(it);
+            handler->onClose();
+        }
+
+        static constexpr unsigned QUEUE_DEPTH = 1024;
+        static constexpr unsigned BUFFER_COUNT = 256;  // power of two
+        static constexpr size_t BUFFER_SIZE = 16 * 1024;
+        static constexpr int BUFFER_GROUP = 0;
+
+        io_uring ring_;
+        bool ringReady_;
+        io_uring_buf_ring* bufferRing_;
+        std::vector<char> buffers_;
+        int wakeFd_;
+        uint64_t wakeValue_;
+        uint64_t nextId_;
+        std::unordered_map<uint64_t, Listener> listeners_;
+        std::unordered_map<uint64_t, Connection> connections_;
+    };
+}
+
+std::unique_ptr<IoLoop> makeIoUringLoop() {
+    if (!kernelSupportsMultishotRecv()) {
+        return nullptr;
+    }
+    auto loop = std::make_unique<IoUringLoop>();
+    if (!loop->init()) {
+        return nullptr;
+    }
+    return loop;
+}
@@ -0,0 +1,162 @@
+#include "LeaseManager.h"
+#include <algorithm>
+#include <iostream>
+
+LeaseManager::LeaseManager(const LeaseOptions& options)
+    : options_(options)
+    , wheel_(options.tick)
+    , nextGrant_(0)
+    , running_(false) {
+}
+
+LeaseManager::~LeaseManager() {
+    stop();
+}
+
+void LeaseManager::start() {
+    std::lock_guard<std::mutex> lock(sweepMutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&LeaseManager::run, this);
+}
+
+void LeaseManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex_);
+        running_ = false;
+    }
+    sweepCondition_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void LeaseManager::grant(const Task& task, const Poco::UUID& workerId) {
+    Clock::time_point deadline = Clock::now() + options_.timeout;
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t grant = ++nextGrant_;
+    auto previous = leases_.find(task.getId());
+    if (previous != leases_.end()) {
+        forgetHolder(previous->second);
+    }
+    leases_.insert_or_assign(task.getId(), Lease{task, workerId, deadline, grant});
+    byWorker_[workerId].insert(task.getId());
+    wheel_.schedule(deadline, Timer{task.getId(), grant});
+}
+
+bool LeaseManager::release(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = leases_.find(taskId);
+    if (it == leases_.end() || it->second.workerId != workerId) {
+        return false;
+    }
+    forgetHolder(it->second);
+    leases_.erase(it);
+    return true;
+}
+
+bool LeaseManager::extend(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    Clock::time_point deadline = Clock::now() + options_.timeout;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = leases_.find(taskId);
+    if (it == leases_.end() || it->second.workerId != workerId) {
+        return false;
+    }
+    it->second.deadline = std::max(it->second.deadline, deadline);
+    return true;
+}
+
+size_t LeaseManager::expire(Clock::time_point now) {
+    std::vector<Timer> due;
+    std::vector<Lease> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wheel_.advance(now, due);
+        for (const Timer& timer : due) {
+            auto it = leases_.find(timer.taskId);
+            if (it == leases_.end() || it->second.grant != timer.grant) {
+                continue;  // completed, or superseded by a later grant
+            }
+            if (it->second.deadline > now) {
+                wheel_.schedule(it->second.deadline, timer);  // extended since it was scheduled
+                continue;
+            }
+            forgetHolder(it->second);
+            expired.push_back(std::move(it->second));
+            leases_.erase(it);
+        }
+    }
+    notify(expired);
+    return expired.size();
+}
+
+size_t LeaseManager::revoke(const Poco::UUID& workerId) {
+    std::vector<Lease> revoked;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto held = byWorker_.find(workerId);
+        if (held == byWorker_.end()) {
+            return 0;
+        }
+        for (const auto& taskId : held->second) {
+            auto it = leases_.find(taskId);
+            revoked.push_back(std::move(it->second));
+            leases_.erase(it);
+        }
+        byWorker_.erase(held);
+    }
+    notify(revoked);
+    return revoked.size();
+}
+
+void LeaseManager::forgetHolder(const Lease& lease) {
+    auto held = byWorker_.find(lease.workerId);
+    if (held != byWorker_.end()) {
+        held->second.erase(lease.task.getId());
+        if (held->second.empty()) {
+            byWorker_.erase(held);
+        }
+    }
+}
+
+void LeaseManager::notify(std::vector<Lease>& ended) {
+    auto listener = std::atomic_load(&listener_);
+    if (listener) {
+        for (auto& lease : ended) {
+            (*listener)(std::move(lease));
+        }
+    }
+}
+
+size_t LeaseManager::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return leases_.size();
+}
+
+void LeaseManager::setExpiryListener(ExpiryListener listener) {
+    std::shared_ptr<const ExpiryListener> shared;
+    if (listener) {
+        shared = std::make_shared<const ExpiryListener>(std::move(listener));
+    }
+    std::atomic_store(&listener_, std::move(shared));
+}
+
+void LeaseManager::run() {
+    std::unique_lock<std::mutex> lock(sweepMutex_);
+    while (running_) {
+        sweepCondition_.wait_for(lock, options_.tick, [this] { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+        try {
+            expire(Clock::now());
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error expiring leases: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
@@ -1,44 +1,192 @@
-#include "LoadBalancer.h"
-
-void LoadBalancer::addWorker(const Worker& worker) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    workers_.push_back(worker);
-}
-
-void LoadBalancer::removeWorker(const Poco::UUID& workerId) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    workers_.erase(
-        std::remove_if(workers_.begin(), workers_.end(),
-            [&](const Worker& w) { return w.getId() == workerId; }),
-        workers_.end()
-    );
-}
-
-Worker* LoadBalancer::getNextAvailableWorker() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (workers_.empty()) {
-        return nullptr;
-    }
-
-    // Round-robin selection
-    for (size_t i = 0; i < workers_.size(); ++i) {
-        currentWorkerIndex_ = (currentWorkerIndex_ + 1) % workers_.size();
-        if (workers_[currentWorkerIndex_].isAvailable() && 
-            workers_[currentWorkerIndex_].isAlive()) {
-            return &workers_[currentWorkerIndex_];
-        }
-    }
-    
-    return nullptr;
-}
-
-void LoadBalancer::updateWorkerStatus(const Poco::UUID& workerId, bool available) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto& worker : workers_) {
-        if (worker.getId() == workerId) {
-            worker.setAvailable(available);
-            break;
-        }
-    }
-}
\ No newline at end of file
+#include "LoadBalancer.h"
+#include <algorithm>
+#include <iostream>
+
+LoadBalancer::LoadBalancer(SelectionPolicy policy, int maxCredits, const FailureDetectorOptions& detector)
+    : selector_(WorkerSelector::create(policy))
+    , maxCredits_(std::max(1, maxCredits))
+    , detector_(detector) {
+    detector_.setListener([this](const Poco::UUID& workerId) { onHealthChanged(workerId); });
+}
+
+LoadBalancer::~LoadBalancer() {
+    detector_.stop();
+    detector_.setListener(nullptr);
+}
+
+void LoadBalancer::start() {
+    detector_.start();
+}
+
+void LoadBalancer::stop() {
+    detector_.stop();
+}
+
+void LoadBalancer::addWorker(const Worker& worker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // A reconnecting worker re-registers under its existing id and keeps its
+    // in-flight count; completions for those tasks may still arrive.
+    auto existing = workers_.find(worker.getId());
+    WorkerState* state;
+    if (existing != workers_.end()) {
+        state = &existing->second;
+        state->worker = worker;
+    } else {
+        state = &workers_.emplace(worker.getId(), WorkerState{worker}).first->second;
+    }
+    state->capacity = worker.getCapacity();
+    state->credits = std::min(worker.getCredits(), maxCredits_);
+    state->reportedFreeSlots = state->capacity;
+    // Weighted round-robin shares work in proportion to slots
+    state->weight = state->capacity;
+    state->health = WorkerHealth::Alive;
+    detector_.track(worker.getId());
+    refresh(*state);
+}
+
+void LoadBalancer::removeWorker(const Poco::UUID& workerId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    selector_->remove(workerId);
+    workers_.erase(workerId);
+    detector_.forget(workerId);
+}
+
+std::optional<Poco::UUID> LoadBalancer::acquireAvailableWorker() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerState* state = pickLocked();
+    if (!state) {
+        return std::nullopt;
+    }
+    ++state->inFlight;
+    refresh(*state);
+    return state->worker.getId();
+}
+
+void LoadBalancer::releaseWorker(const Poco::UUID& workerId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (WorkerState* state = find(workerId)) {
+        state->inFlight = std::max(0, state->inFlight - 1);
+        refresh(*state);
+    }
+}
+
+void LoadBalancer::updateWorkerStatus(const Poco::UUID& workerId, bool available) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (WorkerState* state = find(workerId)) {
+        state->worker.setAvailable(available);
+        refresh(*state);
+    }
+}
+
+bool LoadBalancer::recordHeartbeat(const Poco::UUID& workerId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerState* state = find(workerId);
+    if (!state || !detector_.heartbeat(workerId)) {
+        return false;
+    }
+    state->health = WorkerHealth::Alive;
+    refresh(*state);
+    return true;
+}
+
+bool LoadBalancer::recordHeartbeat(const Poco::UUID& workerId, double load, int freeSlots) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerState* state = find(workerId);
+    if (!state || !detector_.heartbeat(workerId)) {
+        return false;
+    }
+    state->health = WorkerHealth::Alive;
+    state->load = load;
+    state->reportedFreeSlots = std::max(0, std::min(freeSlots, state->capacity));
+    refresh(*state);
+    return true;
+}
+
+void LoadBalancer::setWorkerWeight(const Poco::UUID& workerId, int weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (WorkerState* state = find(workerId)) {
+        state->weight = std::max(1, weight);
+        refresh(*state);
+    }
+}
+
+void LoadBalancer::setWorkerCredits(const Poco::UUID& workerId, int credits) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (WorkerState* state = find(workerId)) {
+        state->credits = std::max(1, std::min(credits, maxCredits_));
+        refresh(*state);
+    }
+}
+
+void LoadBalancer::setAvailabilityListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    listener_ = std::move(listener);
+}
+
+void LoadBalancer::setEvictionListener(std::function<void(const Poco::UUID& workerId)> listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    evictionListener_ = std::move(listener);
+}
+
+void LoadBalancer::onHealthChanged(const Poco::UUID& workerId) {
+    std::function<void(const Poco::UUID&)> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        WorkerState* state = find(workerId);
+        if (!state) {
+            return;
+        }
+        // Re-read: a heartbeat or re-registration may have overtaken the event
+        WorkerHealth health = detector_.health(workerId);
+        if (health != WorkerHealth::Dead) {
+            state->health = health;
+            refresh(*state);
+            if (health == WorkerHealth::Suspect) {
+                std::cerr << "Worker " << workerId.toString() << " missed its heartbeats, suspending dispatch" << std::endl;
+            }
+            return;
+        }
+        selector_->remove(workerId);
+        workers_.erase(workerId);
+        evicted = evictionListener_;
+    }
+    std::cerr << "Worker " << workerId.toString() << " declared dead, evicting" << std::endl;
+    if (evicted) {
+        evicted(workerId);
+    }
+}
+
+LoadBalancer::WorkerState* LoadBalancer::find(const Poco::UUID& workerId) {
+    auto it = workers_.find(workerId);
+    return it != workers_.end() ? &it->second : nullptr;
+}
+
+LoadBalancer::WorkerState* LoadBalancer::pickLocked() {
+    // Health changes arrive as events (see onHealthChanged), so everything
+    // in the index is eligible.
+    std::optional<Poco::UUID> id = selector_->pick();
+    return id ? find(*id) : nullptr;
+}
+
+void LoadBalancer::refresh(WorkerState& state) {
+    bool eligible = state.worker.isAvailable() && state.health == WorkerHealth::Alive &&
+                    state.inFlight < state.credits;
+    if (!eligible) {
+        if (state.indexed) {
+            selector_->remove(state.worker.getId());
+            state.indexed = false;
+        }
+        return;
+    }
+    // The worker's report lags dispatch, so it only ranks workers; eligibility
+    // uses the server's own in-flight count.
+    int busy = std::max(state.inFlight, state.capacity - state.reportedFreeSlots);
+    double score = state.load + static_cast<double>(busy) / state.capacity;
+    selector_->update(state.worker.getId(), score, state.weight);
+    if (!state.indexed) {
+        state.indexed = true;
+        if (listener_) {
+            listener_();
+        }
+    }
+}
@@ -0,0 +1,588 @@
+#include "MessageCodec.h"
+#include "BufferPool.h"
+#include <Poco/JSON/Array.h>
+#include <Poco/JSON/Object.h>
+#include <Poco/JSON/Parser.h>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // ---- binary primitives ----
+
+    void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    void putSigned(std::string& out, int64_t value) {
+        putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putUuid(std::string& out, const Poco::UUID& uuid) {
+        char raw[16];
+        uuid.copyTo(raw);
+        out.append(raw, sizeof(raw));
+    }
+
+    void putString(std::string& out, std::string_view value) {
+        putVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    void putFloat(std::string& out, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+        }
+    }
+
+    void putBool(std::string& out, bool value) {
+        out.push_back(value ? 1 : 0);
+    }
+
+    class BinaryReader {
+    public:
+        explicit BinaryReader(std::string_view payload)
+            : p_(payload.data())
+            , end_(payload.data() + payload.size()) {
+        }
+
+        uint64_t varint() {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                uint8_t byte = static_cast<uint8_t>(take(1)[0]);
+                value |= uint64_t(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+            throw std::runtime_error("Malformed varint in binary message");
+        }
+
+        int64_t signedVarint() {
+            uint64_t raw = varint();
+            return static_cast<int64_t>((raw >> 1) ^ (~(raw & 1) + 1));
+        }
+
+        Poco::UUID uuid() {
+            Poco::UUID uuid;
+            uuid.copyFrom(take(16));
+            return uuid;
+        }
+
+        std::string_view string() {
+            uint64_t size = varint();
+            if (size > static_cast<uint64_t>(end_ - p_)) {
+                throw std::runtime_error("Truncated binary message");
+            }
+            return std::string_view(take(static_cast<size_t>(size)), static_cast<size_t>(size));
+        }
+
+        float f32() {
+            const char* raw = take(4);
+            uint32_t bits = 0;
+            for (int i = 0; i < 4; ++i) {
+                bits |= uint32_t(static_cast<uint8_t>(raw[i])) << (8 * i);
+            }
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        bool boolean() {
+            return take(1)[0] != 0;
+        }
+
+        // Element count for a repeated field. Every element takes at least
+        // minElementSize bytes, which bounds allocations on hostile input.
+        size_t count(size_t minElementSize) {
+            uint64_t n = varint();
+            if (n > static_cast<uint64_t>(end_ - p_) / minElementSize) {
+                throw std::runtime_error("Truncated binary message");
+            }
+            return static_cast<size_t>(n);
+        }
+
+    private:
+        const char* take(size_t n) {
+            if (static_cast<size_t>(end_ - p_) < n) {
+                throw std::runtime_error("Truncated binary message");
+            }
+            const char* at = p_;
+            p_ += n;
+            return at;
+        }
+
+        const char* p_;
+        const char* end_;
+    };
+
+    // ---- JSON helpers ----
+
+    void appendJson(std::string& out, const Poco::JSON::Object& object) {
+        std::ostringstream stream;
+        object.stringify(stream);
+        out += stream.str();
+    }
+
+    Poco::JSON::Object::Ptr parseJson(std::string_view payload) {
+        Poco::JSON::Parser parser;
+        Poco::Dynamic::Var result = parser.parse(std::string(payload));
+        return result.extract<Poco::JSON::Object::Ptr>();
+    }
+
+    Poco::UUID jsonUuid(const Poco::JSON::Object::Ptr& object, const std::string& key) {
+        return Poco::UUID(object->getValue<std::string>(key));
+    }
+
+    // ---- tasks ----
+
+    constexpr size_t MIN_BINARY_TASK_SIZE = 16 + 1 + 1 + 1;  // id, priority, two empty strings
+
+    // Everything but the data bytes, which come last; the caller appends
+    // or sends them from the task's shared buffer.
+    std::string_view putTaskHead(std::string& out, const Task& task) {
+        putUuid(out, task.getId());
+        putSigned(out, task.getPriority());
+        putString(out, task.getName());
+        putVarint(out, task.getData().size());
+        return task.getData();
+    }
+
+    void putTask(std::string& out, const Task& task) {
+        std::string_view data = putTaskHead(out, task);
+        out.append(data.data(), data.size());
+    }
+
+    Task readTask(BinaryReader& reader, PayloadArena* arena) {
+        Poco::UUID id = reader.uuid();
+        int priority = static_cast<int>(reader.signedVarint());
+        std::string_view name = reader.string();
+        std::string_view data = reader.string();
+        Task task = arena ? Task(id, name, arena->copy(data), data.size())
+                          : Task(id, name, std::string(data));
+        task.setPriority(priority);
+        return task;
+    }
+
+    Poco::JSON::Object taskToJson(const Task& task) {
+        Poco::JSON::Object taskObj;
+        taskObj.set("id", task.getId().toString());
+        taskObj.set("name", task.getName());
+        taskObj.set("data", std::string(task.getData()));
+        taskObj.set("priority", task.getPriority());
+        return taskObj;
+    }
+
+    Task taskFromJson(const Poco::JSON::Object::Ptr& taskObj) {
+        Task task(jsonUuid(taskObj, "id"),
+                  taskObj->getValue<std::string>("name"),
+                  taskObj->getValue<std::string>("data"));
+        if (taskObj->has("priority")) {
+            task.setPriority(taskObj->getValue<int>("priority"));
+        }
+        return task;
+    }
+}
+
+void encodeTask(std::string& out, const Task& task, Encoding encoding) {
+    std::string_view tail = encodeTaskParts(out, task, encoding);
+    out.append(tail.data(), tail.size());
+}
+
+std::string_view encodeTaskParts(std::string& out, const Task& task, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        return putTaskHead(out, task);
+    }
+    Poco::JSON::Object json;
+    json.set("task", taskToJson(task));
+    appendJson(out, json);
+    return {};
+}
+
+Task decodeTask(std::string_view payload, Encoding encoding, PayloadArena* arena) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        return readTask(reader, arena);
+    }
+    return taskFromJson(parseJson(payload)->getObject("task"));
+}
+
+void encodeMessage(std::string& out, const RegisterMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.workerId);
+        putBool(out, message.supportsBinary);
+        putVarint(out, message.slots);
+        putVarint(out, message.prefetch);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("worker_id", message.workerId.toString());
+    Poco::JSON::Array encodings;
+    encodings.add(std::string("json"));
+    if (message.supportsBinary) {
+        encodings.add(std::string("binary"));
+    }
+    json.set("encodings", encodings);
+    json.set("slots", message.slots);
+    json.set("prefetch", message.prefetch);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, RegisterMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.workerId = reader.uuid();
+        message.supportsBinary = reader.boolean();
+        message.slots = static_cast<uint32_t>(reader.varint());
+        message.prefetch = static_cast<uint32_t>(reader.varint());
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.workerId = jsonUuid(json, "worker_id");
+    message.supportsBinary = false;
+    if (json->has("encodings")) {
+        Poco::JSON::Array::Ptr encodings = json->getArray("encodings");
+        for (unsigned int i = 0; i < encodings->size(); ++i) {
+            if (encodings->getElement<std::string>(i) == "binary") {
+                message.supportsBinary = true;
+            }
+        }
+    }
+    // Older workers do not advertise slots and run one task at a time
+    message.slots = json->has("slots") ? json->getValue<uint32_t>("slots") : 1;
+    message.prefetch = json->has("prefetch") ? json->getValue<uint32_t>("prefetch") : 0;
+}
+
+void encodeMessage(std::string& out, const RegisterAckMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putVarint(out, static_cast<uint8_t>(message.encoding));
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("encoding", std::string(message.encoding == Encoding::Binary ? "binary" : "json"));
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, RegisterAckMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.encoding = reader.varint() == static_cast<uint8_t>(Encoding::Binary)
+            ? Encoding::Binary : Encoding::Json;
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.encoding = json->getValue<std::string>("encoding") == "binary"
+        ? Encoding::Binary : Encoding::Json;
+}
+
+void encodeMessage(std::string& out, const HeartbeatMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.workerId);
+        putFloat(out, message.load);
+        putVarint(out, message.freeSlots);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("worker_id", message.workerId.toString());
+    json.set("load", message.load);
+    json.set("free_slots", message.freeSlots);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, HeartbeatMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.workerId = reader.uuid();
+        message.load = reader.f32();
+        message.freeSlots = static_cast<uint32_t>(reader.varint());
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.workerId = jsonUuid(json, "worker_id");
+    message.load = json->has("load") ? json->getValue<float>("load") : 0.0f;
+    message.freeSlots = json->has("free_slots") ? json->getValue<uint32_t>("free_slots") : 0;
+}
+
+void encodeMessage(std::string& out, const TaskCompletedMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.taskId);
+        putUuid(out, message.workerId);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("task_id", message.taskId.toString());
+    json.set("worker_id", message.workerId.toString());
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, TaskCompletedMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.taskId = reader.uuid();
+        message.workerId = reader.uuid();
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.taskId = jsonUuid(json, "task_id");
+    message.workerId = jsonUuid(json, "worker_id");
+}
+
+void encodeMessage(std::string& out, const TaskCompletedAckMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.taskId);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("task_id", message.taskId.toString());
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, TaskCompletedAckMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.taskId = reader.uuid();
+        return;
+    }
+    message.taskId = jsonUuid(parseJson(payload), "task_id");
+}
+
+void encodeMessage(std::string& out, const ExtendLeaseMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.workerId);
+        putVarint(out, message.taskIds.size());
+        for (const auto& taskId : message.taskIds) {
+            putUuid(out, taskId);
+        }
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("worker_id", message.workerId.toString());
+    Poco::JSON::Array ids;
+    for (const auto& taskId : message.taskIds) {
+        ids.add(taskId.toString());
+    }
+    json.set("task_ids", ids);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, ExtendLeaseMessage& message) {
+    message.taskIds.clear();
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.workerId = reader.uuid();
+        size_t count = reader.count(16);
+        message.taskIds.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            message.taskIds.push_back(reader.uuid());
+        }
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.workerId = jsonUuid(json, "worker_id");
+    Poco::JSON::Array::Ptr ids = json->getArray("task_ids");
+    message.taskIds.reserve(ids->size());
+    for (unsigned int i = 0; i < ids->size(); ++i) {
+        message.taskIds.push_back(Poco::UUID(ids->getElement<std::string>(i)));
+    }
+}
+
+void encodeMessage(std::string& out, const CheckStatusMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.taskId);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("task_id", message.taskId.toString());
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, CheckStatusMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.taskId = reader.uuid();
+        return;
+    }
+    message.taskId = jsonUuid(parseJson(payload), "task_id");
+}
+
+void encodeMessage(std::string& out, const StatusReplyMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putUuid(out, message.taskId);
+        putBool(out, message.completed);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("task_id", message.taskId.toString());
+    json.set("completed", message.completed);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, StatusReplyMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.taskId = reader.uuid();
+        message.completed = reader.boolean();
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.taskId = jsonUuid(json, "task_id");
+    message.completed = json->getValue<bool>("completed");
+}
+
+void encodeMessage(std::string& out, const SubmitBatchMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putVarint(out, message.requestId);
+        putVarint(out, message.tasks.size());
+        for (const auto& task : message.tasks) {
+            putTask(out, task);
+        }
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("request_id", message.requestId);
+    Poco::JSON::Array tasks;
+    for (const auto& task : message.tasks) {
+        tasks.add(taskToJson(task));
+    }
+    json.set("tasks", tasks);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, SubmitBatchMessage& message) {
+    message.tasks.clear();
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.requestId = reader.varint();
+        size_t count = reader.count(MIN_BINARY_TASK_SIZE);
+        message.tasks.reserve(count);
+        PayloadArena arena;
+        for (size_t i = 0; i < count; ++i) {
+            message.tasks.push_back(readTask(reader, &arena));
+        }
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.requestId = json->getValue<uint64_t>("request_id");
+    Poco::JSON::Array::Ptr tasks = json->getArray("tasks");
+    message.tasks.reserve(tasks->size());
+    for (unsigned int i = 0; i < tasks->size(); ++i) {
+        message.tasks.push_back(taskFromJson(tasks->getObject(i)));
+    }
+}
+
+void encodeMessage(std::string& out, const SubmitAckMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putVarint(out, message.requestId);
+        putVarint(out, message.accepted);
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("request_id", message.requestId);
+    json.set("accepted", message.accepted);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, SubmitAckMessage& message) {
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.requestId = reader.varint();
+        message.accepted = static_cast<uint32_t>(reader.varint());
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.requestId = json->getValue<uint64_t>("request_id");
+    message.accepted = json->getValue<uint32_t>("accepted");
+}
+
+void encodeMessage(std::string& out, const StatusQueryMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putVarint(out, message.requestId);
+        putVarint(out, message.taskIds.size());
+        for (const auto& taskId : message.taskIds) {
+            putUuid(out, taskId);
+        }
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("request_id", message.requestId);
+    Poco::JSON::Array ids;
+    for (const auto& taskId : message.taskIds) {
+        ids.add(taskId.toString());
+    }
+    json.set("task_ids", ids);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, StatusQueryMessage& message) {
+    message.taskIds.clear();
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.requestId = reader.varint();
+        size_t count = reader.count(16);
+        message.taskIds.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            message.taskIds.push_back(reader.uuid());
+        }
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.requestId = json->getValue<uint64_t>("request_id");
+    Poco::JSON::Array::Ptr ids = json->getArray("task_ids");
+    message.taskIds.reserve(ids->size());
+    for (unsigned int i = 0; i < ids->size(); ++i) {
+        message.taskIds.push_back(Poco::UUID(ids->getElement<std::string>(i)));
+    }
+}
+
+void encodeMessage(std::string& out, const StatusBatchReplyMessage& message, Encoding encoding) {
+    if (encoding == Encoding::Binary) {
+        putVarint(out, message.requestId);
+        putVarint(out, message.statuses.size());
+        for (const auto& entry : message.statuses) {
+            putUuid(out, entry.taskId);
+            putString(out, entry.status);
+        }
+        return;
+    }
+    Poco::JSON::Object json;
+    json.set("request_id", message.requestId);
+    Poco::JSON::Array statuses;
+    for (const auto& entry : message.statuses) {
+        Poco::JSON::Object item;
+        item.set("task_id", entry.taskId.toString());
+        item.set("status", entry.status);
+        statuses.add(item);
+    }
+    json.set("statuses", statuses);
+    appendJson(out, json);
+}
+
+void decodeMessage(std::string_view payload, Encoding encoding, StatusBatchReplyMessage& message) {
+    message.statuses.clear();
+    if (encoding == Encoding::Binary) {
+        BinaryReader reader(payload);
+        message.requestId = reader.varint();
+        size_t count = reader.count(16 + 1);
+        message.statuses.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            Poco::UUID taskId = reader.uuid();
+            message.statuses.push_back(TaskStatusEntry{taskId, std::string(reader.string())});
+        }
+        return;
+    }
+    Poco::JSON::Object::Ptr json = parseJson(payload);
+    message.requestId = json->getValue<uint64_t>("request_id");
+    Poco::JSON::Array::Ptr statuses = json->getArray("statuses");
+    message.statuses.reserve(statuses->size());
+    for (unsigned int i = 0; i < statuses->size(); ++i) {
+        Poco::JSON::Object::Ptr item = statuses->getObject(i);
+        message.statuses.push_back(TaskStatusEntry{jsonUuid(item, "task_id"),
+                                                   item->getValue<std::string>("status")});
+    }
+}
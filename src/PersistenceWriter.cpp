@@ -0,0 +1,365 @@
+#include "PersistenceWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include "BufferPool.h"
+#include "MessageCodec.h"
+
+namespace {
+    // WAL records, one per sequence number:
+    //   'I' | u32 count | (u32 length | binary task)...
+    //   'U' | task id | u8 status | worker id | i32 retry count
+    constexpr char INSERT_RECORD = 'I';
+    constexpr char UPDATE_RECORD = 'U';
+    constexpr size_t UPDATE_RECORD_SIZE = 1 + 16 + 1 + 16 + 4;
+
+    std::string& recordScratch() {
+        thread_local std::string record;
+        record.clear();
+        return record;
+    }
+
+    void putU32(std::string& out, uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void putUuid(std::string& out, const Poco::UUID& uuid) {
+        char raw[16];
+        uuid.copyTo(raw);
+        out.append(raw, sizeof(raw));
+    }
+
+    std::string_view encodeInserts(const Task* tasks, size_t count) {
+        std::string& out = recordScratch();
+        out.push_back(INSERT_RECORD);
+        putU32(out, static_cast<uint32_t>(count));
+        for (size_t i = 0; i < count; ++i) {
+            size_t lengthAt = out.size();
+            putU32(out, 0);
+            encodeTask(out, tasks[i], Encoding::Binary);
+            uint32_t length = static_cast<uint32_t>(out.size() - lengthAt - sizeof(uint32_t));
+            std::memcpy(&out[lengthAt], &length, sizeof(length));
+        }
+        return out;
+    }
+
+    std::string_view encodeUpdate(const TaskUpdate& update) {
+        std::string& out = recordScratch();
+        out.push_back(UPDATE_RECORD);
+        putUuid(out, update.taskId);
+        out.push_back(static_cast<char>(update.status));
+        putUuid(out, update.workerId);
+        int32_t retryCount = update.retryCount;
+        out.append(reinterpret_cast<const char*>(&retryCount), sizeof(retryCount));
+        return out;
+    }
+
+    void decodeRecord(std::string_view record, std::vector<Task>& inserts, std::vector<TaskUpdate>& updates,
+                      PayloadArena& arena) {
+        if (record.empty()) {
+            throw std::runtime_error("Empty WAL record");
+        }
+        if (record[0] == UPDATE_RECORD && record.size() == UPDATE_RECORD_SIZE) {
+            TaskUpdate update;
+            update.taskId.copyFrom(record.data() + 1);
+            auto status = static_cast<uint8_t>(record[17]);
+            if (status > static_cast<uint8_t>(TaskStatus::DeadLetter)) {
+                throw std::runtime_error("Bad task status in WAL record");
+            }
+            update.status = static_cast<TaskStatus>(status);
+            update.workerId.copyFrom(record.data() + 18);
+            int32_t retryCount;
+            std::memcpy(&retryCount, record.data() + 34, sizeof(retryCount));
+            update.retryCount = retryCount;
+            updates.push_back(update);
+            return;
+        }
+        if (record[0] != INSERT_RECORD || record.size() < 5) {
+            throw std::runtime_error("Unknown WAL record");
+        }
+        uint32_t count;
+        std::memcpy(&count, record.data() + 1, sizeof(count));
+        size_t offset = 5;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t length;
+            if (record.size() - offset < sizeof(length)) {
+                throw std::runtime_error("Truncated WAL insert record");
+            }
+            std::memcpy(&length, record.data() + offset, sizeof(length));
+            offset += sizeof(length);
+            if (record.size() - offset < length) {
+                throw std::runtime_error("Truncated WAL insert record");
+            }
+            inserts.push_back(decodeTask(record.substr(offset, length), Encoding::Binary, &arena));
+            offset += length;
+        }
+    }
+}
+
+PersistenceWriter::PersistenceWriter(DatabaseManager& dbManager, const PersistenceOptions& options)
+    : dbManager_(dbManager)
+    , options_(options)
+    , lastSequence_(0)
+    , running_(false)
+    , appliedSequence_(0) {
+    if (!options_.walDirectory.empty()) {
+        WalOptions wal;
+        wal.directory = options_.walDirectory;
+        wal.segmentBytes = options_.walSegmentBytes;
+        wal_ = std::make_unique<WriteAheadLog>(wal);
+    }
+}
+
+PersistenceWriter::~PersistenceWriter() {
+    stop();
+}
+
+size_t PersistenceWriter::recover() {
+    if (!wal_) {
+        return 0;
+    }
+    std::vector<Task> inserts;
+    std::vector<TaskUpdate> updates;
+    PayloadArena arena;
+    size_t records = 0;
+    bool failed = false;
+    // Records the database already applied before the crash are harmless
+    // to repeat: an insert is skipped when the task is still in tasks or
+    // already in tasks_archive, and updates carry absolute values (an
+    // update to an archived task finds no row). So the log is applied in
+    // bounded transactions rather than one that grows with it.
+    auto apply = [&] {
+        if (!failed && !flush(inserts, updates, true)) {
+            failed = true;
+        }
+        inserts.clear();
+        updates.clear();
+    };
+    Sequence last = wal_->recover([&](WriteAheadLog::Lsn, std::string_view record) {
+        if (failed) {
+            return;
+        }
+        decodeRecord(record, inserts, updates, arena);
+        ++records;
+        if (inserts.size() + updates.size() >= RECOVERY_BATCH) {
+            apply();
+        }
+    });
+    if (!inserts.empty() || !updates.empty()) {
+        apply();
+    }
+    if (failed) {
+        throw std::runtime_error("Cannot apply recovered WAL records (" + std::to_string(records) + " read)");
+    }
+    if (records > 0) {
+        std::cout << "✓ Replayed " << records << " WAL records up to sequence " << last << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lastSequence_ = last;
+    }
+    appliedSequence_ = last;
+    wal_->checkpoint(last);
+    return records;
+}
+
+void PersistenceWriter::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    if (wal_) {
+        wal_->start();
+    }
+    thread_ = std::thread(&PersistenceWriter::run, this);
+}
+
+void PersistenceWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (wal_) {
+        wal_->stop();
+    }
+}
+
+PersistenceWriter::Sequence PersistenceWriter::insertTask(const Task& task) {
+    std::string_view record = wal_ ? encodeInserts(&task, 1) : std::string_view();
+    std::lock_guard<std::mutex> lock(mutex_);
+    pendingInserts_.push_back(task);
+    if (pendingInserts_.size() + pendingUpdates_.size() >= options_.flushSize) {
+        condition_.notify_one();
+    }
+    return logged(record);
+}
+
+PersistenceWriter::Sequence PersistenceWriter::insertTasks(const std::vector<Task>& tasks) {
+    std::string_view record = wal_ ? encodeInserts(tasks.data(), tasks.size()) : std::string_view();
+    std::lock_guard<std::mutex> lock(mutex_);
+    pendingInserts_.insert(pendingInserts_.end(), tasks.begin(), tasks.end());
+    if (pendingInserts_.size() + pendingUpdates_.size() >= options_.flushSize) {
+        condition_.notify_one();
+    }
+    return logged(record);
+}
+
+PersistenceWriter::Sequence PersistenceWriter::lastSequence() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lastSequence_;
+}
+
+PersistenceWriter::Sequence PersistenceWriter::assignTask(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    return recordUpdate(TaskUpdate{taskId, TaskStatus::InProgress, workerId});
+}
+
+PersistenceWriter::Sequence PersistenceWriter::completeTask(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    return recordUpdate(TaskUpdate{taskId, TaskStatus::Completed, workerId});
+}
+
+PersistenceWriter::Sequence PersistenceWriter::requeueTask(const Poco::UUID& taskId, const Poco::UUID& workerId,
+                                                           int retryCount) {
+    return recordUpdate(TaskUpdate{taskId, TaskStatus::Pending, workerId, retryCount});
+}
+
+PersistenceWriter::Sequence PersistenceWriter::deadLetterTask(const Poco::UUID& taskId, const Poco::UUID& workerId,
+                                                              int retryCount) {
+    return recordUpdate(TaskUpdate{taskId, TaskStatus::DeadLetter, workerId, retryCount});
+}
+
+PersistenceWriter::Sequence PersistenceWriter::recordUpdate(const TaskUpdate& update) {
+    std::string_view record = wal_ ? encodeUpdate(update) : std::string_view();
+    std::lock_guard<std::mutex> lock(mutex_);
+    pendingUpdates_.push_back(update);
+    if (pendingInserts_.size() + pendingUpdates_.size() >= options_.flushSize) {
+        condition_.notify_one();
+    }
+    return logged(record);
+}
+
+PersistenceWriter::Sequence PersistenceWriter::logged(std::string_view record) {
+    // Appending under mutex_ keeps WAL order identical to sequence order
+    ++lastSequence_;
+    if (wal_) {
+        wal_->append(lastSequence_, record);
+    }
+    return lastSequence_;
+}
+
+bool PersistenceWriter::waitDurable(Sequence sequence, std::chrono::milliseconds timeout) {
+    if (wal_) {
+        return wal_->waitDurable(sequence, timeout);
+    }
+    return waitApplied(sequence, timeout);
+}
+
+bool PersistenceWriter::waitApplied(Sequence sequence, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(appliedMutex_);
+    return appliedCondition_.wait_for(lock, timeout, [&] { return appliedSequence_ >= sequence; });
+}
+
+void PersistenceWriter::run() {
+    std::vector<Task> inserts;
+    std::vector<TaskUpdate> updates;
+
+    while (true) {
+        Sequence batchEnd;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait_for(lock, options_.flushInterval, [this] {
+                return !running_ || pendingInserts_.size() + pendingUpdates_.size() >= options_.flushSize;
+            });
+            stopping = !running_;
+            if (pendingInserts_.empty() && pendingUpdates_.empty()) {
+                if (stopping) {
+                    break;
+                }
+                continue;
+            }
+            inserts.swap(pendingInserts_);
+            updates.swap(pendingUpdates_);
+            batchEnd = lastSequence_;
+        }
+
+        bool persisted = flush(inserts, updates, stopping);
+        if (!persisted) {
+            if (wal_) {
+                std::cerr << "⚠ Leaving " << inserts.size() + updates.size()
+                          << " unapplied task changes in the WAL for the next start" << std::endl;
+            } else {
+                std::cerr << "❌ Dropping " << inserts.size() + updates.size()
+                          << " unpersisted task changes at shutdown" << std::endl;
+            }
+        }
+        inserts.clear();
+        updates.clear();
+
+        if (persisted) {
+            {
+                std::lock_guard<std::mutex> lock(appliedMutex_);
+                appliedSequence_ = batchEnd;
+            }
+            appliedCondition_.notify_all();
+            if (wal_) {
+                wal_->checkpoint(batchEnd);
+            }
+        }
+    }
+}
+
+std::vector<TaskUpdate> coalesceUpdates(const std::vector<TaskUpdate>& updates) {
+    std::map<Poco::UUID, size_t> latest;
+    std::vector<TaskUpdate> coalesced;
+    coalesced.reserve(updates.size());
+    for (const TaskUpdate& update : updates) {
+        auto found = latest.emplace(update.taskId, coalesced.size());
+        if (found.second) {
+            coalesced.push_back(update);
+            continue;
+        }
+        TaskUpdate& merged = coalesced[found.first->second];
+        int retryCount = merged.retryCount;
+        merged = update;
+        if (merged.retryCount < 0) {
+            merged.retryCount = retryCount;
+        }
+    }
+    return coalesced;
+}
+
+bool PersistenceWriter::flush(std::vector<Task>& inserts, std::vector<TaskUpdate>& updates, bool stopping) {
+    // Only the latest change per task matters within a batch, so each task
+    // gets a single UPDATE
+    if (updates.size() > 1) {
+        updates = coalesceUpdates(updates);
+    }
+
+    // Retry until the database is back; once shutdown starts, give up after a few attempts.
+    int backoffMs = 50;
+    for (int attempt = 1;; ++attempt) {
+        if (!stopping) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping = !running_;
+        }
+        if (stopping && attempt > SHUTDOWN_FLUSH_ATTEMPTS) {
+            return false;
+        }
+        try {
+            dbManager_.persistBatch(inserts, updates);
+            return true;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "❌ Write-behind flush failed (attempt " << attempt << "): " << e.what() << std::endl;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+        backoffMs = std::min(backoffMs * 2, MAX_RETRY_BACKOFF_MS);
+    }
+}
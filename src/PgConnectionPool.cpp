@@ -0,0 +1,215 @@
+#include "PgConnectionPool.h"
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef LIBPQ_HAS_PIPELINING
+#error "libpq 14 or newer is required for pipeline mode"
+#endif
+
+PgConnection::PgConnection(const std::string& conninfo)
+    : conn_(PQconnectdb(conninfo.c_str())) {
+    if (PQstatus(conn_) != CONNECTION_OK) {
+        std::string message = PQerrorMessage(conn_);
+        PQfinish(conn_);
+        throw std::runtime_error("Cannot connect to database: " + message);
+    }
+}
+
+PgConnection::~PgConnection() {
+    PQfinish(conn_);
+}
+
+bool PgConnection::healthy() const {
+    if (PQpipelineStatus(conn_) != PQ_PIPELINE_OFF) {
+        return false;
+    }
+    return PQstatus(conn_) == CONNECTION_OK && PQtransactionStatus(conn_) == PQTRANS_IDLE;
+}
+
+void PgConnection::fail(const char* what) const {
+    throw std::runtime_error(std::string(what) + ": " + PQerrorMessage(conn_));
+}
+
+void PgConnection::prepare(const PreparedQuery& query) {
+    if (prepared_.count(&query)) {
+        return;
+    }
+    PgResult result(PQprepare(conn_, query.name, query.sql, 0, nullptr), PQclear);
+    if (PQresultStatus(result.get()) != PGRES_COMMAND_OK) {
+        fail(query.name);
+    }
+    prepared_.insert(&query);
+}
+
+PgResult PgConnection::execute(const PreparedQuery& query, const std::vector<const char*>& params) {
+    prepare(query);
+    PgResult result(PQexecPrepared(conn_, query.name, static_cast<int>(params.size()), params.data(),
+                                   nullptr, nullptr, 0),
+                    PQclear);
+    ExecStatusType status = PQresultStatus(result.get());
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        fail(query.name);
+    }
+    return result;
+}
+
+PgPipeline::PgPipeline(PgConnection& connection)
+    : connection_(connection) {
+}
+
+void PgPipeline::add(const PreparedQuery& query, std::vector<std::string> params) {
+    statements_.push_back(Statement{&query, std::move(params)});
+}
+
+std::vector<const char*> PgPipeline::values(const Statement& statement) const {
+    std::vector<const char*> values;
+    values.reserve(statement.params.size());
+    for (const auto& param : statement.params) {
+        values.push_back(param.c_str());
+    }
+    return values;
+}
+
+void PgPipeline::run() {
+    if (statements_.empty()) {
+        return;
+    }
+    // Preparing is a round trip per query the connection has not seen yet
+    for (const Statement& statement : statements_) {
+        connection_.prepare(*statement.query);
+    }
+    runPipelined();
+    statements_.clear();
+}
+
+void PgPipeline::runPipelined() {
+    PGconn* conn = connection_.conn_;
+    if (PQenterPipelineMode(conn) != 1) {
+        connection_.fail("Cannot enter pipeline mode");
+    }
+
+    std::string error;
+    size_t outstanding = 0;
+    // Syncs and reads the results of everything sent so far; a failed
+    // statement makes the server skip the rest up to the sync.
+    auto drain = [&] {
+        if (PQpipelineSync(conn) != 1) {
+            error = PQerrorMessage(conn);
+            return;
+        }
+        for (; outstanding > 0; --outstanding) {
+            while (PGresult* result = PQgetResult(conn)) {
+                ExecStatusType status = PQresultStatus(result);
+                if (error.empty() && status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+                    error = status == PGRES_PIPELINE_ABORTED ? "aborted" : PQresultErrorMessage(result);
+                }
+                PQclear(result);
+            }
+        }
+        PgResult sync(PQgetResult(conn), PQclear);
+        if (PQresultStatus(sync.get()) != PGRES_PIPELINE_SYNC && error.empty()) {
+            error = PQerrorMessage(conn);
+        }
+    };
+    auto sendSimple = [&](const char* sql) {
+        if (PQsendQueryParams(conn, sql, 0, nullptr, nullptr, nullptr, nullptr, 0) != 1) {
+            error = PQerrorMessage(conn);
+            return false;
+        }
+        ++outstanding;
+        return true;
+    };
+
+    if (sendSimple("BEGIN")) {
+        for (const Statement& statement : statements_) {
+            std::vector<const char*> params = values(statement);
+            if (PQsendQueryPrepared(conn, statement.query->name, static_cast<int>(params.size()), params.data(),
+                                    nullptr, nullptr, 0) != 1) {
+                error = PQerrorMessage(conn);
+                break;
+            }
+            if (++outstanding >= MAX_PIPELINE_DEPTH) {
+                drain();
+                if (!error.empty()) {
+                    break;
+                }
+            }
+        }
+        if (error.empty()) {
+            sendSimple("COMMIT");
+        }
+    }
+    if (outstanding > 0 || error.empty()) {
+        drain();
+    }
+    PQexitPipelineMode(conn);
+
+    if (!error.empty()) {
+        if (PQtransactionStatus(conn) != PQTRANS_IDLE) {
+            PgResult rollback(PQexec(conn, "ROLLBACK"), PQclear);
+        }
+        throw std::runtime_error("Pipelined batch failed: " + error);
+    }
+}
+
+PgConnectionPool::Lease::Lease(PgConnectionPool& pool, std::unique_ptr<PgConnection> connection)
+    : pool_(&pool)
+    , connection_(std::move(connection)) {
+}
+
+PgConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_)
+    , connection_(std::move(other.connection_)) {
+}
+
+PgConnectionPool::Lease::~Lease() {
+    if (connection_) {
+        pool_->release(std::move(connection_));
+    }
+}
+
+PgConnectionPool::PgConnectionPool(std::string conninfo, size_t maxConnections, LatencyStats& waitStats)
+    : conninfo_(std::move(conninfo))
+    , maxConnections_(maxConnections)
+    , waitStats_(waitStats)
+    , open_(0) {
+}
+
+PgConnectionPool::~PgConnectionPool() = default;
+
+PgConnectionPool::Lease PgConnectionPool::acquire() {
+    ScopedLatency wait(waitStats_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !idle_.empty() || open_ < maxConnections_; });
+    if (!idle_.empty()) {
+        std::unique_ptr<PgConnection> connection = std::move(idle_.back());
+        idle_.pop_back();
+        return Lease(*this, std::move(connection));
+    }
+    ++open_;
+    lock.unlock();
+    try {
+        return Lease(*this, std::make_unique<PgConnection>(conninfo_));
+    }
+    catch (...) {
+        lock.lock();
+        --open_;
+        lock.unlock();
+        condition_.notify_one();
+        throw;
+    }
+}
+
+void PgConnectionPool::release(std::unique_ptr<PgConnection> connection) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (connection->healthy()) {
+            idle_.push_back(std::move(connection));
+        } else {
+            std::cerr << "⚠ Closing broken database connection" << std::endl;
+            --open_;
+        }
+    }
+    condition_.notify_one();
+}
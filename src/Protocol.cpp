@@ -0,0 +1,168 @@
+#include "Protocol.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <Poco/Exception.h>
+#include <Poco/Net/NetException.h>
+
+namespace {
+    uint32_t readLength(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+    }
+
+    void writeHeader(char* p, MessageType type, size_t length, uint8_t flags) {
+        p[0] = static_cast<char>((length >> 24) & 0xFF);
+        p[1] = static_cast<char>((length >> 16) & 0xFF);
+        p[2] = static_cast<char>((length >> 8) & 0xFF);
+        p[3] = static_cast<char>(length & 0xFF);
+        p[4] = static_cast<char>(type);
+        p[5] = static_cast<char>(flags);
+    }
+}
+
+const char* messageTypeName(MessageType type) {
+    switch (type) {
+        case MessageType::Register: return "register";
+        case MessageType::Heartbeat: return "heartbeat";
+        case MessageType::NewTask: return "new_task";
+        case MessageType::TaskCompleted: return "task_completed";
+        case MessageType::TaskCompletedAck: return "task_completed_ack";
+        case MessageType::SubmitTask: return "submit_task";
+        case MessageType::CheckStatus: return "check_status";
+        case MessageType::StatusReply: return "status_reply";
+        case MessageType::RegisterAck: return "register_ack";
+        case MessageType::SubmitBatch: return "submit_batch";
+        case MessageType::SubmitAck: return "submit_ack";
+        case MessageType::StatusQuery: return "status_query";
+        case MessageType::StatusBatchReply: return "status_batch_reply";
+        case MessageType::ExtendLease: return "extend_lease";
+    }
+    return "unknown";
+}
+
+FrameDecoder::FrameDecoder(size_t maxFrameSize)
+    : buffer_(4096)
+    , readPos_(0)
+    , writePos_(0)
+    , maxFrameSize_(maxFrameSize) {
+}
+
+char* FrameDecoder::prepare(size_t minSpace) {
+    // Slide the unconsumed tail (at most one partial frame) to the front
+    if (readPos_ > 0) {
+        size_t pending = writePos_ - readPos_;
+        if (pending > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + readPos_, pending);
+        }
+        readPos_ = 0;
+        writePos_ = pending;
+    }
+
+    // Reserve room for the rest of a partially received large frame in one go
+    size_t needed = writePos_ + minSpace;
+    if (writePos_ >= FRAME_HEADER_SIZE) {
+        needed = std::max(needed, FRAME_HEADER_SIZE + readLength(buffer_.data()));
+    }
+    if (buffer_.size() < needed) {
+        buffer_.resize(std::max(needed, buffer_.size() * 2));
+    }
+    return buffer_.data() + writePos_;
+}
+
+void FrameDecoder::commit(size_t bytes) {
+    writePos_ += bytes;
+}
+
+bool FrameDecoder::next(Frame& frame) {
+    size_t available = writePos_ - readPos_;
+    if (available < FRAME_HEADER_SIZE) {
+        return false;
+    }
+    const char* header = buffer_.data() + readPos_;
+    size_t length = readLength(header);
+    if (length > maxFrameSize_) {
+        throw std::runtime_error("Frame of " + std::to_string(length) + " bytes exceeds the maximum frame size");
+    }
+    if (available < FRAME_HEADER_SIZE + length) {
+        return false;
+    }
+    frame.type = static_cast<MessageType>(static_cast<uint8_t>(header[4]));
+    frame.flags = static_cast<uint8_t>(header[5]);
+    frame.payload = std::string_view(header + FRAME_HEADER_SIZE, length);
+    readPos_ += FRAME_HEADER_SIZE + length;
+    if (readPos_ == writePos_) {
+        readPos_ = writePos_ = 0;
+    }
+    return true;
+}
+
+void appendFrame(std::string& out, MessageType type, std::string_view payload, uint8_t flags) {
+    size_t offset = out.size();
+    out.resize(offset + FRAME_HEADER_SIZE);
+    writeHeader(&out[offset], type, payload.size(), flags);
+    out.append(payload.data(), payload.size());
+}
+
+std::string encodeFrame(MessageType type, std::string_view payload, uint8_t flags) {
+    std::string out;
+    out.reserve(FRAME_HEADER_SIZE + payload.size());
+    appendFrame(out, type, payload, flags);
+    return out;
+}
+
+void sendFrame(Poco::Net::StreamSocket& socket, MessageType type, std::string_view payload, uint8_t flags) {
+    sendFrameParts(socket, type, payload, std::string_view(), flags);
+}
+
+void sendFrameParts(Poco::Net::StreamSocket& socket, MessageType type,
+                    std::string_view head, std::string_view tail, uint8_t flags) {
+    char header[FRAME_HEADER_SIZE];
+    writeHeader(header, type, head.size() + tail.size(), flags);
+    iovec parts[] = {
+        {header, FRAME_HEADER_SIZE},
+        {const_cast<char*>(head.data()), head.size()},
+        {const_cast<char*>(tail.data()), tail.size()},
+    };
+
+    iovec* next = parts;
+    size_t count = sizeof(parts) / sizeof(parts[0]);
+    int fd = socket.impl()->sockfd();
+    while (count > 0) {
+        if (next->iov_len == 0) {
+            ++next;
+            --count;
+            continue;
+        }
+        msghdr message{};
+        message.msg_iov = next;
+        message.msg_iovlen = count;
+        // sendmsg rather than writev: MSG_NOSIGNAL turns a dead peer into
+        // EPIPE instead of SIGPIPE
+        ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            throw Poco::TimeoutException("Timed out while sending frame");
+        }
+        if (n <= 0) {
+            throw Poco::Net::ConnectionResetException("Connection closed while sending frame");
+        }
+        // Skip what the kernel took; a short write resumes mid-part
+        size_t sent = static_cast<size_t>(n);
+        while (sent > 0) {
+            size_t step = std::min(sent, next->iov_len);
+            next->iov_base = static_cast<char*>(next->iov_base) + step;
+            next->iov_len -= step;
+            sent -= step;
+            if (next->iov_len == 0) {
+                ++next;
+                --count;
+            }
+        }
+    }
+}
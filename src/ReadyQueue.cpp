@@ -0,0 +1,86 @@
+#include "ReadyQueue.h"
+
+std::unique_ptr<ReadyQueue> ReadyQueue::create(const QueueOptions& options) {
+    if (options.backend == QueueBackend::LockFreeRing) {
+        return std::make_unique<RingReadyQueue>(options.ringCapacity);
+    }
+    return std::make_unique<MutexReadyQueue>();
+}
+
+void MutexReadyQueue::push(Task task) {
+    {
+        TimedLock lock(mutex_, lockStats_);
+        tasks_.push(std::move(task));
+    }
+    condition_.notify_one();
+}
+
+std::optional<Task> MutexReadyQueue::tryPop() {
+    TimedLock lock(mutex_, lockStats_);
+    if (tasks_.empty()) {
+        return std::nullopt;
+    }
+    return tasks_.pop();
+}
+
+Task MutexReadyQueue::pop() {
+    TimedLock lock(mutex_, lockStats_);
+    condition_.wait(lock.get(), [this] { return !tasks_.empty(); });
+    lock.restartHold();
+    return tasks_.pop();
+}
+
+bool MutexReadyQueue::empty() const {
+    TimedLock lock(mutex_, lockStats_);
+    return tasks_.empty();
+}
+
+RingReadyQueue::RingReadyQueue(size_t capacity)
+    : ring_(capacity)
+    , overflowSize_(0) {
+}
+
+void RingReadyQueue::push(Task task) {
+    if (!ring_.tryPush(std::move(task))) {
+        // tryPush only moves from task on success
+        TimedLock lock(overflowMutex_, overflowLockStats_);
+        overflow_.push_back(std::move(task));
+        overflowSize_.fetch_add(1, std::memory_order_release);
+    }
+    events_.notifyOne();
+}
+
+std::optional<Task> RingReadyQueue::tryPop() {
+    if (auto task = ring_.tryPop()) {
+        return task;
+    }
+    if (overflowSize_.load(std::memory_order_acquire) == 0) {
+        return std::nullopt;
+    }
+    TimedLock lock(overflowMutex_, overflowLockStats_);
+    if (overflow_.empty()) {
+        return std::nullopt;
+    }
+    Task task = std::move(overflow_.front());
+    overflow_.pop_front();
+    overflowSize_.fetch_sub(1, std::memory_order_release);
+    return task;
+}
+
+Task RingReadyQueue::pop() {
+    for (;;) {
+        if (auto task = tryPop()) {
+            return std::move(*task);
+        }
+        EventCount::Key key = events_.prepareWait();
+        if (auto task = tryPop()) {
+            events_.cancelWait();
+            return std::move(*task);
+        }
+        events_.wait(key);
+    }
+}
+
+bool RingReadyQueue::empty() const {
+    return ring_.approximateSize() == 0 && overflowSize_.load(std::memory_order_acquire) == 0;
+}
@@ -0,0 +1,138 @@
+#include "ServerConfig.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    long parseNumber(const std::string& option, const char* value, long min, long max) {
+        if (!value) {
+            throw std::invalid_argument(option + " requires a value");
+        }
+        char* end = nullptr;
+        long parsed = std::strtol(value, &end, 10);
+        if (*value == '\0' || *end != '\0' || parsed < min || parsed > max) {
+            throw std::invalid_argument("Invalid value for " + option + ": " + value);
+        }
+        return parsed;
+    }
+
+    SelectionPolicy parsePolicy(const std::string& option, const char* value) {
+        if (!value) {
+            throw std::invalid_argument(option + " requires a value");
+        }
+        std::string name = value;
+        if (name == "round-robin") {
+            return SelectionPolicy::RoundRobin;
+        }
+        if (name == "least-loaded") {
+            return SelectionPolicy::LeastLoaded;
+        }
+        if (name == "p2c") {
+            return SelectionPolicy::PowerOfTwoChoices;
+        }
+        if (name == "weighted") {
+            return SelectionPolicy::WeightedRoundRobin;
+        }
+        throw std::invalid_argument("Invalid value for " + option + ": " + name);
+    }
+
+    ServerTransport parseTransport(const std::string& option, const char* value) {
+        if (!value) {
+            throw std::invalid_argument(option + " requires a value");
+        }
+        std::string name = value;
+        if (name == "reactor") {
+            return ServerTransport::Reactor;
+        }
+        if (name == "epoll") {
+            return ServerTransport::Epoll;
+        }
+        if (name == "io_uring") {
+            return ServerTransport::IoUring;
+        }
+        throw std::invalid_argument("Invalid value for " + option + ": " + name);
+    }
+}
+
+ServerConfig ServerConfig::fromArgs(int argc, char* argv[]) {
+    ServerConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (option == "--port") {
+            config.port = static_cast<int>(parseNumber(option, value, 1, 65535));
+            ++i;
+        } else if (option == "--shards") {
+            config.shards = static_cast<size_t>(parseNumber(option, value, 0, 1024));
+            ++i;
+        } else if (option == "--io-threads") {
+            config.ioThreads = static_cast<size_t>(parseNumber(option, value, 0, 1024));
+            ++i;
+        } else if (option == "--db-threads") {
+            config.dbThreads = static_cast<size_t>(parseNumber(option, value, 1, 1024));
+            ++i;
+        } else if (option == "--max-prefetch") {
+            config.maxPrefetch = static_cast<int>(parseNumber(option, value, 1, 65536));
+            ++i;
+        } else if (option == "--lease-timeout") {
+            config.leaseTimeoutMs = static_cast<int>(parseNumber(option, value, 100, 86400000));
+            ++i;
+        } else if (option == "--max-retries") {
+            config.maxRetries = static_cast<int>(parseNumber(option, value, 0, 1000));
+            ++i;
+        } else if (option == "--suspect-after") {
+            config.suspectAfterMs = static_cast<int>(parseNumber(option, value, 100, 86400000));
+            ++i;
+        } else if (option == "--dead-after") {
+            config.deadAfterMs = static_cast<int>(parseNumber(option, value, 100, 86400000));
+            ++i;
+        } else if (option == "--metrics-interval") {
+            config.metricsIntervalSec = static_cast<int>(parseNumber(option, value, 0, 86400));
+            ++i;
+        } else if (option == "--cluster") {
+            config.cluster = true;
+        } else if (option == "--claim-batch") {
+            config.claimBatch = static_cast<int>(parseNumber(option, value, 1, 100000));
+            ++i;
+        } else if (option == "--claim-ownership") {
+            config.claimOwnershipMs = static_cast<int>(parseNumber(option, value, 1000, 86400000));
+            ++i;
+        } else if (option == "--wal-dir") {
+            if (!value || *value == '\0') {
+                throw std::invalid_argument(option + " requires a value");
+            }
+            config.walDirectory = value;
+            ++i;
+        } else if (option == "--transport") {
+            config.transport = parseTransport(option, value);
+            ++i;
+        } else if (option == "--balancer") {
+            config.selectionPolicy = parsePolicy(option, value);
+            ++i;
+        } else {
+            throw std::invalid_argument("Unknown option: " + option);
+        }
+    }
+    if (config.deadAfterMs <= config.suspectAfterMs) {
+        throw std::invalid_argument("--dead-after must be longer than --suspect-after");
+    }
+    return config;
+}
+
+namespace {
+    size_t coresOr(size_t configured) {
+        if (configured > 0) {
+            return configured;
+        }
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+}
+
+size_t ServerConfig::effectiveShards() const {
+    return coresOr(shards);
+}
+
+size_t ServerConfig::effectiveIoThreads() const {
+    return coresOr(ioThreads);
+}
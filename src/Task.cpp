@@ -1,34 +1,224 @@
-// Task.cpp
-#include "Task.h"
-#include <Poco/UUIDGenerator.h>
-
-Task::Task(const std::string& name, const std::string& data)
-    : name_(name)
-    , data_(data)
-    , priority_(1)
-    , status_("PENDING")
-    , completed_(false) {
-    id_ = Poco::UUIDGenerator::defaultGenerator().createOne();
-}
-
-Task::Task(const Poco::UUID& id, const std::string& name, const std::string& data)
-    : id_(id)
-    , name_(name)
-    , data_(data)
-    , priority_(1)
-    , status_("PENDING")
-    , completed_(false) {
-}
-
-Poco::UUID Task::getId() const { return id_; }
-std::string Task::getName() const { return name_; }
-std::string Task::getData() const { return data_; }
-int Task::getPriority() const { return priority_; }
-void Task::setPriority(int priority) { priority_ = priority; }
-std::string Task::getStatus() const { return status_; }
-void Task::setStatus(const std::string& status) { status_ = status; }
-bool Task::isCompleted() const { return completed_; }
-void Task::setCompleted(bool completed) { 
-    completed_ = completed;
-    status_ = completed ? "COMPLETED" : "PENDING";
-}
\ No newline at end of file
+// Task.cpp
+#include "Task.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <Poco/UUIDGenerator.h>
+
+namespace {
+    // A payload that owns its bytes outright: the string is moved, not copied.
+    Task::Payload adopt(std::string data) {
+        auto owner = std::make_shared<const std::string>(std::move(data));
+        return Task::Payload(owner, owner->data());
+    }
+
+    uint32_t checkedSize(size_t size) {
+        // Frames are capped well below this (DEFAULT_MAX_FRAME_SIZE)
+        if (size > UINT32_MAX) {
+            throw std::length_error("Task payload too large");
+        }
+        return static_cast<uint32_t>(size);
+    }
+
+    // Keys view the owned strings, so lookups by string_view never allocate.
+    struct NameTable {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string_view, std::unique_ptr<const std::string>> names;
+    };
+
+    NameTable& nameTable() {
+        static NameTable* table = new NameTable();  // outlives any static Task
+        return *table;
+    }
+
+    // A name the table had no room for, shared by copies of one Task and
+    // freed with the last of them.
+    struct CountedName : std::string {
+        explicit CountedName(std::string_view name)
+            : std::string(name)
+            , refs(1) {
+        }
+
+        mutable std::atomic<uint32_t> refs;
+    };
+
+    const CountedName* counted(const std::string* name) {
+        return static_cast<const CountedName*>(name);
+    }
+
+    const std::string& movedFromName() {
+        static const std::string* empty = new std::string();
+        return *empty;
+    }
+}
+
+const char* taskStatusName(TaskStatus status) {
+    switch (status) {
+        case TaskStatus::Pending: return "PENDING";
+        case TaskStatus::InProgress: return "IN_PROGRESS";
+        case TaskStatus::Completed: return "COMPLETED";
+        case TaskStatus::DeadLetter: return "DEAD_LETTER";
+    }
+    return "UNKNOWN";
+}
+
+TaskStatus parseTaskStatus(const std::string& name) {
+    for (TaskStatus status : {TaskStatus::Pending, TaskStatus::InProgress, TaskStatus::Completed,
+                              TaskStatus::DeadLetter}) {
+        if (name == taskStatusName(status)) {
+            return status;
+        }
+    }
+    throw std::invalid_argument("Unknown task status: " + name);
+}
+
+const std::string* TaskNames::intern(std::string_view name) {
+    NameTable& table = nameTable();
+    {
+        std::shared_lock<std::shared_mutex> lock(table.mutex);
+        auto it = table.names.find(name);
+        if (it != table.names.end()) {
+            return it->second.get();
+        }
+        if (table.names.size() >= MAX_NAMES) {
+            return nullptr;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(table.mutex);
+    auto it = table.names.find(name);
+    if (it != table.names.end()) {
+        return it->second.get();
+    }
+    if (table.names.size() >= MAX_NAMES) {
+        return nullptr;
+    }
+    auto owned = std::make_unique<const std::string>(name);
+    const std::string* interned = owned.get();
+    table.names.emplace(std::string_view(*interned), std::move(owned));
+    return interned;
+}
+
+size_t TaskNames::size() {
+    NameTable& table = nameTable();
+    std::shared_lock<std::shared_mutex> lock(table.mutex);
+    return table.names.size();
+}
+
+Task::Task(std::string_view name, std::string data)
+    : Task(Poco::UUIDGenerator::defaultGenerator().createOne(), name, std::move(data)) {
+}
+
+Task::Task(const Poco::UUID& id, std::string_view name, std::string data)
+    : id_(id)
+    , name_(nullptr)
+    , dataSize_(checkedSize(data.size()))
+    , priority_(1)
+    , status_(TaskStatus::Pending)
+    , ownsName_(false)
+    , retryCount_(0) {
+    data_ = adopt(std::move(data));
+    setName(name);
+}
+
+Task::Task(const Poco::UUID& id, std::string_view name, Payload data, size_t size)
+    : id_(id)
+    , data_(std::move(data))
+    , name_(nullptr)
+    , dataSize_(checkedSize(size))
+    , priority_(1)
+    , status_(TaskStatus::Pending)
+    , ownsName_(false)
+    , retryCount_(0) {
+    setName(name);
+}
+
+Task::Task(const Task& other)
+    : id_(other.id_)
+    , data_(other.data_)
+    , name_(other.name_)
+    , dataSize_(other.dataSize_)
+    , priority_(other.priority_)
+    , status_(other.status_)
+    , ownsName_(other.ownsName_)
+    , retryCount_(other.retryCount_) {
+    if (ownsName_) {
+        counted(name_)->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+Task::Task(Task&& other) noexcept
+    : id_(other.id_)
+    , data_(std::move(other.data_))
+    , name_(other.name_)
+    , dataSize_(other.dataSize_)
+    , priority_(other.priority_)
+    , status_(other.status_)
+    , ownsName_(other.ownsName_)
+    , retryCount_(other.retryCount_) {
+    other.name_ = &movedFromName();
+    other.ownsName_ = false;
+    other.dataSize_ = 0;
+}
+
+Task& Task::operator=(const Task& other) {
+    if (this != &other) {
+        *this = Task(other);
+    }
+    return *this;
+}
+
+Task& Task::operator=(Task&& other) noexcept {
+    if (this != &other) {
+        releaseName();
+        id_ = other.id_;
+        data_ = std::move(other.data_);
+        name_ = other.name_;
+        dataSize_ = other.dataSize_;
+        priority_ = other.priority_;
+        status_ = other.status_;
+        ownsName_ = other.ownsName_;
+        retryCount_ = other.retryCount_;
+        other.name_ = &movedFromName();
+        other.ownsName_ = false;
+        other.dataSize_ = 0;
+    }
+    return *this;
+}
+
+Task::~Task() {
+    releaseName();
+}
+
+void Task::setName(std::string_view name) {
+    name_ = TaskNames::intern(name);
+    if (!name_) {
+        name_ = new CountedName(name);
+        ownsName_ = true;
+    }
+}
+
+void Task::releaseName() {
+    if (ownsName_ && counted(name_)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete counted(name_);
+    }
+}
+
+const Poco::UUID& Task::getId() const { return id_; }
+const std::string& Task::getName() const { return *name_; }
+std::string_view Task::getData() const { return std::string_view(data_.get(), dataSize_); }
+int Task::getPriority() const { return priority_; }
+void Task::setPriority(int priority) { priority_ = priority; }
+TaskStatus Task::getStatus() const { return status_; }
+void Task::setStatus(TaskStatus status) { status_ = status; }
+bool Task::isCompleted() const { return status_ == TaskStatus::Completed; }
+void Task::setCompleted(bool completed) { 
+    status_ = completed ? TaskStatus::Completed : TaskStatus::Pending;
+}
+int Task::getRetryCount() const { return retryCount_; }
+void Task::setRetryCount(int retryCount) {
+    retryCount_ = static_cast<uint16_t>(std::clamp(retryCount, 0, int(UINT16_MAX)));
+}
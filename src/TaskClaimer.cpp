@@ -0,0 +1,108 @@
+#include "TaskClaimer.h"
+#include <iostream>
+
+TaskClaimer::TaskClaimer(ClaimStore& store, const ClusterOptions& options, const Poco::UUID& nodeId,
+                         Backlog backlog, Publish publish)
+    : store_(store)
+    , options_(options)
+    , nodeId_(nodeId)
+    , backlog_(std::move(backlog))
+    , publish_(std::move(publish))
+    , woken_(false)
+    , running_(false)
+    , claimed_(0) {
+}
+
+TaskClaimer::~TaskClaimer() {
+    stop();
+}
+
+void TaskClaimer::start() {
+    running_ = true;
+    thread_ = std::thread(&TaskClaimer::run, this);
+}
+
+void TaskClaimer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void TaskClaimer::release() {
+    try {
+        size_t released = store_.releaseClaims(nodeId_);
+        std::cout << "✓ Released " << released << " claimed tasks of node " << nodeId_.toString() << std::endl;
+    }
+    catch (const std::exception&) {
+        // Already logged; the rows become claimable when their ownership lapses
+    }
+}
+
+void TaskClaimer::publish(std::vector<Task>& batch) {
+    std::vector<Poco::UUID> ids;
+    ids.reserve(batch.size());
+    for (const Task& task : batch) {
+        ids.push_back(task.getId());
+    }
+    try {
+        publish_(batch);
+    }
+    catch (const std::exception& e) {
+        // Renewing rows nobody will dispatch would hold them forever. Any
+        // that reached a ready queue before the failure may now be
+        // delivered twice, here and by whichever node claims them next.
+        std::cerr << "❌ Publishing " << ids.size() << " claimed tasks failed: " << e.what() << std::endl;
+        unpublished_.insert(unpublished_.end(), ids.begin(), ids.end());
+    }
+}
+
+void TaskClaimer::wake() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        woken_ = true;
+    }
+    condition_.notify_one();
+}
+
+void TaskClaimer::run() {
+    using Clock = std::chrono::steady_clock;
+    auto nextRenewal = Clock::now() + options_.ownership / 3;
+    while (running_) {
+        bool full = false;
+        try {
+            if (backlog_() <= lowWatermark()) {
+                std::vector<Task> batch = store_.claimTasks(nodeId_, options_.claimBatch, options_.ownership);
+                claimed_ += batch.size();
+                full = batch.size() == options_.claimBatch;
+                if (!batch.empty()) {
+                    publish(batch);
+                }
+            }
+            if (!unpublished_.empty()) {
+                store_.releaseTasks(nodeId_, unpublished_);
+                unpublished_.clear();
+            }
+            if (Clock::now() >= nextRenewal) {
+                store_.renewClaims(nodeId_, options_.ownership);
+                nextRenewal = Clock::now() + options_.ownership / 3;
+            }
+        }
+        catch (const std::exception&) {
+            // Already logged by the store; a failed renewal or release is
+            // retried on the next round, well before the claims lapse
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        // A full batch means more rows may be waiting: check the backlog
+        // again straight away rather than after a poll interval
+        if (!full) {
+            condition_.wait_for(lock, options_.pollInterval, [this] { return woken_ || !running_; });
+        }
+        woken_ = false;
+    }
+}
@@ -1,60 +1,198 @@
-#include "TaskClient.h"
-#include <Poco/Net/StreamSocket.h>
-
-TaskClient::TaskClient(const std::string& host, int port)
-    : host_(host)
-    , port_(port) {
-}
-
-void TaskClient::submitTask(const Task& task) {
-    try {
-        Poco::Net::SocketAddress address(host_, port_);
-        Poco::Net::StreamSocket socket(address);
-        Poco::Net::SocketStream stream(socket);
-
-        Poco::JSON::Object json;
-        json.set("type", "submit_task");
-        
-        Poco::JSON::Object taskObj;
-        taskObj.set("id", task.getId().toString());
-        taskObj.set("name", task.getName());
-        taskObj.set("data", task.getData());
-        
-        json.set("task", taskObj);
-        json.stringify(stream);
-        stream.flush();
-    }
-    catch (const std::exception& e) {
-        throw std::runtime_error("Failed to submit task: " + std::string(e.what()));
-    }
-}
-
-bool TaskClient::checkTaskStatus(const Poco::UUID& taskId) {
-    try {
-        Poco::Net::SocketAddress address(host_, port_);
-        Poco::Net::StreamSocket socket(address);
-        Poco::Net::SocketStream stream(socket);
-
-        Poco::JSON::Object json;
-        json.set("type", "check_status");
-        json.set("task_id", taskId.toString());
-        
-        json.stringify(stream);
-        stream.flush();
-
-        // Read response
-        char buffer[1024];
-        int n = socket.receiveBytes(buffer, sizeof(buffer));
-        if (n > 0) {
-            std::string response(buffer, n);
-            Poco::JSON::Parser parser;
-            auto result = parser.parse(response);
-            auto object = result.extract<Poco::JSON::Object::Ptr>();
-            return object->getValue<bool>("completed");
-        }
-        return false;
-    }
-    catch (const std::exception& e) {
-        throw std::runtime_error("Failed to check task status: " + std::string(e.what()));
-    }
-}
\ No newline at end of file
+#include "TaskClient.h"
+#include <Poco/Exception.h>
+#include <stdexcept>
+
+TaskClient::TaskClient(const std::string& host, int port, Encoding encoding)
+    : host_(host)
+    , port_(port)
+    , encoding_(encoding)
+    , connected_(false)
+    , nextRequestId_(1) {
+}
+
+TaskClient::~TaskClient() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (connected_) {
+            // Unblocks the reader, which then fails anything still pending
+            try {
+                socket_.shutdown();
+            }
+            catch (const Poco::Exception&) {
+            }
+        }
+    }
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+}
+
+void TaskClient::ensureConnected() {
+    if (connected_) {
+        return;
+    }
+    if (reader_.joinable()) {
+        // The previous connection's reader fails its requests under mutex_,
+        // so it has to be joined with the lock released.
+        std::thread previous = std::move(reader_);
+        mutex_.unlock();
+        previous.join();
+        mutex_.lock();
+        if (connected_) {
+            return;
+        }
+    }
+    Poco::Net::StreamSocket socket;
+    socket.connect(Poco::Net::SocketAddress(host_, port_));
+    socket.setNoDelay(true);
+    socket_ = socket;
+    connected_ = true;
+    reader_ = std::thread(&TaskClient::readLoop, this, socket);
+}
+
+void TaskClient::send(MessageType type, std::string_view payload, std::string_view tail) {
+    try {
+        sendFrameParts(socket_, type, payload, tail, frameFlags(encoding_));
+    }
+    catch (const Poco::Exception& e) {
+        connected_ = false;
+        socket_.close();
+        throw std::runtime_error("Connection to task server lost: " + e.displayText());
+    }
+}
+
+void TaskClient::submitTask(const Task& task) {
+    try {
+        std::string payload;
+        std::string_view data = encodeTaskParts(payload, task, encoding_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ensureConnected();
+        send(MessageType::SubmitTask, payload, data);
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error("Failed to submit task: " + std::string(e.what()));
+    }
+}
+
+bool TaskClient::checkTaskStatus(const Poco::UUID& taskId) {
+    try {
+        std::vector<TaskStatusEntry> statuses = checkStatusBatch({taskId});
+        return !statuses.empty() && statuses.front().status == taskStatusName(TaskStatus::Completed);
+    }
+    catch (const std::exception& e) {
+        throw std::runtime_error("Failed to check task status: " + std::string(e.what()));
+    }
+}
+
+std::future<uint32_t> TaskClient::submit(const Task& task) {
+    return submitAsync(std::vector<Task>{task});
+}
+
+std::future<uint32_t> TaskClient::submitAsync(std::vector<Task> tasks) {
+    // Encode outside the lock; only the write is serialized
+    SubmitBatchMessage message{nextRequestId_++, std::move(tasks)};
+    std::string payload;
+    encodeMessage(payload, message, encoding_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Connect before registering the request, so a previous connection's
+    // failure can never claim it.
+    ensureConnected();
+
+    std::future<uint32_t> result = pendingSubmits_[message.requestId].get_future();
+    try {
+        send(MessageType::SubmitBatch, payload);
+    }
+    catch (...) {
+        pendingSubmits_.erase(message.requestId);
+        throw;
+    }
+    return result;
+}
+
+uint32_t TaskClient::submitBatch(const std::vector<Task>& tasks) {
+    return submitAsync(tasks).get();
+}
+
+std::future<std::vector<TaskStatusEntry>> TaskClient::checkStatusAsync(std::vector<Poco::UUID> taskIds) {
+    StatusQueryMessage message{nextRequestId_++, std::move(taskIds)};
+    std::string payload;
+    encodeMessage(payload, message, encoding_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ensureConnected();
+
+    std::future<std::vector<TaskStatusEntry>> result = pendingQueries_[message.requestId].get_future();
+    try {
+        send(MessageType::StatusQuery, payload);
+    }
+    catch (...) {
+        pendingQueries_.erase(message.requestId);
+        throw;
+    }
+    return result;
+}
+
+std::vector<TaskStatusEntry> TaskClient::checkStatusBatch(const std::vector<Poco::UUID>& taskIds) {
+    return checkStatusAsync(taskIds).get();
+}
+
+void TaskClient::readLoop(Poco::Net::StreamSocket socket) {
+    FrameDecoder decoder;
+    std::string reason = "connection closed by server";
+    try {
+        while (true) {
+            int n = socket.receiveBytes(decoder.prepare(READ_CHUNK_SIZE), static_cast<int>(READ_CHUNK_SIZE));
+            if (n <= 0) {
+                break;
+            }
+            decoder.commit(n);
+            Frame frame;
+            while (decoder.next(frame)) {
+                if (frame.type == MessageType::SubmitAck) {
+                    auto ack = decodeMessage<SubmitAckMessage>(frame);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = pendingSubmits_.find(ack.requestId);
+                    if (it != pendingSubmits_.end()) {
+                        it->second.set_value(ack.accepted);
+                        pendingSubmits_.erase(it);
+                    }
+                }
+                else if (frame.type == MessageType::StatusBatchReply) {
+                    auto reply = decodeMessage<StatusBatchReplyMessage>(frame);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = pendingQueries_.find(reply.requestId);
+                    if (it != pendingQueries_.end()) {
+                        it->second.set_value(std::move(reply.statuses));
+                        pendingQueries_.erase(it);
+                    }
+                }
+            }
+        }
+    }
+    catch (const Poco::Exception& e) {
+        reason = e.displayText();
+    }
+    catch (const std::exception& e) {
+        reason = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socket_ == socket) {
+        connected_ = false;
+        socket_.close();
+    }
+    failPending(reason);
+}
+
+void TaskClient::failPending(const std::string& reason) {
+    auto error = std::make_exception_ptr(std::runtime_error("Task server request failed: " + reason));
+    for (auto& entry : pendingSubmits_) {
+        entry.second.set_exception(error);
+    }
+    for (auto& entry : pendingQueries_) {
+        entry.second.set_exception(error);
+    }
+    pendingSubmits_.clear();
+    pendingQueries_.clear();
+}
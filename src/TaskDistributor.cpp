@@ -1,71 +1,161 @@
-#include "TaskDistributor.h"
-#include <Poco/Net/SocketStream.h>
-#include <Poco/Net/StreamSocket.h>
-#include <Poco/JSON/Object.h>
-#include <iostream>
-
-TaskDistributor::TaskDistributor(std::shared_ptr<TaskQueue> taskQueue, 
-                               std::shared_ptr<LoadBalancer> loadBalancer)
-    : taskQueue_(taskQueue)
-    , loadBalancer_(loadBalancer)
-    , running_(false) {
-}
-
-TaskDistributor::~TaskDistributor() {
-    stop();
-}
-
-void TaskDistributor::start() {
-    running_ = true;
-    distributor_thread_ = std::thread(&TaskDistributor::distributeTasks, this);
-}
-
-void TaskDistributor::stop() {
-    running_ = false;
-    if (distributor_thread_.joinable()) {
-        distributor_thread_.join();
-    }
-}
-
-void TaskDistributor::distributeTasks() {
-    while (running_) {
-        if (taskQueue_->hasTask()) {
-            Worker* worker = loadBalancer_->getNextAvailableWorker();
-            if (worker) {
-                try {
-                    Task task = taskQueue_->getNextTask();
-                    
-                    // Update assigned worker in database
-                    taskQueue_->assignTaskToWorker(task.getId(), worker->getId());
-
-                    // Create task message
-                    Poco::JSON::Object taskMessage;
-                    taskMessage.set("type", "new_task");
-
-                    Poco::JSON::Object taskObj;
-                    taskObj.set("id", task.getId().toString());
-                    taskObj.set("name", task.getName());
-                    taskObj.set("data", task.getData());
-                    taskObj.set("priority", task.getPriority());  // Include priority in message
-
-                    taskMessage.set("task", taskObj);
-
-                    // Send task to worker
-                    Poco::Net::StreamSocket socket;
-                    socket.connect(worker->getAddress());
-                    Poco::Net::SocketStream stream(socket);
-                    taskMessage.stringify(stream);
-                    stream.flush();
-                    socket.close();
-
-                    worker->setAvailable(false);
-                }
-                catch (const std::exception& e) {
-                    std::cerr << "Error distributing task: " << e.what() << std::endl;
-                    loadBalancer_->removeWorker(worker->getId());
-                }
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
-}
\ No newline at end of file
+#include "TaskDistributor.h"
+#include <iostream>
+
+TaskDistributor::TaskDistributor(std::shared_ptr<TaskQueue> taskQueue, 
+                               std::shared_ptr<LoadBalancer> loadBalancer,
+                               std::shared_ptr<SessionRegistry> sessions,
+                               std::shared_ptr<LeaseManager> leases)
+    : taskQueue_(taskQueue)
+    , loadBalancer_(loadBalancer)
+    , sessions_(sessions)
+    , leases_(leases)
+    , running_(false)
+    , nextLane_(0) {
+    for (size_t i = 0; i < taskQueue_->shardCount(); ++i) {
+        lanes_.push_back(std::make_unique<Lane>());
+    }
+    taskQueue_->setTaskListener([this](size_t shard) { notify(shard); });
+    loadBalancer_->setAvailabilityListener([this]() { onWorkerAvailable(); });
+    leases_->setExpiryListener([this](Lease lease) { onLeaseExpired(std::move(lease)); });
+    loadBalancer_->setEvictionListener([this](const Poco::UUID& workerId) { leases_->revoke(workerId); });
+}
+
+TaskDistributor::~TaskDistributor() {
+    stop();
+    taskQueue_->setTaskListener(nullptr);
+    loadBalancer_->setAvailabilityListener(nullptr);
+    leases_->setExpiryListener(nullptr);
+    loadBalancer_->setEvictionListener(nullptr);
+}
+
+void TaskDistributor::start() {
+    running_ = true;
+    for (size_t shard = 0; shard < lanes_.size(); ++shard) {
+        lanes_[shard]->thread = std::thread(&TaskDistributor::distributeTasks, this, shard);
+    }
+    leases_->start();
+    loadBalancer_->start();
+}
+
+void TaskDistributor::stop() {
+    running_ = false;
+    loadBalancer_->stop();
+    leases_->stop();
+    notify();
+    for (auto& lane : lanes_) {
+        if (lane->thread.joinable()) {
+            lane->thread.join();
+        }
+    }
+}
+
+void TaskDistributor::notify() {
+    for (size_t shard = 0; shard < lanes_.size(); ++shard) {
+        notify(shard);
+    }
+}
+
+void TaskDistributor::notify(size_t shard) {
+    Lane& lane = *lanes_[shard];
+    {
+        std::lock_guard<std::mutex> lock(lane.wakeMutex);
+        lane.wakeupPending = true;
+    }
+    lane.wakeCondition.notify_one();
+}
+
+void TaskDistributor::onWorkerAvailable() {
+    // One free worker needs one dispatcher: prefer a shard that has work,
+    // rotating the starting point so shards are served fairly.
+    size_t start = nextLane_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+        size_t shard = (start + i) % lanes_.size();
+        if (taskQueue_->hasTask(shard)) {
+            notify(shard);
+            return;
+        }
+    }
+}
+
+void TaskDistributor::onLeaseExpired(Lease lease) {
+    // Lapsed, or the worker was evicted: it is presumed gone or stuck, so
+    // its credit is no longer tied up.
+    // A completion that still arrives later is accepted (at-least-once).
+    loadBalancer_->releaseWorker(lease.workerId);
+    const Poco::UUID taskId = lease.task.getId();
+    int maxRetries = leases_->options().maxRetries;
+    if (taskQueue_->retryTask(std::move(lease.task), lease.workerId, maxRetries)) {
+        std::cerr << "Lease on task " << taskId.toString() << " held by worker "
+                  << lease.workerId.toString() << " ended, requeueing" << std::endl;
+    } else {
+        std::cerr << "Task " << taskId.toString() << " failed after " << maxRetries
+                  << " retries, moved to the dead-letter state" << std::endl;
+    }
+}
+
+void TaskDistributor::distributeTasks(size_t shard) {
+    Lane& lane = *lanes_[shard];
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> lock(lane.wakeMutex);
+            lane.wakeCondition.wait_for(lock, std::chrono::milliseconds(IDLE_RECHECK_MS),
+                [&] { return lane.wakeupPending || !running_; });
+            // Cleared before draining so events that arrive mid-drain trigger another pass.
+            lane.wakeupPending = false;
+        }
+        dispatchPending(shard);
+    }
+}
+
+size_t TaskDistributor::dispatchPending(size_t shard) {
+    size_t dispatched = 0;
+    while (running_ && taskQueue_->hasTask()) {
+        std::optional<Poco::UUID> acquired = loadBalancer_->acquireAvailableWorker();
+        if (!acquired) {
+            break;
+        }
+        Poco::UUID workerId = *acquired;
+        std::optional<Task> next = taskQueue_->tryGetNextTask(shard);
+        if (!next) {
+            // Another thread took the last task; hand the slot back.
+            loadBalancer_->releaseWorker(workerId);
+            break;
+        }
+        const Task& task = *next;
+
+        // Once the lease exists, a completion or lease expiry may hand the
+        // slot and the task back first; only whoever removes the lease does.
+        bool leased = false;
+        try {
+            // Update assigned worker in database
+            taskQueue_->assignTaskToWorker(task.getId(), workerId);
+            // Leased before sending so a fast completion always finds it
+            leases_->grant(task, workerId);
+            leased = true;
+
+            // Push the task over the worker's persistent session, encoded with
+            // whatever that connection negotiated
+            if (!sessions_->sendTask(workerId, task)) {
+                // Keep the worker registered so it can resume after reconnecting.
+                std::cerr << "No open session for worker " << workerId.toString()
+                          << ", requeueing task" << std::endl;
+                loadBalancer_->updateWorkerStatus(workerId, false);
+                if (leases_->release(task.getId(), workerId)) {
+                    loadBalancer_->releaseWorker(workerId);
+                    taskQueue_->requeueTask(task);
+                }
+                continue;
+            }
+            ++dispatched;
+        }
+        catch (const std::exception& e) {
+            // The worker itself did nothing wrong, so it stays available
+            std::cerr << "Error distributing task: " << e.what() << std::endl;
+            if (!leased || leases_->release(task.getId(), workerId)) {
+                loadBalancer_->releaseWorker(workerId);
+                taskQueue_->requeueTask(task);
+            }
+        }
+    }
+    return dispatched;
+}
@@ -1,53 +1,317 @@
-#include "TaskQueue.h"
-#include "DatabaseManager.h"
-
-TaskQueue::TaskQueue() {
-    dbManager_.init();
-    // Load pending tasks from database
-    auto pendingTasks = dbManager_.getPendingTasks();
-    for (const auto& task : pendingTasks) {
-        tasks_.push(task);
-    }
-}
-
-void TaskQueue::addTask(const Task& task) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    tasks_.push(task);
-    dbManager_.addTask(task);
-    condition_.notify_one();
-}
-
-Task TaskQueue::getNextTask() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    condition_.wait(lock, [this] { return !tasks_.empty(); });
-
-    Task task = tasks_.front();
-    tasks_.pop();
-    return task;
-}
-
-bool TaskQueue::hasTask() const {
-    std::unique_lock<std::mutex> lock(mutex_);
-    return !tasks_.empty();
-}
-
-void TaskQueue::markTaskCompleted(const Poco::UUID& taskId) {
-    Task task = dbManager_.getTask(taskId);
-    task.setCompleted(true);
-    task.setStatus("COMPLETED");
-    dbManager_.updateTaskStatus(taskId, "COMPLETED");
-}
-
-void TaskQueue::markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId) {
-    try {
-        dbManager_.markTaskCompleted(taskId, workerId);
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error marking task as completed: " << e.what() << std::endl;
-    }
-}
-
-void TaskQueue::assignTaskToWorker(const Poco::UUID& taskId, const Poco::UUID& workerId) {
-    std::string status = "IN_PROGRESS";
-    dbManager_.updateTaskAssignment(taskId, workerId, status);
-}
\ No newline at end of file
+#include "TaskQueue.h"
+#include "DatabaseManager.h"
+#include "UuidHash.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <Poco/UUIDGenerator.h>
+
+namespace {
+    // A node with a WAL keeps its id across restarts, so the records it
+    // replays are recognised as its own rather than another node's.
+    Poco::UUID clusterNodeId(const std::string& walDirectory) {
+        if (walDirectory.empty()) {
+            return Poco::UUIDGenerator::defaultGenerator().createRandom();
+        }
+        std::string path = walDirectory + "/node-id";
+        std::ifstream in(path);
+        std::string saved;
+        if (in >> saved) {
+            return Poco::UUID(saved);
+        }
+        Poco::UUID nodeId = Poco::UUIDGenerator::defaultGenerator().createRandom();
+        std::ofstream out(path, std::ios::trunc);
+        out << nodeId.toString() << '\n';
+        if (!out.flush()) {
+            throw std::runtime_error("Cannot write " + path);
+        }
+        return nodeId;
+    }
+}
+
+TaskQueue::TaskQueue(const PersistenceOptions& persistence, const QueueOptions& queue,
+                     const ClusterOptions& cluster)
+    : shardKey_(queue.shardKey)
+    , durableEnqueue_(persistence.durableEnqueue)
+    , writer_(dbManager_, persistence)
+    , recovering_(true)
+    , stopRecovery_(false)
+    , recoveredTasks_(0)
+    , ready_(0) {
+    for (size_t i = 0; i < std::max<size_t>(1, queue.shards); ++i) {
+        shards_.push_back(ReadyQueue::create(queue));
+    }
+    dbManager_.init();
+    Poco::UUID nodeId;
+    if (cluster.enabled) {
+        // Before the WAL replay: replayed updates must skip rows that other
+        // nodes took over while this one was down
+        nodeId = clusterNodeId(persistence.walDirectory);
+        dbManager_.setClaimOwner(nodeId, cluster.ownership);
+    }
+    writer_.recover();
+    if (cluster.enabled) {
+        // What this node held before a restart, and what the replay just
+        // inserted, goes back to the shared backlog. Kept, those rows would
+        // be renewed by the claimer but never dispatched.
+        dbManager_.releaseClaims(nodeId);
+        claimer_ = std::make_unique<TaskClaimer>(
+            dbManager_, cluster, nodeId,
+            [this] { return ready_.load(std::memory_order_relaxed); },
+            [this](std::vector<Task>& tasks) { publishBatch(tasks); });
+        recovering_ = false;
+        writer_.start();
+        claimer_->start();
+        std::cout << "✓ Cluster node " << nodeId.toString() << " claiming up to " << cluster.claimBatch
+                  << " tasks at a time" << std::endl;
+        return;
+    }
+    // The cursor's snapshot is taken before the writer commits anything new
+    auto cursor = dbManager_.openPendingTasks();
+    writer_.start();
+    recoveryThread_ = std::thread(&TaskQueue::recover, this, std::move(cursor));
+}
+
+TaskQueue::TaskQueue(std::unique_ptr<PendingTaskCursor> backlog, const QueueOptions& queue)
+    : shardKey_(queue.shardKey)
+    , durableEnqueue_(false)
+    , writer_(dbManager_)
+    , recovering_(true)
+    , stopRecovery_(false)
+    , recoveredTasks_(0)
+    , ready_(0) {
+    for (size_t i = 0; i < std::max<size_t>(1, queue.shards); ++i) {
+        shards_.push_back(ReadyQueue::create(queue));
+    }
+    recoveryThread_ = std::thread(&TaskQueue::recover, this, std::move(backlog));
+}
+
+TaskQueue::~TaskQueue() {
+    stopRecovery_ = true;
+    if (recoveryThread_.joinable()) {
+        recoveryThread_.join();
+    }
+    if (claimer_) {
+        claimer_->stop();
+    }
+    writer_.stop();
+    if (claimer_) {
+        // After the writer's last flush, so no owned insert lands afterwards
+        claimer_->release();
+    }
+}
+
+void TaskQueue::recover(std::unique_ptr<PendingTaskCursor> cursor) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Task> batch;
+    try {
+        while (!stopRecovery_) {
+            batch.clear();
+            if (!cursor->fetch(DatabaseManager::RECOVERY_FETCH_ROWS, batch)) {
+                break;
+            }
+            if (recoveredTasks_ == 0) {
+                auto firstBatchMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                std::cout << "✓ First " << batch.size() << " pending tasks loaded in " << firstBatchMs << " ms"
+                          << std::endl;
+            }
+            publishBatch(batch);
+            recoveredTasks_ += batch.size();
+        }
+    }
+    catch (const std::exception& e) {
+        // Rows not loaded stay PENDING in the database for the next start
+        std::cerr << "❌ Recovery of pending tasks stopped after " << recoveredTasks_ << ": " << e.what()
+                  << std::endl;
+    }
+    cursor.reset();
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "✓ Recovered " << recoveredTasks_ << " pending tasks in " << elapsedMs << " ms" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(recoveryMutex_);
+        recovering_ = false;
+    }
+    recoveryCondition_.notify_all();
+}
+
+bool TaskQueue::waitForRecovery(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(recoveryMutex_);
+    return recoveryCondition_.wait_for(lock, timeout, [this] { return !recovering_; });
+}
+
+void TaskQueue::addTask(const Task& task) {
+    // Persist step: no queue lock held
+    PersistenceWriter::Sequence sequence = writer_.insertTask(task);
+    if (durableEnqueue_ &&
+        !writer_.waitDurable(sequence, std::chrono::milliseconds(DURABLE_ENQUEUE_TIMEOUT_MS))) {
+        std::cerr << "⚠ Task " << task.getId().toString()
+                  << " not yet persisted; publishing without durability" << std::endl;
+    }
+    publish(task);
+}
+
+void TaskQueue::addTasks(const std::vector<Task>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    PersistenceWriter::Sequence sequence = writer_.insertTasks(tasks);
+    if (durableEnqueue_ &&
+        !writer_.waitDurable(sequence, std::chrono::milliseconds(DURABLE_ENQUEUE_TIMEOUT_MS))) {
+        std::cerr << "⚠ Batch of " << tasks.size()
+                  << " tasks not yet persisted; publishing without durability" << std::endl;
+    }
+    for (const auto& task : tasks) {
+        publish(task);
+    }
+}
+
+std::vector<std::string> TaskQueue::getTaskStatuses(const std::vector<Poco::UUID>& taskIds) {
+    writer_.waitApplied(writer_.lastSequence(), std::chrono::milliseconds(DURABLE_ENQUEUE_TIMEOUT_MS));
+    return dbManager_.getTaskStatuses(taskIds);
+}
+
+void TaskQueue::requeueTask(const Task& task) {
+    publish(task);
+}
+
+bool TaskQueue::retryTask(Task task, const Poco::UUID& workerId, int maxRetries) {
+    task.setRetryCount(task.getRetryCount() + 1);
+    if (task.getRetryCount() > maxRetries) {
+        writer_.deadLetterTask(task.getId(), workerId, task.getRetryCount());
+        return false;
+    }
+    writer_.requeueTask(task.getId(), workerId, task.getRetryCount());
+    publish(std::move(task));
+    return true;
+}
+
+size_t TaskQueue::shardFor(const Task& task) const {
+    if (shards_.size() == 1) {
+        return 0;
+    }
+    size_t hash = shardKey_ == ShardKey::TaskName ? std::hash<std::string>()(task.getName())
+                                                   : UuidHash()(task.getId());
+    return hash % shards_.size();
+}
+
+void TaskQueue::publish(Task task) {
+    // Publish step: the copy happened outside any lock; the shard wakes its
+    // own blocked consumers.
+    size_t shard = shardFor(task);
+    if (claimer_) {
+        ready_.fetch_add(1, std::memory_order_relaxed);
+    }
+    shards_[shard]->push(std::move(task));
+    available_.notifyOne();
+    auto listener = std::atomic_load(&listener_);
+    if (listener) {
+        (*listener)(shard);
+    }
+}
+
+void TaskQueue::publishBatch(std::vector<Task>& tasks) {
+    // One wakeup per shard touched rather than one per task
+    std::vector<bool> touched(shards_.size(), false);
+    if (claimer_) {
+        ready_.fetch_add(tasks.size(), std::memory_order_relaxed);
+    }
+    for (Task& task : tasks) {
+        size_t shard = shardFor(task);
+        shards_[shard]->push(std::move(task));
+        touched[shard] = true;
+    }
+    available_.notifyAll();
+    auto listener = std::atomic_load(&listener_);
+    if (listener) {
+        for (size_t shard = 0; shard < touched.size(); ++shard) {
+            if (touched[shard]) {
+                (*listener)(shard);
+            }
+        }
+    }
+}
+
+Task TaskQueue::getNextTask() {
+    for (;;) {
+        if (auto task = tryGetNextTask()) {
+            return std::move(*task);
+        }
+        EventCount::Key key = available_.prepareWait();
+        if (auto task = tryGetNextTask()) {
+            available_.cancelWait();
+            return std::move(*task);
+        }
+        available_.wait(key);
+    }
+}
+
+std::optional<Task> TaskQueue::tryGetNextTask() {
+    return tryGetNextTask(0);
+}
+
+std::optional<Task> TaskQueue::tryGetNextTask(size_t shard) {
+    // Own shard first, then steal by walking the others in order
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (auto task = shards_[(shard + i) % shards_.size()]->tryPop()) {
+            // Wake the claimer as the backlog crosses its low watermark
+            if (claimer_ && ready_.fetch_sub(1, std::memory_order_relaxed) - 1 == claimer_->lowWatermark()) {
+                claimer_->wake();
+            }
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
+bool TaskQueue::hasTask() const {
+    for (const auto& shard : shards_) {
+        if (!shard->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskQueue::hasTask(size_t shard) const {
+    return !shards_[shard]->empty();
+}
+
+LockStatsSnapshot TaskQueue::lockStats() const {
+    LockStatsSnapshot total;
+    for (const auto& shard : shards_) {
+        LockStatsSnapshot s = shard->lockStats();
+        total.acquisitions += s.acquisitions;
+        total.totalWaitNs += s.totalWaitNs;
+        total.totalHoldNs += s.totalHoldNs;
+        total.maxHoldNs = std::max(total.maxHoldNs, s.maxHoldNs);
+    }
+    return total;
+}
+
+void TaskQueue::setTaskListener(std::function<void(size_t shard)> listener) {
+    std::shared_ptr<const Listener> shared;
+    if (listener) {
+        shared = std::make_shared<const Listener>(std::move(listener));
+    }
+    std::atomic_store(&listener_, std::move(shared));
+}
+
+void TaskQueue::markTaskCompleted(const Poco::UUID& taskId) {
+    Task task = dbManager_.getTask(taskId);
+    task.setCompleted(true);
+    task.setStatus(TaskStatus::Completed);
+    dbManager_.updateTaskStatus(taskId, TaskStatus::Completed);
+}
+
+void TaskQueue::markTaskCompleted(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    writer_.completeTask(taskId, workerId);
+}
+
+void TaskQueue::assignTaskToWorker(const Poco::UUID& taskId, const Poco::UUID& workerId) {
+    writer_.assignTask(taskId, workerId);
+}
@@ -0,0 +1,56 @@
+#include "TaskScheduler.h"
+#include <algorithm>
+
+TaskScheduler::TaskScheduler(std::chrono::milliseconds agingInterval)
+    : nonEmpty_(0)
+    , size_(0)
+    , agingInterval_(agingInterval) {
+}
+
+int TaskScheduler::levelFor(int priority) {
+    return std::max(0, std::min(LEVELS - 1, priority));
+}
+
+void TaskScheduler::push(const Task& task) {
+    push(Task(task));
+}
+
+void TaskScheduler::push(Task&& task) {
+    int level = levelFor(task.getPriority());
+    levels_[level].push_back(Entry{std::move(task), Clock::now()});
+    nonEmpty_ |= (uint64_t(1) << level);
+    ++size_;
+}
+
+Task TaskScheduler::pop() {
+    // Pick the bucket whose head has the highest effective priority. Walking
+    // the bitmap from the top means ties go to the higher base level.
+    const auto now = Clock::now();
+    const auto interval = agingInterval_.count();
+    int best = -1;
+    long long bestScore = -1;
+    for (uint64_t bits = nonEmpty_; bits != 0;) {
+        int level = 63 - __builtin_clzll(bits);
+        bits &= ~(uint64_t(1) << level);
+
+        long long score = level;
+        if (interval > 0) {
+            auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - levels_[level].front().enqueuedAt).count();
+            score += waited / interval;
+        }
+        if (score > bestScore) {
+            best = level;
+            bestScore = score;
+        }
+    }
+
+    auto& bucket = levels_[best];
+    Task task = std::move(bucket.front().task);
+    bucket.pop_front();
+    if (bucket.empty()) {
+        nonEmpty_ &= ~(uint64_t(1) << best);
+    }
+    --size_;
+    return task;
+}
@@ -1,34 +1,42 @@
-#include "Worker.h"
-#include <Poco/UUIDGenerator.h>
-#include <ctime>  // Add this include
-
-Worker::Worker(const std::string& address, int port)
-    : address_(address, port)
-    , available_(true) {
-    id_ = Poco::UUIDGenerator::defaultGenerator().createOne();
-    updateLastHeartbeat();
-}
-
-Poco::UUID Worker::getId() const {
-    return id_;
-}
-
-Poco::Net::SocketAddress Worker::getAddress() const {
-    return address_;
-}
-
-bool Worker::isAvailable() const {
-    return available_;
-}
-
-void Worker::setAvailable(bool available) {
-    available_ = available;
-}
-
-void Worker::updateLastHeartbeat() {
-    lastHeartbeat_ = std::time(nullptr);
-}
-
-bool Worker::isAlive() const {
-    return (std::time(nullptr) - lastHeartbeat_) < HEARTBEAT_TIMEOUT;
-}
\ No newline at end of file
+#include "Worker.h"
+#include <Poco/UUIDGenerator.h>
+
+Worker::Worker(const std::string& address, int port)
+    : address_(address, port)
+    , capacity_(1)
+    , credits_(1)
+    , available_(true) {
+    id_ = Poco::UUIDGenerator::defaultGenerator().createOne();
+}
+
+Worker::Worker(const Poco::UUID& id, const Poco::Net::SocketAddress& address, int capacity, int credits)
+    : id_(id)
+    , address_(address)
+    , capacity_(capacity > 0 ? capacity : 1)
+    , credits_(credits > 0 ? credits : capacity_)
+    , available_(true) {
+}
+
+Poco::UUID Worker::getId() const {
+    return id_;
+}
+
+Poco::Net::SocketAddress Worker::getAddress() const {
+    return address_;
+}
+
+int Worker::getCapacity() const {
+    return capacity_;
+}
+
+int Worker::getCredits() const {
+    return credits_;
+}
+
+bool Worker::isAvailable() const {
+    return available_;
+}
+
+void Worker::setAvailable(bool available) {
+    available_ = available;
+}
@@ -1,210 +1,454 @@
-// WorkerNode.cpp
-#include "WorkerNode.h"
-#include <Poco/Net/SocketStream.h>
-#include <Poco/JSON/Object.h>
-#include <Poco/JSON/Parser.h>
-#include <iostream>
-#include <chrono>
-#include <iomanip>
-
-WorkerNode::WorkerNode(const std::string& serverHost, int serverPort)
-    : serverHost_(serverHost)
-    , serverPort_(serverPort)
-    , running_(false)
-    , workerId_(Poco::UUIDGenerator::defaultGenerator().createOne())
-    , heartbeatRunnable_(new HeartbeatRunnable(this))
-    , currentLoad_(0.0f)
-    , rng_(std::random_device{}())
-    , loadDist_(-0.1f, 0.1f) {
-}
-
-WorkerNode::~WorkerNode() {
-    stop();
-    delete heartbeatRunnable_;
-}
-
-void WorkerNode::start() {
-    if (!running_) {
-        running_ = true;
-        heartbeatThread_.start(*heartbeatRunnable_);
-        
-        try {
-            socket_.connect(Poco::Net::SocketAddress(serverHost_, serverPort_));
-            std::cout << "Connected to server at " << serverHost_ << ":" << serverPort_ << std::endl;
-            
-            // Start task processing thread
-            taskThread_ = std::thread([this]() {
-                char buffer[4096];
-                while (running_) {
-                    try {
-                        int n = socket_.receiveBytes(buffer, sizeof(buffer));
-                        if (n > 0) {
-                            std::string message(buffer, n);
-                            
-                            // Parse task message
-                            Poco::JSON::Parser parser;
-                            Poco::Dynamic::Var result = parser.parse(message);
-                            Poco::JSON::Object::Ptr object = result.extract<Poco::JSON::Object::Ptr>();
-                            
-                            if (object->getValue<std::string>("type") == "new_task") {
-                                Poco::JSON::Object::Ptr taskObj = object->getObject("task");
-                                Task task(
-                                    Poco::UUID(taskObj->getValue<std::string>("id")),
-                                    taskObj->getValue<std::string>("name"),
-                                    taskObj->getValue<std::string>("data")
-                                );
-                                processTask(task);
-                            }
-                        }
-                    }
-                    catch (const std::exception& e) {
-                        std::cerr << "Error processing message: " << e.what() << std::endl;
-                    }
-                }
-            });
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Error connecting to server: " << e.what() << std::endl;
-            running_ = false;
-            throw;
-        }
-    }
-}
-
-void WorkerNode::stop() {
-    if (running_) {
-        running_ = false;
-        
-        if (taskThread_.joinable()) {
-            taskThread_.join();
-        }
-        
-        heartbeatThread_.join();
-        socket_.close();
-    }
-}
-
-void WorkerNode::updateLoad() {
-    // Simulate load changes with random walk
-    float newLoad = currentLoad_ + loadDist_(rng_);
-    // Clamp between 0 and 1
-    newLoad = std::max(0.0f, std::min(1.0f, newLoad));
-    currentLoad_ = newLoad;
-}
-
-void WorkerNode::drawStats() const {
-    std::cout << "\033[2J\033[H"; // Clear screen and move cursor to top
-    std::cout << "╔════════════════════════════════════╗" << std::endl;
-    std::cout << "║           Worker Status            ║" << std::endl;
-    std::cout << "╠════════════════════════════════════╣" << std::endl;
-    std::cout << "║ Worker ID: " << workerId_.toString() << std::endl;
-    std::cout << "║ Server: " << serverHost_ << ":" << serverPort_ << std::endl;
-    std::cout << "║ Current Load: " << std::fixed << std::setprecision(2) 
-              << (currentLoad_ * 100.0f) << "%" << std::endl;
-    
-    // Visual load bar
-    std::cout << "║ Load: [";
-    int barWidth = 20;
-    int filledWidth = static_cast<int>(currentLoad_ * barWidth);
-    for (int i = 0; i < barWidth; ++i) {
-        if (i < filledWidth) std::cout << "█";
-        else std::cout << " ";
-    }
-    std::cout << "]" << std::endl;
-    std::cout << "╚════════════════════════════════════╝" << std::endl;
-}
-
-void WorkerNode::processTask(const Task& task) {
-    std::cout << "\n╔════════════════════════════════════╗" << std::endl;
-    std::cout << "║ Processing Task: " << task.getName() << std::endl;
-    std::cout << "║ Task ID: " << task.getId().toString() << std::endl;
-    std::cout << "║ Priority: " << task.getPriority() << std::endl;
-    std::cout << "╚════════════════════════════════════╝\n" << std::endl;
-
-    // Simulate task processing
-    std::this_thread::sleep_for(std::chrono::seconds(2));
-
-    try {
-        // Send completion notification to server
-        Poco::JSON::Object completionMessage;
-        completionMessage.set("type", "task_completed");
-        completionMessage.set("task_id", task.getId().toString());
-        completionMessage.set("worker_id", workerId_.toString());
-
-        Poco::Net::StreamSocket completionSocket;
-        completionSocket.connect(Poco::Net::SocketAddress(serverHost_, serverPort_));
-        Poco::Net::SocketStream stream(completionSocket);
-        completionMessage.stringify(stream);
-        stream.flush();
-        completionSocket.close();
-
-        std::cout << "\n╔════════════════════════════════════╗" << std::endl;
-        std::cout << "║ Task Completed Successfully!         ║" << std::endl;
-        std::cout << "║ Task: " << task.getName() << std::endl;
-        std::cout << "╚════════════════════════════════════╝\n" << std::endl;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error sending completion notification: " << e.what() << std::endl;
-    }
-}
-
-void HeartbeatRunnable::run() {
-    while (worker_->isRunning()) {
-        try {
-            // Update load randomly
-            worker_->updateLoad();
-
-            // Create heartbeat message
-            Poco::JSON::Object heartbeat;
-            heartbeat.set("type", "heartbeat");
-            heartbeat.set("worker_id", worker_->workerId_.toString());
-            heartbeat.set("load", worker_->getCurrentLoad());
-
-            // Send heartbeat
-            Poco::Net::StreamSocket heartbeatSocket;
-            heartbeatSocket.connect(Poco::Net::SocketAddress(worker_->serverHost_, worker_->serverPort_));
-            Poco::Net::SocketStream stream(heartbeatSocket);
-            heartbeat.stringify(stream);
-            stream.flush();
-            heartbeatSocket.close();
-
-            // Display current stats
-            worker_->drawStats();
-        }
-        catch (const std::exception& e) {
-            std::cerr << "Error sending heartbeat: " << e.what() << std::endl;
-        }
-
-        Poco::Thread::sleep(1000); // Sleep for 1 second between heartbeats
-    }
-}
-
-// Main function implementation
-int main(int argc, char* argv[]) {
-    try {
-        std::string serverHost = "localhost";  // Default host
-        int serverPort = 8080;                 // Default port
-
-        // Parse command line arguments if provided
-        if (argc >= 2) serverHost = argv[1];
-        if (argc >= 3) serverPort = std::stoi(argv[2]);
-
-        std::cout << "Starting worker node..." << std::endl;
-        std::cout << "Connecting to server at " << serverHost << ":" << serverPort << std::endl;
-
-        WorkerNode worker(serverHost, serverPort);
-        worker.start();
-
-        // Wait for Ctrl+C
-        std::cout << "Worker node running. Press Ctrl+C to stop." << std::endl;
-        while (worker.isRunning()) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
-
-        return 0;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
-    }
+// WorkerNode.cpp
+#include "WorkerNode.h"
+#include "IoLoop.h"
+#include <Poco/Exception.h>
+#include <Poco/Timespan.h>
+#include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <cstring>
+#include <optional>
+
+namespace {
+    size_t defaultSlots() {
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores > 0 ? cores : 1;
+    }
+}
+
+WorkerNode::WorkerNode(const std::string& serverHost, int serverPort, size_t slots, size_t prefetch,
+                       bool ioUring)
+    : serverHost_(serverHost)
+    , serverPort_(serverPort)
+    , running_(false)
+    , workerId_(Poco::UUIDGenerator::defaultGenerator().createOne())
+    , connected_(false)
+    , encoding_(Encoding::Json)
+    , slots_(slots > 0 ? slots : defaultSlots())
+    , prefetch_(prefetch > 0 ? prefetch : 2 * slots_)
+    , ioUring_(ioUring)
+    , busySlots_(0)
+    , heartbeatRunnable_(new HeartbeatRunnable(this))
+    , currentLoad_(0.0f) {
+}
+
+WorkerNode::~WorkerNode() {
+    stop();
+    delete heartbeatRunnable_;
+}
+
+void WorkerNode::start() {
+    if (!running_) {
+        running_ = true;
+        heartbeatThread_.start(*heartbeatRunnable_);
+        
+        try {
+            connect();
+            std::cout << "Connected to server at " << serverHost_ << ":" << serverPort_
+                      << " with " << slots_ << " execution slot(s), prefetch " << prefetch_ << std::endl;
+            
+            for (size_t i = 0; i < slots_; ++i) {
+                executors_.emplace_back(&WorkerNode::executorLoop, this);
+            }
+            reporterThread_ = std::thread(&WorkerNode::reporterLoop, this);
+            taskThread_ = std::thread(&WorkerNode::receiveLoop, this);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error connecting to server: " << e.what() << std::endl;
+            running_ = false;
+            heartbeatThread_.join();
+            throw;
+        }
+    }
+}
+
+void WorkerNode::stop() {
+    if (running_) {
+        running_ = false;
+        
+        if (taskThread_.joinable()) {
+            taskThread_.join();
+        }
+
+        // Executors finish the task in hand; tasks still queued in the inbox
+        // are abandoned, and the server redelivers them once their leases lapse.
+        { std::lock_guard<std::mutex> lock(inboxMutex_); }
+        inboxCondition_.notify_all();
+        for (auto& executor : executors_) {
+            executor.join();
+        }
+        executors_.clear();
+        { std::lock_guard<std::mutex> lock(completionsMutex_); }
+        completionsCondition_.notify_all();
+        if (reporterThread_.joinable()) {
+            reporterThread_.join();
+        }
+        
+        heartbeatThread_.join();
+        disconnect();
+    }
+}
+
+void WorkerNode::connect() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    Poco::Net::StreamSocket socket;
+    socket.connect(Poco::Net::SocketAddress(serverHost_, serverPort_));
+    socket.setNoDelay(true);
+    socket.setKeepAlive(true);
+    // Bounded receive so the loop notices stop() without waiting for traffic
+    socket.setReceiveTimeout(Poco::Timespan(1, 0));
+    socket_ = socket;
+    connected_ = true;
+    encoding_ = Encoding::Json;
+
+    // Register (or re-register after a reconnect) under the same worker id,
+    // offering the binary encoding. Registration is always sent as JSON.
+    std::string payload;
+    encodeMessage(payload,
+                  RegisterMessage{workerId_, true, static_cast<uint32_t>(slots_), static_cast<uint32_t>(prefetch_)},
+                  Encoding::Json);
+    sendLocked(MessageType::Register, payload, frameFlags(Encoding::Json));
+
+    // Resume: replay completions the previous session never acknowledged
+    std::lock_guard<std::mutex> outboxLock(outboxMutex_);
+    for (const auto& taskId : unackedCompletions_) {
+        payload.clear();
+        encodeMessage(payload, TaskCompletedMessage{taskId, workerId_}, Encoding::Json);
+        sendLocked(MessageType::TaskCompleted, payload, frameFlags(Encoding::Json));
+    }
+}
+
+void WorkerNode::disconnect() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    connected_ = false;
+    socket_.close();
+}
+
+void WorkerNode::receiveLoop() {
+    FrameDecoder decoder;
+    int backoffMs = INITIAL_BACKOFF_MS;
+
+    while (running_) {
+        if (!connected_) {
+            disconnect();
+            try {
+                connect();
+                decoder = FrameDecoder();
+                backoffMs = INITIAL_BACKOFF_MS;
+                std::cout << "Reconnected to server at " << serverHost_ << ":" << serverPort_ << std::endl;
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Reconnect failed: " << e.what()
+                          << " (retrying in " << backoffMs << " ms)" << std::endl;
+                std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+                backoffMs = std::min(backoffMs * 2, MAX_BACKOFF_MS);
+                continue;
+            }
+        }
+
+        if (ioUring_) {
+            receiveWithLoop();
+            continue;
+        }
+
+        try {
+            int n = socket_.receiveBytes(decoder.prepare(READ_CHUNK_SIZE), static_cast<int>(READ_CHUNK_SIZE));
+            if (n <= 0) {
+                std::cerr << "Server closed the connection" << std::endl;
+                connected_ = false;
+                continue;
+            }
+            decoder.commit(n);
+            Frame frame;
+            while (decoder.next(frame)) {
+                handleFrame(frame);
+            }
+        }
+        catch (const Poco::TimeoutException&) {
+            // No traffic; loop to re-check running_
+        }
+        catch (const Poco::Exception& e) {
+            std::cerr << "Connection error: " << e.displayText() << std::endl;
+            connected_ = false;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Protocol error: " << e.what() << std::endl;
+            connected_ = false;
+        }
+    }
+}
+
+// Decodes what the IoLoop read for the current connection.
+class WorkerNode::LoopReceiver : public IoHandler {
+public:
+    explicit LoopReceiver(WorkerNode& node) : node_(node) {}
+
+    bool onData(const char* data, size_t size) override {
+        try {
+            std::memcpy(decoder_.prepare(size), data, size);
+            decoder_.commit(size);
+            Frame frame;
+            while (decoder_.next(frame)) {
+                node_.handleFrame(frame);
+            }
+            return true;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Protocol error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    void onClose() override {
+        std::cerr << "Server connection closed" << std::endl;
+        node_.connected_ = false;
+    }
+
+private:
+    WorkerNode& node_;
+    FrameDecoder decoder_;
+};
+
+void WorkerNode::receiveWithLoop() {
+    // A fresh loop per connection; it is gone before disconnect() closes
+    // the socket it reads from.
+    try {
+        auto loop = IoLoop::create(IoBackend::IoUring);
+        loop->add(socket_.impl()->sockfd(), std::make_unique<LoopReceiver>(*this));
+        while (running_ && connected_) {
+            loop->runOnce(RECEIVE_POLL_MS);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Connection error: " << e.what() << std::endl;
+        connected_ = false;
+    }
+}
+
+void WorkerNode::handleFrame(const Frame& frame) {
+    try {
+        if (frame.type == MessageType::NewTask) {
+            // Hand off to the executor pool; never block the receive thread
+            Task task = decodeTask(frame.payload, frameEncoding(frame), &arena_);
+            {
+                std::lock_guard<std::mutex> lock(inboxMutex_);
+                inbox_.push_back(std::move(task));
+            }
+            inboxCondition_.notify_one();
+        }
+        else if (frame.type == MessageType::TaskCompletedAck) {
+            auto ack = decodeMessage<TaskCompletedAckMessage>(frame);
+            std::lock_guard<std::mutex> lock(outboxMutex_);
+            unackedCompletions_.erase(ack.taskId);
+        }
+        else if (frame.type == MessageType::RegisterAck) {
+            encoding_ = decodeMessage<RegisterAckMessage>(frame).encoding;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error processing message: " << e.what() << std::endl;
+    }
+}
+
+bool WorkerNode::sendLocked(MessageType type, const std::string& payload, uint8_t flags) {
+    if (!connected_) {
+        return false;
+    }
+    try {
+        sendFrame(socket_, type, payload, flags);
+        return true;
+    }
+    catch (const Poco::Exception& e) {
+        std::cerr << "Error sending to server: " << e.displayText() << std::endl;
+        connected_ = false;
+        return false;
+    }
+}
+
+void WorkerNode::executorLoop() {
+    while (true) {
+        std::optional<Task> task;
+        {
+            std::unique_lock<std::mutex> lock(inboxMutex_);
+            inboxCondition_.wait(lock, [this] { return !inbox_.empty() || !running_; });
+            if (!running_) {
+                return;
+            }
+            task.emplace(std::move(inbox_.front()));
+            inbox_.pop_front();
+            runningTasks_.insert(task->getId());
+        }
+        ++busySlots_;
+        processTask(*task);
+        --busySlots_;
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        runningTasks_.erase(task->getId());
+    }
+}
+
+void WorkerNode::reportCompletion(const Poco::UUID& taskId) {
+    // Kept in the outbox until acked, so a completion survives a reconnect
+    {
+        std::lock_guard<std::mutex> lock(outboxMutex_);
+        unackedCompletions_.insert(taskId);
+    }
+    {
+        std::lock_guard<std::mutex> lock(completionsMutex_);
+        completions_.push_back(taskId);
+    }
+    completionsCondition_.notify_one();
+}
+
+void WorkerNode::reporterLoop() {
+    std::deque<Poco::UUID> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(completionsMutex_);
+            completionsCondition_.wait(lock, [this] { return !completions_.empty() || !running_; });
+            if (completions_.empty()) {
+                return;
+            }
+            batch.swap(completions_);
+        }
+        for (const auto& taskId : batch) {
+            if (!sendMessage(MessageType::TaskCompleted, TaskCompletedMessage{taskId, workerId_})) {
+                std::cerr << "Completion queued until the server connection resumes" << std::endl;
+            }
+        }
+        batch.clear();
+    }
+}
+
+void WorkerNode::extendLeases() {
+    // Queued tasks count too: they were delivered, and waiting behind a
+    // slow task must not get them redelivered elsewhere.
+    ExtendLeaseMessage message{workerId_, {}};
+    {
+        std::lock_guard<std::mutex> lock(inboxMutex_);
+        message.taskIds.assign(runningTasks_.begin(), runningTasks_.end());
+        for (const auto& task : inbox_) {
+            message.taskIds.push_back(task.getId());
+        }
+    }
+    if (!message.taskIds.empty()) {
+        sendMessage(MessageType::ExtendLease, message);
+    }
+}
+
+size_t WorkerNode::getFreeSlots() const {
+    std::lock_guard<std::mutex> lock(inboxMutex_);
+    size_t occupied = busySlots_ + inbox_.size();
+    return occupied < slots_ ? slots_ - occupied : 0;
+}
+
+void WorkerNode::updateLoad() {
+    // Fraction of execution slots in use
+    currentLoad_ = static_cast<float>(busySlots_) / static_cast<float>(slots_);
+}
+
+void WorkerNode::drawStats() const {
+    std::cout << "\033[2J\033[H"; // Clear screen and move cursor to top
+    std::cout << "╔════════════════════════════════════╗" << std::endl;
+    std::cout << "║           Worker Status            ║" << std::endl;
+    std::cout << "╠════════════════════════════════════╣" << std::endl;
+    std::cout << "║ Worker ID: " << workerId_.toString() << std::endl;
+    std::cout << "║ Server: " << serverHost_ << ":" << serverPort_ << std::endl;
+    std::cout << "║ Current Load: " << std::fixed << std::setprecision(2) 
+              << (currentLoad_ * 100.0f) << "%" << std::endl;
+    std::cout << "║ Slots: " << busySlots_ << " busy / " << slots_ << std::endl;
+    
+    // Visual load bar
+    std::cout << "║ Load: [";
+    int barWidth = 20;
+    int filledWidth = static_cast<int>(currentLoad_ * barWidth);
+    for (int i = 0; i < barWidth; ++i) {
+        if (i < filledWidth) std::cout << "█";
+        else std::cout << " ";
+    }
+    std::cout << "]" << std::endl;
+    std::cout << "╚════════════════════════════════════╝" << std::endl;
+}
+
+void WorkerNode::processTask(const Task& task) {
+    std::cout << "\n╔════════════════════════════════════╗" << std::endl;
+    std::cout << "║ Processing Task: " << task.getName() << std::endl;
+    std::cout << "║ Task ID: " << task.getId().toString() << std::endl;
+    std::cout << "║ Priority: " << task.getPriority() << std::endl;
+    std::cout << "╚════════════════════════════════════╝\n" << std::endl;
+
+    // Simulate task processing
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    try {
+        reportCompletion(task.getId());
+
+        std::cout << "\n╔════════════════════════════════════╗" << std::endl;
+        std::cout << "║ Task Completed Successfully!         ║" << std::endl;
+        std::cout << "║ Task: " << task.getName() << std::endl;
+        std::cout << "╚════════════════════════════════════╝\n" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error sending completion notification: " << e.what() << std::endl;
+    }
+}
+
+void HeartbeatRunnable::run() {
+    int beats = 0;
+    while (worker_->isRunning()) {
+        try {
+            // Report the fraction of slots busy right now
+            worker_->updateLoad();
+
+            // Send heartbeat over the persistent session (skipped while reconnecting)
+            worker_->sendMessage(MessageType::Heartbeat,
+                HeartbeatMessage{worker_->workerId_, worker_->getCurrentLoad(),
+                                 static_cast<uint32_t>(worker_->getFreeSlots())});
+            if (++beats % WorkerNode::LEASE_EXTEND_EVERY_HEARTBEATS == 0) {
+                worker_->extendLeases();
+            }
+
+            // Display current stats
+            worker_->drawStats();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error sending heartbeat: " << e.what() << std::endl;
+        }
+
+        Poco::Thread::sleep(1000); // Sleep for 1 second between heartbeats
+    }
+}
+
+// Main function implementation
+int main(int argc, char* argv[]) {
+    try {
+        std::string serverHost = "localhost";  // Default host
+        int serverPort = 8080;                 // Default port
+        size_t slots = 0;                      // Default: one per core
+        size_t prefetch = 0;                   // Default: two per slot
+
+        // Parse command line arguments if provided
+        if (argc >= 2) serverHost = argv[1];
+        if (argc >= 3) serverPort = std::stoi(argv[2]);
+        if (argc >= 4) slots = std::stoul(argv[3]);
+        if (argc >= 5) prefetch = std::stoul(argv[4]);
+        bool ioUring = argc >= 6 && std::string(argv[5]) == "io_uring";
+
+        std::cout << "Starting worker node..." << std::endl;
+        std::cout << "Connecting to server at " << serverHost << ":" << serverPort << std::endl;
+
+        WorkerNode worker(serverHost, serverPort, slots, prefetch, ioUring);
+        worker.start();
+
+        // Wait for Ctrl+C
+        std::cout << "Worker node running. Press Ctrl+C to stop." << std::endl;
+        while (worker.isRunning()) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "WorkerSelector.h"
+#include <algorithm>
+
+std::unique_ptr<WorkerSelector> WorkerSelector::create(SelectionPolicy policy) {
+    switch (policy) {
+    case SelectionPolicy::LeastLoaded:
+        return std::make_unique<LeastLoadedSelector>();
+    case SelectionPolicy::PowerOfTwoChoices:
+        return std::make_unique<PowerOfTwoSelector>();
+    case SelectionPolicy::WeightedRoundRobin:
+        return std::make_unique<WeightedRoundRobinSelector>();
+    case SelectionPolicy::RoundRobin:
+    default:
+        return std::make_unique<RoundRobinSelector>();
+    }
+}
+
+// RoundRobinSelector
+
+void RoundRobinSelector::update(const Poco::UUID& id, double, int) {
+    workers_.insert(id);
+}
+
+void RoundRobinSelector::remove(const Poco::UUID& id) {
+    workers_.erase(id);
+}
+
+std::optional<Poco::UUID> RoundRobinSelector::pick() {
+    if (workers_.empty()) {
+        return std::nullopt;
+    }
+    // Next id after the previous pick, wrapping around
+    auto it = workers_.upper_bound(last_);
+    if (it == workers_.end()) {
+        it = workers_.begin();
+    }
+    last_ = *it;
+    return last_;
+}
+
+// LeastLoadedSelector
+
+void LeastLoadedSelector::update(const Poco::UUID& id, double score, int) {
+    auto existing = scores_.find(id);
+    if (existing != scores_.end()) {
+        if (existing->second == score) {
+            return;
+        }
+        byScore_.erase({existing->second, id});
+        existing->second = score;
+    } else {
+        scores_.emplace(id, score);
+    }
+    byScore_.insert({score, id});
+}
+
+void LeastLoadedSelector::remove(const Poco::UUID& id) {
+    auto existing = scores_.find(id);
+    if (existing != scores_.end()) {
+        byScore_.erase({existing->second, id});
+        scores_.erase(existing);
+    }
+}
+
+std::optional<Poco::UUID> LeastLoadedSelector::pick() {
+    if (byScore_.empty()) {
+        return std::nullopt;
+    }
+    return byScore_.begin()->second;
+}
+
+// PowerOfTwoSelector
+
+PowerOfTwoSelector::PowerOfTwoSelector()
+    : rng_(std::random_device{}()) {
+}
+
+void PowerOfTwoSelector::update(const Poco::UUID& id, double score, int) {
+    auto existing = index_.find(id);
+    if (existing != index_.end()) {
+        entries_[existing->second].score = score;
+    } else {
+        index_.emplace(id, entries_.size());
+        entries_.push_back(Entry{id, score});
+    }
+}
+
+void PowerOfTwoSelector::remove(const Poco::UUID& id) {
+    auto existing = index_.find(id);
+    if (existing == index_.end()) {
+        return;
+    }
+    size_t slot = existing->second;
+    index_.erase(existing);
+    if (slot != entries_.size() - 1) {
+        entries_[slot] = entries_.back();
+        index_[entries_[slot].id] = slot;
+    }
+    entries_.pop_back();
+}
+
+std::optional<Poco::UUID> PowerOfTwoSelector::pick() {
+    if (entries_.empty()) {
+        return std::nullopt;
+    }
+    std::uniform_int_distribution<size_t> dist(0, entries_.size() - 1);
+    const Entry& a = entries_[dist(rng_)];
+    const Entry& b = entries_[dist(rng_)];
+    return (b.score < a.score ? b : a).id;
+}
+
+// WeightedRoundRobinSelector
+
+void WeightedRoundRobinSelector::update(const Poco::UUID& id, double, int weight) {
+    weight = std::max(1, weight);
+    auto existing = workers_.find(id);
+    if (existing != workers_.end()) {
+        existing->second.weight = weight;
+        return;
+    }
+    // Start at the current pass so a newcomer gets its fair share from now
+    // on instead of a burst that makes up for the time it was absent.
+    workers_.emplace(id, State{globalPass_, weight});
+    byPass_.insert({globalPass_, id});
+}
+
+void WeightedRoundRobinSelector::remove(const Poco::UUID& id) {
+    auto existing = workers_.find(id);
+    if (existing != workers_.end()) {
+        byPass_.erase({existing->second.pass, id});
+        workers_.erase(existing);
+    }
+}
+
+std::optional<Poco::UUID> WeightedRoundRobinSelector::pick() {
+    if (byPass_.empty()) {
+        return std::nullopt;
+    }
+    auto first = byPass_.begin();
+    Poco::UUID id = first->second;
+    State& state = workers_[id];
+    globalPass_ = state.pass;
+    byPass_.erase(first);
+    state.pass += STRIDE / static_cast<uint64_t>(state.weight);
+    byPass_.insert({state.pass, id});
+    return id;
+}
@@ -0,0 +1,71 @@
+#include "WorkerSession.h"
+#include <iostream>
+
+WorkerSession::WorkerSession(const Poco::Net::StreamSocket& socket)
+    : socket_(socket)
+    , open_(true)
+    , encoding_(Encoding::Json) {
+}
+
+bool WorkerSession::send(MessageType type, std::string_view payload, uint8_t flags) {
+    return sendParts(type, payload, std::string_view(), flags);
+}
+
+bool WorkerSession::sendParts(MessageType type, std::string_view head, std::string_view tail, uint8_t flags) {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    if (!open_) {
+        return false;
+    }
+    try {
+        sendFrameParts(socket_, type, head, tail, flags);
+        return true;
+    }
+    catch (const Poco::Exception& exc) {
+        std::cerr << "Error sending to worker session: " << exc.displayText() << std::endl;
+        open_ = false;
+        return false;
+    }
+}
+
+bool WorkerSession::sendTask(MessageType type, const Task& task) {
+    // The task data is written straight from its shared buffer
+    Encoding encoding = encoding_;
+    std::string& head = encodeScratch();
+    std::string_view data = encodeTaskParts(head, task, encoding);
+    return sendParts(type, head, data, frameFlags(encoding));
+}
+
+void WorkerSession::close() {
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    open_ = false;
+}
+
+Poco::Net::SocketAddress WorkerSession::peerAddress() const {
+    return socket_.peerAddress();
+}
+
+void SessionRegistry::bind(const Poco::UUID& workerId, std::shared_ptr<WorkerSession> session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_[workerId] = std::move(session);
+}
+
+bool SessionRegistry::unbind(const Poco::UUID& workerId, const std::shared_ptr<WorkerSession>& session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(workerId);
+    if (it == sessions_.end() || it->second != session) {
+        return false;
+    }
+    sessions_.erase(it);
+    return true;
+}
+
+std::shared_ptr<WorkerSession> SessionRegistry::find(const Poco::UUID& workerId) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sessions_.find(workerId);
+    return it != sessions_.end() ? it->second : nullptr;
+}
+
+bool SessionRegistry::sendTask(const Poco::UUID& workerId, const Task& task) {
+    std::shared_ptr<WorkerSession> session = find(workerId);
+    return session && session->sendTask(MessageType::NewTask, task);
+}
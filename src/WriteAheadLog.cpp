@@ -0,0 +1,365 @@
+#include "WriteAheadLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <system_error>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <Poco/Checksum.h>
+
+namespace {
+    [[noreturn]] void throwErrno(const std::string& what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    uint32_t recordChecksum(uint64_t lsn, std::string_view payload) {
+        Poco::Checksum checksum(Poco::Checksum::TYPE_CRC32);
+        checksum.update(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+        checksum.update(payload.data(), static_cast<unsigned int>(payload.size()));
+        return checksum.checksum();
+    }
+
+    void syncDirectory(const std::string& directory) {
+        int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            fsync(fd);
+            close(fd);
+        }
+    }
+
+    // "wal-00000000000000ff.log" -> 255
+    bool parseSegmentName(const char* name, uint64_t& firstLsn) {
+        unsigned long long value = 0;
+        int consumed = 0;
+        if (std::sscanf(name, "wal-%16llx.log%n", &value, &consumed) != 1 ||
+            name[consumed] != '\0' || std::strlen(name) != 24) {
+            return false;
+        }
+        firstLsn = value;
+        return true;
+    }
+}
+
+WriteAheadLog::WriteAheadLog(const WalOptions& options)
+    : options_(options)
+    , pendingFirst_(0)
+    , pendingLast_(0)
+    , running_(false)
+    , fd_(-1)
+    , segmentSize_(0)
+    , rotate_(false)
+    , checkpointLsn_(0)
+    , durableLsn_(0)
+    , syncs_(0) {
+    if (mkdir(options_.directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        throwErrno("Cannot create WAL directory " + options_.directory);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    stop();
+}
+
+WriteAheadLog::Lsn WriteAheadLog::recover(const Replay& replay) {
+    std::vector<Segment> found;
+    DIR* dir = opendir(options_.directory.c_str());
+    if (!dir) {
+        throwErrno("Cannot open WAL directory " + options_.directory);
+    }
+    while (dirent* entry = readdir(dir)) {
+        uint64_t firstLsn;
+        if (parseSegmentName(entry->d_name, firstLsn)) {
+            found.push_back(Segment{options_.directory + "/" + entry->d_name, firstLsn, 0});
+        }
+    }
+    closedir(dir);
+    std::sort(found.begin(), found.end(),
+              [](const Segment& a, const Segment& b) { return a.firstLsn < b.firstLsn; });
+
+    Lsn last = 0;
+    bool torn = false;
+    std::vector<Segment> kept;
+    for (Segment& segment : found) {
+        if (torn) {
+            // Nothing after a gap can be applied in order
+            std::cerr << "⚠ Discarding WAL segment " << segment.path << " after a torn record" << std::endl;
+            unlink(segment.path.c_str());
+            continue;
+        }
+        int fd = open(segment.path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            throwErrno("Cannot open WAL segment " + segment.path);
+        }
+        struct stat info;
+        if (fstat(fd, &info) < 0) {
+            close(fd);
+            throwErrno("Cannot stat WAL segment " + segment.path);
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        size_t offset = 0;
+        segment.lastLsn = segment.firstLsn - 1;
+        if (size > 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throwErrno("Cannot map WAL segment " + segment.path);
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            const char* base = static_cast<const char*>(mapped);
+            while (size - offset >= RECORD_HEADER_SIZE) {
+                uint32_t length;
+                uint32_t checksum;
+                uint64_t lsn;
+                std::memcpy(&length, base + offset, sizeof(length));
+                std::memcpy(&checksum, base + offset + 4, sizeof(checksum));
+                std::memcpy(&lsn, base + offset + 8, sizeof(lsn));
+                if (length > size - offset - RECORD_HEADER_SIZE || lsn <= last) {
+                    break;
+                }
+                std::string_view payload(base + offset + RECORD_HEADER_SIZE, length);
+                if (recordChecksum(lsn, payload) != checksum) {
+                    break;
+                }
+                replay(lsn, payload);
+                last = lsn;
+                segment.lastLsn = lsn;
+                offset += RECORD_HEADER_SIZE + length;
+            }
+            munmap(mapped, size);
+        }
+        if (offset < size) {
+            // A crash mid-write leaves a partial record; everything before it was synced
+            std::cerr << "⚠ Truncating torn WAL tail in " << segment.path << " at byte " << offset << std::endl;
+            if (ftruncate(fd, static_cast<off_t>(offset)) == 0) {
+                fdatasync(fd);
+            }
+            torn = true;
+        }
+        close(fd);
+        if (offset == 0) {
+            unlink(segment.path.c_str());
+        } else {
+            kept.push_back(segment);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(segmentsMutex_);
+        segments_ = std::move(kept);
+    }
+    durableLsn_ = last;
+    return last;
+}
+
+void WriteAheadLog::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&WriteAheadLog::run, this);
+}
+
+void WriteAheadLog::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    // Nothing is written any more, so the newest segment can go as well
+    // once all of it was applied; a clean restart then replays nothing
+    removeApplied(true);
+}
+
+void WriteAheadLog::append(Lsn lsn, std::string_view payload) {
+    char header[RECORD_HEADER_SIZE];
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    uint32_t checksum = recordChecksum(lsn, payload);
+    std::memcpy(header, &length, sizeof(length));
+    std::memcpy(header + 4, &checksum, sizeof(checksum));
+    std::memcpy(header + 8, &lsn, sizeof(lsn));
+
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wasEmpty = pending_.empty();
+        if (wasEmpty) {
+            pendingFirst_ = lsn;
+        }
+        pendingLast_ = lsn;
+        pending_.append(header, sizeof(header));
+        pending_.append(payload.data(), payload.size());
+    }
+    if (wasEmpty) {
+        condition_.notify_one();
+    }
+}
+
+bool WriteAheadLog::waitDurable(Lsn lsn, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(durableMutex_);
+    return durableCondition_.wait_for(lock, timeout, [&] { return durableLsn_ >= lsn; });
+}
+
+void WriteAheadLog::run() {
+    std::string batch;
+    int backoffMs = 10;
+    while (true) {
+        Lsn first;
+        Lsn last;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return !pending_.empty() || !running_; });
+            if (pending_.empty()) {
+                break;
+            }
+            if (options_.commitDelay.count() > 0 && running_) {
+                lock.unlock();
+                std::this_thread::sleep_for(options_.commitDelay);
+                lock.lock();
+            }
+            batch.swap(pending_);
+            first = pendingFirst_;
+            last = pendingLast_;
+            stopping = !running_;
+        }
+
+        try {
+            writeBatch(batch, first, last);
+            batch.clear();
+            backoffMs = 10;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "❌ WAL write failed: " << e.what() << std::endl;
+            if (stopping) {
+                std::cerr << "❌ Dropping unsynced WAL records at shutdown" << std::endl;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+            backoffMs = std::min(backoffMs * 2, 1000);
+            // Re-queue: the next pass retries with anything appended meanwhile
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pending_.empty()) {
+                pendingLast_ = last;
+            }
+            pendingFirst_ = first;
+            pending_.insert(0, batch);
+            batch.clear();
+        }
+    }
+}
+
+void WriteAheadLog::writeBatch(const std::string& bytes, Lsn firstLsn, Lsn lastLsn) {
+    if (fd_ < 0 || segmentSize_ >= options_.segmentBytes || rotate_.exchange(false)) {
+        openSegment(firstLsn);
+    }
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = pwrite(fd_, bytes.data() + written, bytes.size() - written,
+                           static_cast<off_t>(segmentSize_ + written));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int error = errno;
+            // Drop the partial batch so a retry does not leave a torn record mid-segment
+            if (ftruncate(fd_, static_cast<off_t>(segmentSize_)) < 0) {
+                std::cerr << "❌ Cannot roll back partial WAL write" << std::endl;
+            }
+            errno = error;
+            throwErrno("WAL write");
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (fdatasync(fd_) < 0) {
+        int error = errno;
+        if (ftruncate(fd_, static_cast<off_t>(segmentSize_)) < 0) {
+            std::cerr << "❌ Cannot roll back unsynced WAL write" << std::endl;
+        }
+        errno = error;
+        throwErrno("WAL fdatasync");
+    }
+    segmentSize_ += bytes.size();
+    {
+        std::lock_guard<std::mutex> lock(segmentsMutex_);
+        segments_.back().lastLsn = lastLsn;
+    }
+    ++syncs_;
+    {
+        std::lock_guard<std::mutex> lock(durableMutex_);
+        durableLsn_ = lastLsn;
+    }
+    durableCondition_.notify_all();
+}
+
+void WriteAheadLog::openSegment(Lsn firstLsn) {
+    std::string path = segmentPath(firstLsn);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throwErrno("Cannot create WAL segment " + path);
+    }
+    // Make the new file's directory entry durable before records depend on it
+    syncDirectory(options_.directory);
+    if (fd_ >= 0) {
+        close(fd_);  // already synced
+    }
+    fd_ = fd;
+    segmentSize_ = 0;
+    std::lock_guard<std::mutex> lock(segmentsMutex_);
+    segments_.push_back(Segment{path, firstLsn, firstLsn - 1});
+}
+
+void WriteAheadLog::checkpoint(Lsn lsn) {
+    {
+        std::lock_guard<std::mutex> lock(segmentsMutex_);
+        checkpointLsn_ = std::max(checkpointLsn_, lsn);
+        // The newest segment may still be written to. Once all of it has
+        // been applied, the next write starts a fresh one so that this one
+        // is closed and goes at the next checkpoint.
+        if (!segments_.empty() && segments_.back().lastLsn >= segments_.back().firstLsn &&
+            segments_.back().lastLsn <= lsn) {
+            rotate_ = true;
+        }
+    }
+    removeApplied(false);
+}
+
+void WriteAheadLog::removeApplied(bool includingNewest) {
+    std::vector<std::string> obsolete;
+    {
+        std::lock_guard<std::mutex> lock(segmentsMutex_);
+        size_t candidates = segments_.size() - (includingNewest || segments_.empty() ? 0 : 1);
+        size_t removable = 0;
+        while (removable < candidates && segments_[removable].lastLsn <= checkpointLsn_) {
+            obsolete.push_back(segments_[removable].path);
+            ++removable;
+        }
+        segments_.erase(segments_.begin(), segments_.begin() + static_cast<std::ptrdiff_t>(removable));
+    }
+    for (const auto& path : obsolete) {
+        unlink(path.c_str());
+    }
+}
+
+size_t WriteAheadLog::segmentCount() const {
+    std::lock_guard<std::mutex> lock(segmentsMutex_);
+    return segments_.size();
+}
+
+std::string WriteAheadLog::segmentPath(Lsn firstLsn) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "wal-%016llx.log", static_cast<unsigned long long>(firstLsn));
+    return options_.directory + "/" + name;
+}
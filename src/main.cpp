@@ -1,210 +1,509 @@
-#include <Poco/Net/ServerSocket.h>
-#include <Poco/Net/SocketReactor.h>
-#include <Poco/Net/SocketAcceptor.h>
-#include <Poco/Net/StreamSocket.h>
-#include <Poco/Thread.h>
-#include <Poco/Util/ServerApplication.h>
-#include <csignal>
-#include <memory>
-#include "TaskQueue.h"
-#include "LoadBalancer.h"
-#include "DatabaseManager.h"
-#include "TaskDistributor.h"
-#include <Poco/StreamCopier.h>
-#include <Poco/JSON/Object.h>
-#include <Poco/JSON/Parser.h>
-
-namespace {
-    volatile sig_atomic_t shouldShutdown = false;
-}
-
-void signalHandler(int) {
-    shouldShutdown = true;
-}
-
-// Function declaration
-void printBanner() {
-    std::cout << "\n"
-              << "╔════════════════════════════════════════╗\n"
-              << "║        Distributed Task Queue          ║\n"
-              << "║            Server v1.0                 ║\n"
-              << "╚════════════════════════════════════════╝\n"
-              << std::endl;
-}
-
-class TaskServerHandler {
-public:
-    TaskServerHandler(const TaskServerHandler&) = delete;
-    TaskServerHandler& operator=(const TaskServerHandler&) = delete;
-
-    TaskServerHandler(Poco::Net::StreamSocket& socket, 
-                     Poco::Net::SocketReactor& reactor,
-                     std::shared_ptr<TaskQueue> taskQueue,
-                     std::shared_ptr<LoadBalancer> loadBalancer)
-        : socket_(socket)
-        , reactor_(reactor)
-        , taskQueue_(taskQueue)
-        , loadBalancer_(loadBalancer) {
-        reactor_.addEventHandler(socket_,
-            Poco::Observer<TaskServerHandler, Poco::Net::ReadableNotification>
-            (*this, &TaskServerHandler::onReadable));
-    }
-
-    ~TaskServerHandler() {
-        reactor_.removeEventHandler(socket_,
-            Poco::Observer<TaskServerHandler, Poco::Net::ReadableNotification>
-            (*this, &TaskServerHandler::onReadable));
-    }
-
-    void onReadable(Poco::Net::ReadableNotification* pNf) {
-        try {
-            char buffer[4096];
-            int n = socket_.receiveBytes(buffer, sizeof(buffer));
-            if (n > 0) {
-                std::string message(buffer, n);
-                handleMessage(message);
-            }
-        }
-        catch (Poco::Exception& exc) {
-            std::cerr << "Error handling connection: " << exc.displayText() << std::endl;
-        }
-        pNf->release();
-    }
-
-private:
-    void handleMessage(const std::string& message) {
-    try {
-        Poco::JSON::Parser parser;
-        Poco::Dynamic::Var result = parser.parse(message);
-        Poco::JSON::Object::Ptr object = result.extract<Poco::JSON::Object::Ptr>();
-
-        std::string type = object->getValue<std::string>("type");
-
-        if (type == "task_completed") {
-            std::string taskId = object->getValue<std::string>("task_id");
-            std::string workerId = object->getValue<std::string>("worker_id");
-            taskQueue_->markTaskCompleted(Poco::UUID(taskId), Poco::UUID(workerId));
-            loadBalancer_->updateWorkerStatus(Poco::UUID(workerId), true);
-        }
-        else if (type == "heartbeat") {
-            std::string workerId = object->getValue<std::string>("worker_id");
-            loadBalancer_->updateWorkerStatus(Poco::UUID(workerId), true);
-        }
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error parsing message: " << e.what() << std::endl;
-    }
-}
-
-    Poco::Net::StreamSocket socket_;
-    Poco::Net::SocketReactor& reactor_;
-    std::shared_ptr<TaskQueue> taskQueue_;
-    std::shared_ptr<LoadBalancer> loadBalancer_;
-};
-
-class CustomSocketAcceptor {
-public:
-    CustomSocketAcceptor(Poco::Net::ServerSocket& socket,
-                        Poco::Net::SocketReactor& reactor,
-                        std::shared_ptr<TaskQueue> taskQueue,
-                        std::shared_ptr<LoadBalancer> loadBalancer)
-        : socket_(socket)
-        , reactor_(reactor)
-        , taskQueue_(taskQueue)
-        , loadBalancer_(loadBalancer) {
-        reactor_.addEventHandler(socket_,
-            Poco::Observer<CustomSocketAcceptor,
-            Poco::Net::ReadableNotification>
-            (*this, &CustomSocketAcceptor::onAccept));
-    }
-
-    ~CustomSocketAcceptor() {
-        reactor_.removeEventHandler(socket_,
-            Poco::Observer<CustomSocketAcceptor,
-            Poco::Net::ReadableNotification>
-            (*this, &CustomSocketAcceptor::onAccept));
-    }
-
-    void onAccept(Poco::Net::ReadableNotification* pNf) {
-        try {
-            Poco::Net::StreamSocket sock = socket_.acceptConnection();
-            new TaskServerHandler(sock, reactor_, taskQueue_, loadBalancer_);
-        }
-        catch (Poco::Exception& exc) {
-            std::cerr << "Error accepting connection: " << exc.displayText() << std::endl;
-        }
-        pNf->release();
-    }
-
-private:
-    Poco::Net::ServerSocket& socket_;
-    Poco::Net::SocketReactor& reactor_;
-    std::shared_ptr<TaskQueue> taskQueue_;
-    std::shared_ptr<LoadBalancer> loadBalancer_;
-};
-
-class TaskServer {
-public:
-    TaskServer() : port_(8080) {
-        taskQueue_ = std::make_shared<TaskQueue>();
-        loadBalancer_ = std::make_shared<LoadBalancer>();
-        taskDistributor_ = std::make_shared<TaskDistributor>(taskQueue_, loadBalancer_);
-    }
-
-    void start() {
-        try {
-            Poco::Net::ServerSocket serverSocket(port_);
-            Poco::Net::SocketReactor reactor;
-
-            CustomSocketAcceptor acceptor(
-                serverSocket, reactor, taskQueue_, loadBalancer_);
-
-            taskDistributor_->start();
-            std::cout << "Server started on port " << port_ << std::endl;
-
-            Poco::Thread thread;
-            thread.start(reactor);
-
-            while (!shouldShutdown) {
-                Poco::Thread::sleep(100);
-            }
-
-            std::cout << "Shutting down server..." << std::endl;
-            taskDistributor_->stop();
-            reactor.stop();
-            thread.join();
-        }
-        catch (const Poco::Exception& exc) {
-            std::cerr << "Error starting server: " << exc.displayText() << std::endl;
-            throw;
-        }
-    }
-
-private:
-    int port_;
-    std::shared_ptr<TaskQueue> taskQueue_;
-    std::shared_ptr<LoadBalancer> loadBalancer_;
-    std::shared_ptr<TaskDistributor> taskDistributor_;
-};
-
-int main() {
-        printBanner();
-    try {
-        signal(SIGINT, signalHandler);
-        signal(SIGTERM, signalHandler);
-
-        DatabaseManager dbManager;
-        if (!dbManager.init()) {
-            std::cerr << "Failed to initialize database. Exiting..." << std::endl;
-            return 1;
-        }
-
-        TaskServer server;
-        server.start();
-        return 0;
-    }
-    catch (const std::exception& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
-    }
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketReactor.h>
+#include <Poco/Net/SocketAcceptor.h>
+#include <Poco/Net/StreamSocket.h>
+#include <Poco/Net/StreamSocketImpl.h>
+#include <Poco/Thread.h>
+#include <Poco/Util/ServerApplication.h>
+#include <csignal>
+#include <memory>
+#include "TaskQueue.h"
+#include "LoadBalancer.h"
+#include "DatabaseManager.h"
+#include "TaskDistributor.h"
+#include "LeaseManager.h"
+#include "WorkerSession.h"
+#include "Protocol.h"
+#include "MessageCodec.h"
+#include "ServerConfig.h"
+#include "BlockingExecutor.h"
+#include "IoLoop.h"
+#include "BufferPool.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <Poco/StreamCopier.h>
+
+namespace {
+    volatile sig_atomic_t shouldShutdown = false;
+}
+
+void signalHandler(int) {
+    shouldShutdown = true;
+}
+
+// Function declaration
+void printBanner() {
+    std::cout << "\n"
+              << "╔════════════════════════════════════════╗\n"
+              << "║        Distributed Task Queue          ║\n"
+              << "║            Server v1.0                 ║\n"
+              << "╚════════════════════════════════════════╝\n"
+              << std::endl;
+}
+
+// One client or worker connection, independent of how its bytes arrive:
+// ReactorConnection receives with the Poco reactor, LoopConnection through
+// an IoLoop (epoll or io_uring). Replies are written synchronously.
+class TaskServerHandler {
+public:
+    TaskServerHandler(const TaskServerHandler&) = delete;
+    TaskServerHandler& operator=(const TaskServerHandler&) = delete;
+
+    TaskServerHandler(const Poco::Net::StreamSocket& socket,
+                     std::shared_ptr<TaskQueue> taskQueue,
+                     std::shared_ptr<LoadBalancer> loadBalancer,
+                     std::shared_ptr<SessionRegistry> sessions,
+                     std::shared_ptr<LeaseManager> leases,
+                     BlockingExecutor& executor)
+        : socket_(socket)
+        , taskQueue_(taskQueue)
+        , loadBalancer_(loadBalancer)
+        , sessions_(sessions)
+        , leases_(leases)
+        , session_(std::make_shared<WorkerSession>(socket_))
+        , strand_(executor.makeStrand())
+        , registered_(false) {
+        socket_.setKeepAlive(true);
+        socket_.setNoDelay(true);
+    }
+
+    ~TaskServerHandler() {
+        session_->close();
+        // Only mark the worker unavailable if it has not already resumed on a newer session.
+        if (registered_ && sessions_->unbind(workerId_, session_)) {
+            loadBalancer_->updateWorkerStatus(workerId_, false);
+            std::cout << "Worker " << workerId_.toString() << " disconnected" << std::endl;
+        }
+    }
+
+    Poco::Net::StreamSocket& socket() { return socket_; }
+
+    // Receives straight into the decoder; false once the connection is done.
+    bool receive() {
+        try {
+            int n = socket_.receiveBytes(decoder_.prepare(READ_CHUNK_SIZE), static_cast<int>(READ_CHUNK_SIZE));
+            if (n <= 0) {
+                return false;
+            }
+            decoder_.commit(n);
+            return drain();
+        }
+        catch (Poco::Exception& exc) {
+            std::cerr << "Error handling connection: " << exc.displayText() << std::endl;
+            return false;
+        }
+    }
+
+    // Bytes already read by an IoLoop.
+    bool onData(const char* data, size_t size) {
+        std::memcpy(decoder_.prepare(size), data, size);
+        decoder_.commit(size);
+        return drain();
+    }
+
+private:
+    bool drain() {
+        try {
+            Frame frame;
+            while (decoder_.next(frame)) {
+                handleFrame(frame);
+            }
+            return true;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Protocol error: " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    void handleFrame(const Frame& frame) {
+    try {
+        switch (frame.type) {
+        case MessageType::Register: {
+            auto registration = decodeMessage<RegisterMessage>(frame);
+            workerId_ = registration.workerId;
+            registration_ = registration;
+            registered_ = true;
+
+            // Negotiate the payload encoding; the ack itself goes out as JSON,
+            // which every peer understands.
+            Encoding encoding = (registration.supportsBinary && PREFER_BINARY_ENCODING)
+                ? Encoding::Binary : Encoding::Json;
+            session_->sendMessage(MessageType::RegisterAck, RegisterAckMessage{encoding});
+            session_->setEncoding(encoding);
+
+            sessions_->bind(workerId_, session_);
+            addWorker();
+            std::cout << "Worker " << workerId_.toString() << " registered from "
+                      << socket_.peerAddress().toString() << " with "
+                      << registration.slots << " slot(s), prefetch "
+                      << registration.prefetch << std::endl;
+            break;
+        }
+        case MessageType::TaskCompleted: {
+            auto completion = decodeMessage<TaskCompletedMessage>(frame);
+            taskQueue_->markTaskCompleted(completion.taskId, completion.workerId);
+            // If the lease already lapsed, its credit was returned then
+            if (leases_->release(completion.taskId, completion.workerId)) {
+                loadBalancer_->releaseWorker(completion.workerId);
+            }
+
+            // Acknowledge so the worker can drop the completion from its resend outbox.
+            session_->sendMessage(MessageType::TaskCompletedAck, TaskCompletedAckMessage{completion.taskId});
+            break;
+        }
+        // Client requests may wait on the database (status reads, durable
+        // enqueue), so they are decoded here and run on the connection's
+        // strand in the blocking executor, never on the I/O loop.
+        case MessageType::SubmitTask: {
+            Task task = decodeTask(frame.payload, frameEncoding(frame), &arena_);
+            strand_->post([queue = taskQueue_, task] { queue->addTask(task); });
+            break;
+        }
+        case MessageType::SubmitBatch: {
+            auto batch = decodeMessage<SubmitBatchMessage>(frame);
+            strand_->post([queue = taskQueue_, session = session_, encoding = frameEncoding(frame), batch] {
+                queue->addTasks(batch.tasks);
+                reply(*session, encoding, MessageType::SubmitAck,
+                    SubmitAckMessage{batch.requestId, static_cast<uint32_t>(batch.tasks.size())});
+            });
+            break;
+        }
+        case MessageType::CheckStatus: {
+            auto query = decodeMessage<CheckStatusMessage>(frame);
+            strand_->post([queue = taskQueue_, session = session_, encoding = frameEncoding(frame), query] {
+                auto statuses = queue->getTaskStatuses({query.taskId});
+                reply(*session, encoding, MessageType::StatusReply,
+                    StatusReplyMessage{query.taskId, statuses.front() == taskStatusName(TaskStatus::Completed)});
+            });
+            break;
+        }
+        case MessageType::StatusQuery: {
+            auto query = decodeMessage<StatusQueryMessage>(frame);
+            strand_->post([queue = taskQueue_, session = session_, encoding = frameEncoding(frame), query] {
+                auto statuses = queue->getTaskStatuses(query.taskIds);
+                StatusBatchReplyMessage message{query.requestId, {}};
+                message.statuses.reserve(statuses.size());
+                for (size_t i = 0; i < statuses.size(); ++i) {
+                    message.statuses.push_back(TaskStatusEntry{query.taskIds[i], std::move(statuses[i])});
+                }
+                reply(*session, encoding, MessageType::StatusBatchReply, message);
+            });
+            break;
+        }
+        case MessageType::ExtendLease: {
+            auto extension = decodeMessage<ExtendLeaseMessage>(frame);
+            for (const auto& taskId : extension.taskIds) {
+                leases_->extend(taskId, extension.workerId);
+            }
+            break;
+        }
+        case MessageType::Heartbeat: {
+            auto heartbeat = decodeMessage<HeartbeatMessage>(frame);
+            if (!loadBalancer_->recordHeartbeat(heartbeat.workerId, heartbeat.load,
+                                                static_cast<int>(heartbeat.freeSlots)) &&
+                registered_ && heartbeat.workerId == workerId_) {
+                // Evicted as dead but still connected: take it back
+                std::cout << "Worker " << workerId_.toString() << " is back, re-registering" << std::endl;
+                addWorker();
+                loadBalancer_->recordHeartbeat(heartbeat.workerId, heartbeat.load,
+                                               static_cast<int>(heartbeat.freeSlots));
+            }
+            break;
+        }
+        default:
+            std::cerr << "Ignoring unexpected " << messageTypeName(frame.type) << " message" << std::endl;
+            break;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error parsing message: " << e.what() << std::endl;
+    }
+}
+
+    void addWorker() {
+        loadBalancer_->addWorker(Worker(workerId_, socket_.peerAddress(),
+                                        static_cast<int>(registration_.slots),
+                                        static_cast<int>(registration_.prefetch)));
+    }
+
+    // Clients never negotiate; answer in whatever encoding they wrote with.
+    template <class Message>
+    static void reply(WorkerSession& session, Encoding encoding, MessageType type, const Message& message) {
+        std::string& payload = encodeScratch();
+        encodeMessage(payload, message, encoding);
+        session.send(type, payload, frameFlags(encoding));
+    }
+
+    Poco::Net::StreamSocket socket_;
+    std::shared_ptr<TaskQueue> taskQueue_;
+    std::shared_ptr<LoadBalancer> loadBalancer_;
+    std::shared_ptr<SessionRegistry> sessions_;
+    std::shared_ptr<LeaseManager> leases_;
+    std::shared_ptr<WorkerSession> session_;
+    std::shared_ptr<BlockingExecutor::Strand> strand_;
+    FrameDecoder decoder_;
+    PayloadArena arena_;  // single submitted tasks; batches get their own
+    Poco::UUID workerId_;
+    RegisterMessage registration_;
+    bool registered_;
+
+    static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+    static constexpr bool PREFER_BINARY_ENCODING = true;
+};
+
+class ReactorConnection {
+public:
+    ReactorConnection(const Poco::Net::StreamSocket& socket,
+                      Poco::Net::SocketReactor& reactor,
+                      std::shared_ptr<TaskQueue> taskQueue,
+                      std::shared_ptr<LoadBalancer> loadBalancer,
+                      std::shared_ptr<SessionRegistry> sessions,
+                      std::shared_ptr<LeaseManager> leases,
+                      BlockingExecutor& executor)
+        : handler_(socket, taskQueue, loadBalancer, sessions, leases, executor)
+        , reactor_(reactor) {
+        reactor_.addEventHandler(handler_.socket(),
+            Poco::Observer<ReactorConnection, Poco::Net::ReadableNotification>
+            (*this, &ReactorConnection::onReadable));
+    }
+
+    ~ReactorConnection() {
+        reactor_.removeEventHandler(handler_.socket(),
+            Poco::Observer<ReactorConnection, Poco::Net::ReadableNotification>
+            (*this, &ReactorConnection::onReadable));
+    }
+
+    void onReadable(Poco::Net::ReadableNotification* pNf) {
+        pNf->release();
+        if (!handler_.receive()) {
+            delete this;
+        }
+    }
+
+private:
+    TaskServerHandler handler_;
+    Poco::Net::SocketReactor& reactor_;
+};
+
+class LoopConnection : public IoHandler {
+public:
+    LoopConnection(const Poco::Net::StreamSocket& socket,
+                   std::shared_ptr<TaskQueue> taskQueue,
+                   std::shared_ptr<LoadBalancer> loadBalancer,
+                   std::shared_ptr<SessionRegistry> sessions,
+                   std::shared_ptr<LeaseManager> leases,
+                   BlockingExecutor& executor)
+        : handler_(socket, taskQueue, loadBalancer, sessions, leases, executor) {}
+
+    bool onData(const char* data, size_t size) override { return handler_.onData(data, size); }
+    void onClose() override {}
+
+private:
+    TaskServerHandler handler_;
+};
+
+class CustomSocketAcceptor {
+public:
+    CustomSocketAcceptor(Poco::Net::ServerSocket& socket,
+                        Poco::Net::SocketReactor& reactor,
+                        std::shared_ptr<TaskQueue> taskQueue,
+                        std::shared_ptr<LoadBalancer> loadBalancer,
+                        std::shared_ptr<SessionRegistry> sessions,
+                        std::shared_ptr<LeaseManager> leases,
+                        BlockingExecutor& executor)
+        : socket_(socket)
+        , reactor_(reactor)
+        , taskQueue_(taskQueue)
+        , loadBalancer_(loadBalancer)
+        , sessions_(sessions)
+        , leases_(leases)
+        , executor_(executor) {
+        reactor_.addEventHandler(socket_,
+            Poco::Observer<CustomSocketAcceptor,
+            Poco::Net::ReadableNotification>
+            (*this, &CustomSocketAcceptor::onAccept));
+    }
+
+    ~CustomSocketAcceptor() {
+        reactor_.removeEventHandler(socket_,
+            Poco::Observer<CustomSocketAcceptor,
+            Poco::Net::ReadableNotification>
+            (*this, &CustomSocketAcceptor::onAccept));
+    }
+
+    void onAccept(Poco::Net::ReadableNotification* pNf) {
+        try {
+            Poco::Net::StreamSocket sock = socket_.acceptConnection();
+            new ReactorConnection(sock, reactor_, taskQueue_, loadBalancer_, sessions_, leases_, executor_);
+        }
+        catch (Poco::Exception& exc) {
+            std::cerr << "Error accepting connection: " << exc.displayText() << std::endl;
+        }
+        pNf->release();
+    }
+
+private:
+    Poco::Net::ServerSocket& socket_;
+    Poco::Net::SocketReactor& reactor_;
+    std::shared_ptr<TaskQueue> taskQueue_;
+    std::shared_ptr<LoadBalancer> loadBalancer_;
+    std::shared_ptr<SessionRegistry> sessions_;
+    std::shared_ptr<LeaseManager> leases_;
+    BlockingExecutor& executor_;
+};
+
+class TaskServer {
+public:
+    explicit TaskServer(const ServerConfig& config)
+        : port_(config.port)
+        , ioThreads_(config.effectiveIoThreads())
+        , transport_(config.transport)
+        , metricsIntervalSec_(config.metricsIntervalSec)
+        , executor_(config.dbThreads) {
+        QueueOptions queueOptions;
+        queueOptions.shards = config.effectiveShards();
+        PersistenceOptions persistence;
+        if (!config.walDirectory.empty()) {
+            // A local fsync is cheap enough to acknowledge every submit durably
+            persistence.walDirectory = config.walDirectory;
+            persistence.durableEnqueue = true;
+        }
+        ClusterOptions cluster;
+        cluster.enabled = config.cluster;
+        cluster.claimBatch = static_cast<size_t>(config.claimBatch);
+        cluster.ownership = std::chrono::milliseconds(config.claimOwnershipMs);
+        taskQueue_ = std::make_shared<TaskQueue>(persistence, queueOptions, cluster);
+        FailureDetectorOptions detectorOptions;
+        detectorOptions.suspectAfter = std::chrono::milliseconds(config.suspectAfterMs);
+        detectorOptions.deadAfter = std::chrono::milliseconds(config.deadAfterMs);
+        loadBalancer_ = std::make_shared<LoadBalancer>(config.selectionPolicy, config.maxPrefetch, detectorOptions);
+        sessions_ = std::make_shared<SessionRegistry>();
+        LeaseOptions leaseOptions;
+        leaseOptions.timeout = std::chrono::milliseconds(config.leaseTimeoutMs);
+        leaseOptions.maxRetries = config.maxRetries;
+        leases_ = std::make_shared<LeaseManager>(leaseOptions);
+        taskDistributor_ = std::make_shared<TaskDistributor>(taskQueue_, loadBalancer_, sessions_, leases_);
+    }
+
+    void start() {
+        try {
+            // One event loop per I/O thread, each with its own listening
+            // socket on the same port (SO_REUSEPORT): the kernel spreads
+            // incoming connections across them, and a connection stays on the
+            // loop that accepted it for its whole life.
+            std::vector<std::unique_ptr<Poco::Net::ServerSocket>> serverSockets;
+            for (size_t i = 0; i < ioThreads_; ++i) {
+                auto serverSocket = std::make_unique<Poco::Net::ServerSocket>();
+                serverSocket->bind(Poco::Net::SocketAddress(static_cast<unsigned short>(port_)), true, true);
+                serverSocket->listen();
+                serverSockets.push_back(std::move(serverSocket));
+            }
+
+            std::vector<std::unique_ptr<Poco::Net::SocketReactor>> reactors;
+            std::vector<std::unique_ptr<CustomSocketAcceptor>> acceptors;
+            std::vector<std::unique_ptr<IoLoop>> loops;
+            std::string transportName = "reactor";
+            for (auto& serverSocket : serverSockets) {
+                if (transport_ == ServerTransport::Reactor) {
+                    reactors.push_back(std::make_unique<Poco::Net::SocketReactor>());
+                    acceptors.push_back(std::make_unique<CustomSocketAcceptor>(
+                        *serverSocket, *reactors.back(), taskQueue_, loadBalancer_, sessions_, leases_, executor_));
+                } else {
+                    loops.push_back(IoLoop::create(transport_ == ServerTransport::IoUring
+                        ? IoBackend::IoUring : IoBackend::Epoll));
+                    loops.back()->listen(serverSocket->impl()->sockfd(), [this](int fd) {
+                        // The connection's StreamSocket takes ownership of fd
+                        Poco::Net::StreamSocket socket(new Poco::Net::StreamSocketImpl(fd));
+                        return std::make_unique<LoopConnection>(socket, taskQueue_, loadBalancer_, sessions_, leases_,
+                                                                executor_);
+                    });
+                    transportName = ioBackendName(loops.back()->backend());
+                }
+            }
+
+            taskDistributor_->start();
+            std::cout << "Server started on port " << port_ << " with "
+                      << ioThreads_ << " " << transportName << " I/O loop(s) and "
+                      << taskQueue_->shardCount() << " queue shard(s)" << std::endl;
+
+            std::vector<std::thread> threads;
+            for (auto& reactor : reactors) {
+                threads.emplace_back([&reactor] { reactor->run(); });
+            }
+            for (auto& loop : loops) {
+                threads.emplace_back([&loop] { loop->run(); });
+            }
+
+            auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(metricsIntervalSec_);
+            while (!shouldShutdown) {
+                Poco::Thread::sleep(100);
+                if (metricsIntervalSec_ > 0 && std::chrono::steady_clock::now() >= nextReport) {
+                    std::cout << taskQueue_->dbMetrics().report() << std::flush;
+                    LockStatsSnapshot locks = taskQueue_->lockStats();
+                    std::cout << "Ready queue locks: " << locks.acquisitions << " acquisitions, hold avg "
+                              << locks.averageHoldNs() / 1000.0 << " us max " << locks.maxHoldNs / 1000.0
+                              << " us, wait avg " << locks.averageWaitNs() / 1000.0 << " us" << std::endl;
+                    if (const TaskClaimer* claimer = taskQueue_->claimer()) {
+                        std::cout << "Cluster node " << claimer->nodeId().toString() << " claimed "
+                                  << claimer->claimed() << " tasks" << std::endl;
+                    }
+                    nextReport += std::chrono::seconds(metricsIntervalSec_);
+                }
+            }
+
+            std::cout << "Shutting down server..." << std::endl;
+            taskDistributor_->stop();
+            for (auto& reactor : reactors) {
+                reactor->stop();
+            }
+            for (auto& loop : loops) {
+                loop->stop();
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            executor_.stop();
+        }
+        catch (const Poco::Exception& exc) {
+            std::cerr << "Error starting server: " << exc.displayText() << std::endl;
+            throw;
+        }
+    }
+
+private:
+    int port_;
+    size_t ioThreads_;
+    ServerTransport transport_;
+    int metricsIntervalSec_;
+    BlockingExecutor executor_;
+    std::shared_ptr<TaskQueue> taskQueue_;
+    std::shared_ptr<LoadBalancer> loadBalancer_;
+    std::shared_ptr<SessionRegistry> sessions_;
+    std::shared_ptr<LeaseManager> leases_;
+    std::shared_ptr<TaskDistributor> taskDistributor_;
+};
+
+int main(int argc, char* argv[]) {
+        printBanner();
+    try {
+        ServerConfig config = ServerConfig::fromArgs(argc, argv);
+        signal(SIGINT, signalHandler);
+        signal(SIGTERM, signalHandler);
+
+        DatabaseManager dbManager;
+        if (!dbManager.init()) {
+            std::cerr << "Failed to initialize database. Exiting..." << std::endl;
+            return 1;
+        }
+
+        TaskServer server(config);
+        server.start();
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,172 @@
+#!/usr/bin/env bash
+# Runs several TaskQueueServers in cluster mode against a throwaway local
+# PostgreSQL and checks that they share one backlog: every task ends up in
+# tasks_archive, each server claims part of it, and the claims of a server
+# killed midway are taken over by the others. Server 0 runs with a WAL; it
+# is restarted once the others have finished its work, and its replay must
+# neither bring completed tasks back nor touch rows it no longer owns.
+#
+#   tests/cluster_harness.sh [build-dir] [servers] [tasks] [workers-per-server]
+#
+# Needs initdb, pg_ctl and psql on PATH (or PG_BIN set to their directory).
+# PostgreSQL 13+ is assumed for gen_random_uuid().
+set -euo pipefail
+
+BUILD_DIR=${1:-build}
+SERVERS=${2:-3}
+TASKS=${3:-600}
+WORKERS=${4:-2}
+BASE_PORT=${BASE_PORT:-18080}
+PG_PORT=${PG_PORT:-55432}
+SLOTS=16             # concurrent tasks per worker; each takes 2 s
+CLAIM_BATCH=16       # small, so no single server takes the whole backlog
+OWNERSHIP_MS=3000    # how long a killed server's claims stay put
+TIMEOUT_SEC=${TIMEOUT_SEC:-300}
+
+if [[ -n "${PG_BIN:-}" ]]; then
+    PATH="$PG_BIN:$PATH"
+fi
+for tool in initdb pg_ctl psql; do
+    command -v "$tool" >/dev/null || { echo "cluster_harness: $tool not found (set PG_BIN)" >&2; exit 2; }
+done
+for binary in TaskQueueServer WorkerNode; do
+    [[ -x "$BUILD_DIR/$binary" ]] || { echo "cluster_harness: $BUILD_DIR/$binary not built" >&2; exit 2; }
+done
+(( SERVERS >= 2 )) || { echo "cluster_harness: needs at least 2 servers" >&2; exit 2; }
+
+WORK=$(mktemp -d)
+PIDS=()
+cleanup() {
+    for pid in "${PIDS[@]}"; do
+        kill "$pid" 2>/dev/null || true
+    done
+    wait 2>/dev/null || true
+    pg_ctl -D "$WORK/pgdata" -m immediate stop >/dev/null 2>&1 || true
+    if [[ -z "${KEEP:-}" ]]; then
+        rm -rf "$WORK"
+    else
+        echo "Logs kept in $WORK"
+    fi
+}
+trap cleanup EXIT
+
+sql() {
+    psql -h "$WORK" -p "$PG_PORT" -U taskqueue -d taskqueue -qAt -v ON_ERROR_STOP=1 -c "$1"
+}
+
+wait_for() {  # wait_for <seconds> <description> <command...>
+    local seconds=$1 what=$2 i
+    shift 2
+    for (( i = 0; i < seconds * 10; ++i )); do
+        if "$@"; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "cluster_harness: timed out waiting for $what" >&2
+    exit 1
+}
+
+echo "=== Starting PostgreSQL on port $PG_PORT ==="
+initdb -D "$WORK/pgdata" -U taskqueue -A trust >"$WORK/initdb.log"
+pg_ctl -D "$WORK/pgdata" -l "$WORK/postgres.log" -w \
+    -o "-p $PG_PORT -k $WORK -c listen_addresses=''" start >/dev/null
+psql -h "$WORK" -p "$PG_PORT" -U taskqueue -d postgres -qc "CREATE DATABASE taskqueue"
+export TASKQUEUE_DB="host=$WORK port=$PG_PORT dbname=taskqueue user=taskqueue"
+
+start_server() {  # start_server <index> [extra options...]
+    local index=$1 port=$((BASE_PORT + $1))
+    shift
+    "$BUILD_DIR/TaskQueueServer" --port "$port" --io-threads 1 --shards 1 --cluster \
+        --claim-batch "$CLAIM_BATCH" --claim-ownership "$OWNERSHIP_MS" --metrics-interval 1 "$@" \
+        >>"$WORK/server$index.log" 2>&1 &
+    PIDS+=($!)
+    SERVER_PIDS[$index]=$!
+    wait_for 30 "server $index" grep -q "Server started on port $port" "$WORK/server$index.log"
+}
+
+echo "=== Starting $SERVERS servers ==="
+declare -a SERVER_PIDS
+# The first server migrates the schema; the rest find it up to date
+start_server 0 --wal-dir "$WORK/wal0"
+for (( s = 1; s < SERVERS; ++s )); do
+    start_server "$s"
+done
+
+echo "=== Submitting $TASKS tasks ==="
+sql "INSERT INTO tasks (id, name, data, status, priority)
+     SELECT gen_random_uuid(), 'ClusterHarness', 'payload ' || g, 'PENDING', g % 10
+     FROM generate_series(1, $TASKS) g"
+
+echo "=== Starting $WORKERS workers per server ==="
+for (( s = 0; s < SERVERS; ++s )); do
+    for (( w = 0; w < WORKERS; ++w )); do
+        "$BUILD_DIR/WorkerNode" 127.0.0.1 $((BASE_PORT + s)) "$SLOTS" >"$WORK/worker$s-$w.log" 2>&1 &
+        PIDS+=($!)
+    done
+done
+
+archived() {
+    sql "SELECT count(*) FROM tasks_archive WHERE name = 'ClusterHarness'"
+}
+half_archived() {
+    (( $(archived) >= TASKS / 2 ))
+}
+all_archived() {
+    (( $(archived) >= TASKS ))
+}
+
+wait_for "$TIMEOUT_SEC" "half of the tasks" half_archived
+echo "=== Killing server 0 with $(archived) of $TASKS tasks done ==="
+kill -9 "${SERVER_PIDS[0]}"
+
+wait_for "$TIMEOUT_SEC" "all tasks" all_archived
+
+echo "=== Restarting server 0 on its WAL ==="
+mv "$WORK/server0.log" "$WORK/server0.log.before"
+start_server 0 --wal-dir "$WORK/wal0"
+grep -h "Replayed\|Released" "$WORK/server0.log" | sed 's/^/  /' || true
+# The replay ran before the server started listening, so anything it put
+# back is visible now, before a worker could complete it again
+reinstated=$(sql "SELECT count(*) FROM tasks WHERE name = 'ClusterHarness'")
+sleep $(( OWNERSHIP_MS / 1000 + 2 ))
+
+echo "=== Stopping the servers ==="
+for (( s = 0; s < SERVERS; ++s )); do
+    kill -INT "${SERVER_PIDS[$s]}"
+done
+sleep 2
+
+echo "=== Results ==="
+for (( s = 0; s < SERVERS; ++s )); do
+    log="$WORK/server$s.log"
+    (( s > 0 )) || log="$WORK/server0.log.before"
+    claimed=$(grep -o "claimed [0-9]* tasks" "$log" | tail -1 || true)
+    echo "server $s: ${claimed:-claimed nothing}"
+done
+echo "tasks completed per worker:"
+sql "SELECT assigned_worker, count(*) FROM tasks_archive WHERE name = 'ClusterHarness'
+     GROUP BY assigned_worker ORDER BY 2 DESC" | sed 's/^/  /'
+
+failed=0
+if (( reinstated != 0 )); then
+    echo "FAIL: restarting server 0 on its WAL put $reinstated tasks back"
+    failed=1
+fi
+left=$(sql "SELECT count(*) FROM tasks WHERE name = 'ClusterHarness'")
+done_count=$(archived)
+if (( done_count != TASKS || left != 0 )); then
+    echo "FAIL: $done_count archived, $left left in tasks (expected $TASKS and 0)"
+    failed=1
+fi
+for (( s = 1; s < SERVERS; ++s )); do
+    if ! grep -q "claimed [1-9][0-9]* tasks" "$WORK/server$s.log"; then
+        echo "FAIL: server $s claimed nothing"
+        failed=1
+    fi
+done
+if (( failed )); then
+    KEEP=1
+    exit 1
+fi
+echo "PASS: $TASKS tasks completed across $SERVERS servers"
@@ -1,37 +1,765 @@
-#include <gtest/gtest.h>
-#include "TaskQueue.h"
-#include "LoadBalancer.h"
-#include "Task.h"
-
-class TaskQueueTest : public ::testing::Test {
-protected:
-    TaskQueue taskQueue;
-    LoadBalancer loadBalancer;
-};
-
-TEST_F(TaskQueueTest, AddTask) {
-    Task task("test_task", "test_data");
-    taskQueue.addTask(task);
-    EXPECT_TRUE(taskQueue.hasTask());
-}
-
-TEST_F(TaskQueueTest, GetNextTask) {
-    Task task("test_task", "test_data");
-    taskQueue.addTask(task);
-    Task nextTask = taskQueue.getNextTask();
-    EXPECT_EQ(nextTask.getName(), "test_task");
-    EXPECT_EQ(nextTask.getData(), "test_data");
-}
-
-TEST_F(TaskQueueTest, LoadBalancer) {
-    Worker worker("localhost", 8081);
-    loadBalancer.addWorker(worker);
-    Worker* nextWorker = loadBalancer.getNextAvailableWorker();
-    ASSERT_NE(nextWorker, nullptr);
-    EXPECT_EQ(nextWorker->getAddress().port(), 8081);
-}
-
-int main(int argc, char **argv) {
-    testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
-}
\ No newline at end of file
+#include <gtest/gtest.h>
+#include "TaskQueue.h"
+#include "LoadBalancer.h"
+#include "Task.h"
+#include "TaskScheduler.h"
+#include "Protocol.h"
+#include "MessageCodec.h"
+#include "LockStats.h"
+#include "DbMetrics.h"
+#include "MpmcRing.h"
+#include "ReadyQueue.h"
+#include "ServerConfig.h"
+#include "WorkerSelector.h"
+#include "BlockingExecutor.h"
+#include "IoLoop.h"
+#include "BufferPool.h"
+#include "TimingWheel.h"
+#include "LeaseManager.h"
+#include "FailureDetector.h"
+#include "WriteAheadLog.h"
+#include "PersistenceWriter.h"
+#include "TaskClaimer.h"
+#include <Poco/UUIDGenerator.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class TaskQueueTest : public ::testing::Test {
+protected:
+    TaskQueue taskQueue;
+    LoadBalancer loadBalancer;
+};
+
+TEST_F(TaskQueueTest, AddTask) {
+    Task task("test_task", "test_data");
+    taskQueue.addTask(task);
+    EXPECT_TRUE(taskQueue.hasTask());
+}
+
+TEST_F(TaskQueueTest, GetNextTask) {
+    Task task("test_task", "test_data");
+    taskQueue.addTask(task);
+    Task nextTask = taskQueue.getNextTask();
+    EXPECT_EQ(nextTask.getName(), "test_task");
+    EXPECT_EQ(nextTask.getData(), "test_data");
+}
+
+TEST_F(TaskQueueTest, LoadBalancer) {
+    Worker worker("localhost", 8081);
+    loadBalancer.addWorker(worker);
+    std::optional<Poco::UUID> next = loadBalancer.acquireAvailableWorker();
+    ASSERT_TRUE(next);
+    EXPECT_EQ(*next, worker.getId());
+    loadBalancer.releaseWorker(*next);
+}
+
+TEST(LoadBalancerTest, CreditsBoundTasksInFlight) {
+    LoadBalancer balancer;
+    Poco::UUID id = Poco::UUIDGenerator::defaultGenerator().createRandom();
+    balancer.addWorker(Worker(id, Poco::Net::SocketAddress("localhost", 8081), 1, 3));
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(balancer.acquireAvailableWorker(), id);
+    }
+    EXPECT_FALSE(balancer.acquireAvailableWorker());
+
+    balancer.releaseWorker(id);
+    EXPECT_EQ(balancer.acquireAvailableWorker(), id);
+}
+
+TEST(TaskSchedulerTest, HigherPriorityFirstFifoWithinLevel) {
+    TaskScheduler scheduler;
+    Task low("low", "a");
+    low.setPriority(1);
+    Task high1("high1", "b");
+    high1.setPriority(5);
+    Task high2("high2", "c");
+    high2.setPriority(5);
+
+    scheduler.push(low);
+    scheduler.push(high1);
+    scheduler.push(high2);
+
+    EXPECT_EQ(scheduler.size(), 3u);
+    EXPECT_EQ(scheduler.pop().getName(), "high1");
+    EXPECT_EQ(scheduler.pop().getName(), "high2");
+    EXPECT_EQ(scheduler.pop().getName(), "low");
+    EXPECT_TRUE(scheduler.empty());
+}
+
+TEST(TaskSchedulerTest, AgingPromotesWaitingTasks) {
+    TaskScheduler scheduler(std::chrono::milliseconds(10));
+    Task low("low", "a");
+    low.setPriority(1);
+    scheduler.push(low);
+
+    // After ~50ms the low task has gained ~5 levels and outranks a fresh
+    // priority-3 task.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Task mid("mid", "b");
+    mid.setPriority(3);
+    scheduler.push(mid);
+
+    EXPECT_EQ(scheduler.pop().getName(), "low");
+    EXPECT_EQ(scheduler.pop().getName(), "mid");
+}
+
+TEST(TaskTest, NamesAreInternedAndStatusDrivesCompletion) {
+    Task first("DataProcessing", "a");
+    Task second("DataProcessing", "b");
+    EXPECT_EQ(&first.getName(), &second.getName());
+    EXPECT_NE(&first.getName(), &Task("ImageResizing", "c").getName());
+    EXPECT_LE(sizeof(Task), 56u);
+
+    EXPECT_FALSE(first.isCompleted());
+    first.setStatus(TaskStatus::Completed);
+    EXPECT_TRUE(first.isCompleted());
+    first.setCompleted(false);
+    EXPECT_EQ(first.getStatus(), TaskStatus::Pending);
+}
+
+TEST(TaskTest, StatusNamesRoundTrip) {
+    for (TaskStatus status : {TaskStatus::Pending, TaskStatus::InProgress, TaskStatus::Completed,
+                              TaskStatus::DeadLetter}) {
+        EXPECT_EQ(parseTaskStatus(taskStatusName(status)), status);
+    }
+    EXPECT_STREQ(taskStatusName(TaskStatus::InProgress), "IN_PROGRESS");
+    EXPECT_THROW(parseTaskStatus("BOGUS"), std::invalid_argument);
+}
+
+TEST(TaskTest, NamesPastTheInternCapAreOwnedByTheTask) {
+    const std::string* shared = TaskNames::intern("DataProcessing");
+    for (size_t i = 0; TaskNames::size() < TaskNames::MAX_NAMES; ++i) {
+        TaskNames::intern("filler-" + std::to_string(i));
+    }
+    EXPECT_EQ(TaskNames::intern("past-the-cap"), nullptr);
+    EXPECT_EQ(TaskNames::intern("DataProcessing"), shared);
+
+    Task task("past-the-cap", "a");
+    EXPECT_EQ(task.getName(), "past-the-cap");
+    EXPECT_EQ(TaskNames::size(), TaskNames::MAX_NAMES);
+
+    Task copy = task;
+    std::vector<Task> moved;
+    moved.push_back(std::move(task));
+    EXPECT_EQ(copy.getName(), "past-the-cap");
+    EXPECT_EQ(moved[0].getName(), "past-the-cap");
+    EXPECT_EQ(&copy.getName(), &moved[0].getName());
+
+    Task other("past-the-cap", "b");
+    EXPECT_NE(&other.getName(), &copy.getName());
+    copy = other;
+    moved[0] = Task("DataProcessing", "c");
+    EXPECT_EQ(copy.getName(), "past-the-cap");
+    EXPECT_EQ(&moved[0].getName(), shared);
+}
+
+TEST(FrameDecoderTest, HandlesPartialAndCoalescedFrames) {
+    std::string stream = encodeFrame(MessageType::Heartbeat, "first");
+    stream += encodeFrame(MessageType::NewTask, std::string(10000, 'x'));
+    stream += encodeFrame(MessageType::TaskCompleted, "");
+
+    // Feed the byte stream in awkward 7-byte reads
+    FrameDecoder decoder;
+    std::vector<std::pair<MessageType, std::string>> frames;
+    for (size_t offset = 0; offset < stream.size(); offset += 7) {
+        size_t n = std::min<size_t>(7, stream.size() - offset);
+        std::memcpy(decoder.prepare(n), stream.data() + offset, n);
+        decoder.commit(n);
+        Frame frame;
+        while (decoder.next(frame)) {
+            frames.emplace_back(frame.type, std::string(frame.payload));
+        }
+    }
+
+    ASSERT_EQ(frames.size(), 3u);
+    EXPECT_EQ(frames[0].first, MessageType::Heartbeat);
+    EXPECT_EQ(frames[0].second, "first");
+    EXPECT_EQ(frames[1].first, MessageType::NewTask);
+    EXPECT_EQ(frames[1].second.size(), 10000u);
+    EXPECT_EQ(frames[2].first, MessageType::TaskCompleted);
+    EXPECT_TRUE(frames[2].second.empty());
+    EXPECT_EQ(decoder.buffered(), 0u);
+}
+
+TEST(FrameDecoderTest, RejectsOversizedFrames) {
+    std::string frame = encodeFrame(MessageType::SubmitTask, std::string(100, 'x'));
+    FrameDecoder decoder(64);
+    std::memcpy(decoder.prepare(frame.size()), frame.data(), frame.size());
+    decoder.commit(frame.size());
+    Frame out;
+    EXPECT_THROW(decoder.next(out), std::runtime_error);
+}
+
+TEST(MessageCodecTest, BinaryTaskRoundTrip) {
+    Task task("ImageResizing", std::string("bytes\0with\nnulls", 16));
+    task.setPriority(-3);
+
+    std::string payload;
+    encodeTask(payload, task, Encoding::Binary);
+    Task decoded = decodeTask(payload, Encoding::Binary);
+
+    EXPECT_EQ(decoded.getId(), task.getId());
+    EXPECT_EQ(decoded.getName(), task.getName());
+    EXPECT_EQ(decoded.getData(), task.getData());
+    EXPECT_EQ(decoded.getPriority(), -3);
+}
+
+TEST(MessageCodecTest, TaskPartsShareTheTaskBuffer) {
+    Task task("big", std::string(1 << 20, 'x'));
+    Task copy = task;
+    EXPECT_EQ(copy.getData().data(), task.getData().data());
+
+    std::string whole;
+    encodeTask(whole, task, Encoding::Binary);
+    std::string head;
+    std::string_view tail = encodeTaskParts(head, task, Encoding::Binary);
+    EXPECT_EQ(tail.data(), task.getData().data());
+    EXPECT_EQ(head + std::string(tail), whole);
+    EXPECT_EQ(decodeTask(whole, Encoding::Binary).getData(), task.getData());
+}
+
+TEST(MessageCodecTest, BinaryRejectsTruncatedPayload) {
+    std::string payload;
+    encodeMessage(payload, TaskCompletedMessage{Poco::UUIDGenerator::defaultGenerator().createOne(),
+                                                Poco::UUIDGenerator::defaultGenerator().createOne()},
+                  Encoding::Binary);
+    payload.resize(payload.size() - 1);
+    TaskCompletedMessage message{};
+    EXPECT_THROW(decodeMessage(payload, Encoding::Binary, message), std::runtime_error);
+}
+
+TEST(MessageCodecTest, SlotsSurviveBothEncodings) {
+    Poco::UUID workerId = Poco::UUIDGenerator::defaultGenerator().createRandom();
+    for (Encoding encoding : {Encoding::Json, Encoding::Binary}) {
+        std::string payload;
+        encodeMessage(payload, RegisterMessage{workerId, true, 32}, encoding);
+        RegisterMessage registration{};
+        decodeMessage(payload, encoding, registration);
+        EXPECT_EQ(registration.workerId, workerId);
+        EXPECT_EQ(registration.slots, 32u);
+
+        payload.clear();
+        encodeMessage(payload, HeartbeatMessage{workerId, 0.25f, 7}, encoding);
+        HeartbeatMessage heartbeat{};
+        decodeMessage(payload, encoding, heartbeat);
+        EXPECT_FLOAT_EQ(heartbeat.load, 0.25f);
+        EXPECT_EQ(heartbeat.freeSlots, 7u);
+    }
+}
+
+TEST(MessageCodecTest, BinarySubmitBatchRoundTrip) {
+    SubmitBatchMessage batch{42, {Task("a", "1"), Task("b", std::string(300, 'x'))}};
+    batch.tasks[1].setPriority(-3);
+    std::string payload;
+    encodeMessage(payload, batch, Encoding::Binary);
+
+    SubmitBatchMessage decoded{};
+    decodeMessage(payload, Encoding::Binary, decoded);
+    EXPECT_EQ(decoded.requestId, 42u);
+    ASSERT_EQ(decoded.tasks.size(), 2u);
+    EXPECT_EQ(decoded.tasks[0].getId(), batch.tasks[0].getId());
+    EXPECT_EQ(decoded.tasks[1].getData(), batch.tasks[1].getData());
+    EXPECT_EQ(decoded.tasks[1].getPriority(), -3);
+
+    // A count larger than the payload could hold is rejected before allocating
+    std::string hostile;
+    hostile.push_back(1);
+    hostile.append("\xff\xff\xff\xff\x0f", 5);
+    EXPECT_THROW(decodeMessage(hostile, Encoding::Binary, decoded), std::runtime_error);
+}
+
+TEST(BufferPoolTest, ArenaSlicesShareABlockThatReturnsToThePool) {
+    BufferPool pool(1024, 4);
+    {
+        PayloadArena arena(pool);
+        Task first(Poco::UUID::null(), "a", arena.copy("hello"), 5);
+        Task second(Poco::UUID::null(), "b", arena.copy("world"), 5);
+        EXPECT_EQ(first.getData(), "hello");
+        EXPECT_EQ(second.getData(), "world");
+        EXPECT_EQ(second.getData().data(), first.getData().data() + 5);
+        EXPECT_EQ(pool.cached(), 0u);
+    }
+    EXPECT_EQ(pool.cached(), 1u);
+}
+
+TEST(TimingWheelTest, FiresEachItemOnItsTickAcrossLevels) {
+    using Clock = TimingWheel<int>::Clock;
+    Clock::time_point start = Clock::now();
+    TimingWheel<int> wheel(std::chrono::milliseconds(10), start);
+    // Level 0, level 1 and level 2 deadlines (in ticks: 5, 100, 5000)
+    wheel.schedule(start + std::chrono::milliseconds(50), 1);
+    wheel.schedule(start + std::chrono::milliseconds(1000), 2);
+    wheel.schedule(start + std::chrono::milliseconds(50000), 3);
+
+    std::vector<int> expired;
+    wheel.advance(start + std::chrono::milliseconds(49), expired);
+    EXPECT_TRUE(expired.empty());
+    wheel.advance(start + std::chrono::milliseconds(50), expired);
+    EXPECT_EQ(expired, std::vector<int>{1});
+    wheel.advance(start + std::chrono::milliseconds(999), expired);
+    EXPECT_EQ(expired.size(), 1u);
+    wheel.advance(start + std::chrono::milliseconds(1000), expired);
+    EXPECT_EQ(expired, (std::vector<int>{1, 2}));
+    wheel.advance(start + std::chrono::milliseconds(49990), expired);
+    EXPECT_EQ(expired.size(), 2u);
+    wheel.advance(start + std::chrono::milliseconds(50000), expired);
+    EXPECT_EQ(expired, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(LeaseManagerTest, LapsedLeasesExpireUnlessExtendedOrReleased) {
+    LeaseOptions options;
+    options.timeout = std::chrono::milliseconds(1000);
+    options.tick = std::chrono::milliseconds(10);
+    LeaseManager leases(options);
+    std::vector<Poco::UUID> expired;
+    leases.setExpiryListener([&](Lease lease) { expired.push_back(lease.task.getId()); });
+
+    Poco::UUID worker = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Poco::UUID other = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Task lapses("DataProcessing", "a");
+    Task extended("DataProcessing", "b");
+    Task completed("DataProcessing", "c");
+    leases.grant(lapses, worker);
+    leases.grant(extended, worker);
+    leases.grant(completed, worker);
+
+    auto now = LeaseManager::Clock::now();
+    EXPECT_FALSE(leases.release(completed.getId(), other));
+    EXPECT_TRUE(leases.release(completed.getId(), worker));
+    EXPECT_EQ(leases.expire(now + std::chrono::milliseconds(500)), 0u);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(leases.extend(extended.getId(), worker));
+    EXPECT_EQ(leases.expire(now + std::chrono::milliseconds(1015)), 1u);
+    EXPECT_EQ(expired, std::vector<Poco::UUID>{lapses.getId()});
+    EXPECT_FALSE(leases.release(lapses.getId(), worker));
+
+    EXPECT_EQ(leases.expire(now + std::chrono::milliseconds(2100)), 1u);
+    EXPECT_EQ(expired.back(), extended.getId());
+    EXPECT_EQ(leases.size(), 0u);
+}
+
+TEST(LeaseManagerTest, RevokeEndsEveryLeaseOfAWorker) {
+    LeaseManager leases;
+    size_t ended = 0;
+    leases.setExpiryListener([&](Lease) { ++ended; });
+
+    Poco::UUID dead = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Poco::UUID alive = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Task first("DataProcessing", "a");
+    Task second("DataProcessing", "b");
+    Task kept("DataProcessing", "c");
+    leases.grant(first, dead);
+    leases.grant(second, dead);
+    leases.grant(kept, alive);
+
+    EXPECT_EQ(leases.revoke(dead), 2u);
+    EXPECT_EQ(ended, 2u);
+    EXPECT_EQ(leases.revoke(dead), 0u);
+    EXPECT_TRUE(leases.release(kept.getId(), alive));
+}
+
+TEST(FailureDetectorTest, SilentWorkersTurnSuspectThenDead) {
+    FailureDetectorOptions options;
+    options.suspectAfter = std::chrono::milliseconds(100);
+    options.deadAfter = std::chrono::milliseconds(300);
+    options.tick = std::chrono::milliseconds(10);
+    FailureDetector detector(options);
+    std::vector<Poco::UUID> changed;
+    detector.setListener([&](const Poco::UUID& id) { changed.push_back(id); });
+
+    Poco::UUID silent = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Poco::UUID beating = Poco::UUIDGenerator::defaultGenerator().createOne();
+    auto start = FailureDetector::Clock::now();
+    detector.track(silent);
+    detector.track(beating);
+
+    EXPECT_EQ(detector.expire(start + std::chrono::milliseconds(50)), 0u);
+    EXPECT_EQ(detector.expire(start + std::chrono::milliseconds(120)), 2u);
+    EXPECT_EQ(detector.health(silent), WorkerHealth::Suspect);
+
+    // A heartbeat revives a suspect at once
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(detector.heartbeat(beating));
+    EXPECT_EQ(detector.health(beating), WorkerHealth::Alive);
+
+    changed.clear();
+    EXPECT_EQ(detector.expire(start + std::chrono::milliseconds(320)), 2u);
+    EXPECT_EQ(detector.health(silent), WorkerHealth::Dead);
+    EXPECT_EQ(detector.health(beating), WorkerHealth::Suspect);
+    EXPECT_FALSE(detector.heartbeat(silent));
+    EXPECT_EQ(changed.size(), 2u);
+}
+
+TEST(PersistenceWriterTest, CoalescingKeepsTheRequeueRetryCount) {
+    Poco::UUID task = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Poco::UUID other = Poco::UUIDGenerator::defaultGenerator().createOne();
+    Poco::UUID worker = Poco::UUIDGenerator::defaultGenerator().createOne();
+    std::vector<TaskUpdate> updates = {
+        {task, TaskStatus::InProgress, worker, -1},
+        {other, TaskStatus::InProgress, worker, -1},
+        {task, TaskStatus::Pending, worker, 1},      // lease lapsed: requeued
+        {task, TaskStatus::InProgress, worker, -1},  // redelivered
+    };
+
+    std::vector<TaskUpdate> coalesced = coalesceUpdates(updates);
+    ASSERT_EQ(coalesced.size(), 2u);
+    EXPECT_EQ(coalesced[0].taskId, task);
+    EXPECT_EQ(coalesced[0].status, TaskStatus::InProgress);
+    EXPECT_EQ(coalesced[0].retryCount, 1);
+    EXPECT_EQ(coalesced[1].taskId, other);
+    EXPECT_EQ(coalesced[1].retryCount, -1);
+}
+
+TEST(WriteAheadLogTest, RecoversSyncedRecordsTruncatesTornTailAndCheckpoints) {
+    char directory[] = "/tmp/wal_test_XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    WalOptions options;
+    options.directory = directory;
+    options.segmentBytes = 64;  // records 1-2 fill the first segment, 3 starts the next
+    std::string big(60, 'b');
+    {
+        WriteAheadLog wal(options);
+        EXPECT_EQ(wal.recover([](WriteAheadLog::Lsn, std::string_view) { FAIL(); }), 0u);
+        wal.start();
+        wal.append(1, "first");
+        ASSERT_TRUE(wal.waitDurable(1, std::chrono::seconds(5)));
+        wal.append(2, big);
+        ASSERT_TRUE(wal.waitDurable(2, std::chrono::seconds(5)));
+        wal.append(3, "third");
+        wal.stop();
+        EXPECT_EQ(wal.durableLsn(), 3u);
+        EXPECT_EQ(wal.segmentCount(), 2u);
+    }
+
+    // A crash mid-write leaves half a record at the end of the last segment
+    char last[64];
+    std::snprintf(last, sizeof(last), "%s/wal-%016llx.log", directory, 3ULL);
+    int fd = open(last, O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, "\x20\0\0\0torn", 8), 8);
+    close(fd);
+
+    for (int pass = 0; pass < 2; ++pass) {
+        WriteAheadLog wal(options);
+        std::vector<std::pair<WriteAheadLog::Lsn, std::string>> replayed;
+        EXPECT_EQ(wal.recover([&](WriteAheadLog::Lsn lsn, std::string_view payload) {
+            replayed.emplace_back(lsn, std::string(payload));
+        }), 3u);
+        ASSERT_EQ(replayed.size(), 3u);
+        EXPECT_EQ(replayed[0], std::make_pair(WriteAheadLog::Lsn(1), std::string("first")));
+        EXPECT_EQ(replayed[1].second, big);
+        EXPECT_EQ(replayed[2], std::make_pair(WriteAheadLog::Lsn(3), std::string("third")));
+
+        if (pass == 1) {
+            wal.checkpoint(1);
+            EXPECT_EQ(wal.segmentCount(), 2u);
+            wal.checkpoint(2);
+            EXPECT_EQ(wal.segmentCount(), 1u);
+            // A fully applied open segment is closed by the next write and
+            // deleted by the checkpoint after it
+            wal.checkpoint(3);
+            EXPECT_EQ(wal.segmentCount(), 1u);
+            wal.start();
+            wal.append(4, "fourth");
+            ASSERT_TRUE(wal.waitDurable(4, std::chrono::seconds(5)));
+            EXPECT_EQ(wal.segmentCount(), 2u);
+            wal.checkpoint(3);
+            EXPECT_EQ(wal.segmentCount(), 1u);
+        }
+    }
+
+    {
+        WriteAheadLog wal(options);
+        size_t records = 0;
+        EXPECT_EQ(wal.recover([&](WriteAheadLog::Lsn, std::string_view) { ++records; }), 4u);
+        EXPECT_EQ(records, 1u);
+        // Stopping with everything applied leaves nothing to replay
+        wal.checkpoint(4);
+        wal.stop();
+        EXPECT_EQ(wal.segmentCount(), 0u);
+    }
+    WriteAheadLog wal(options);
+    EXPECT_EQ(wal.recover([](WriteAheadLog::Lsn, std::string_view) { FAIL(); }), 0u);
+
+    std::string cleanup = std::string("rm -rf ") + directory;
+    EXPECT_EQ(std::system(cleanup.c_str()), 0);
+}
+
+TEST(LockStatsTest, TimedLockRecordsHoldTime) {
+    std::mutex mutex;
+    LockStats stats;
+    {
+        TimedLock lock(mutex, stats);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    { TimedLock lock(mutex, stats); }
+
+    LockStatsSnapshot snapshot = stats.snapshot();
+    EXPECT_EQ(snapshot.acquisitions, 2u);
+    EXPECT_GE(snapshot.maxHoldNs, 2000000u);
+    EXPECT_LE(snapshot.maxHoldNs, snapshot.totalHoldNs);
+}
+
+TEST(DbMetricsTest, PercentilesFallInPowerOfTwoBuckets) {
+    LatencyStats stats;
+    for (int i = 0; i < 98; ++i) {
+        stats.record(1500);  // bucket [1024, 2048)
+    }
+    stats.record(1000000);
+    stats.record(3000000);
+    LatencySnapshot s = stats.snapshot();
+    EXPECT_EQ(s.count, 100u);
+    EXPECT_EQ(s.maxNs, 3000000u);
+    EXPECT_EQ(s.percentileNs(0.5), 2047u);
+    EXPECT_EQ(s.percentileNs(0.99), 1048575u);
+    EXPECT_EQ(s.percentileNs(1.0), 3000000u);  // capped at the maximum
+
+    DbMetrics metrics;
+    metrics.query(DbQuery::PersistBatch).record(5000);
+    std::string report = metrics.report();
+    EXPECT_NE(report.find("persist_batch"), std::string::npos);
+    EXPECT_EQ(report.find("get_task"), std::string::npos);  // no samples, no line
+}
+
+TEST(MpmcRingTest, ConcurrentProducersAndConsumersSeeEveryItem) {
+    MpmcRing<int> ring(64);
+    const int perProducer = 5000;
+    std::atomic<long long> sum{0};
+    std::atomic<int> popped{0};
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < 2; ++p) {
+        threads.emplace_back([&] {
+            for (int i = 1; i <= perProducer; ++i) {
+                int value = i;
+                while (!ring.tryPush(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&] {
+            while (popped.load() < 2 * perProducer) {
+                if (auto value = ring.tryPop()) {
+                    sum += *value;
+                    ++popped;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(sum.load(), 2LL * perProducer * (perProducer + 1) / 2);
+    EXPECT_FALSE(ring.tryPop());
+}
+
+TEST(ReadyQueueTest, RingBackendWakesBlockedConsumerAndSpillsWhenFull) {
+    QueueOptions options;
+    options.backend = QueueBackend::LockFreeRing;
+    options.ringCapacity = 2;
+    auto queue = ReadyQueue::create(options);
+
+    std::thread consumer([&] { EXPECT_EQ(queue->pop().getName(), "first"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue->push(Task("first", "data"));
+    consumer.join();
+
+    for (int i = 0; i < 5; ++i) {
+        queue->push(Task("task", std::to_string(i)));
+    }
+    int drained = 0;
+    while (queue->tryPop()) {
+        ++drained;
+    }
+    EXPECT_EQ(drained, 5);
+    EXPECT_TRUE(queue->empty());
+}
+
+TEST(ServerConfigTest, ParsesShardsAndRejectsBadValues) {
+    char prog[] = "server", shards[] = "--shards", four[] = "4", port[] = "--port", bad[] = "x";
+    char* valid[] = {prog, shards, four};
+    ServerConfig config = ServerConfig::fromArgs(3, valid);
+    EXPECT_EQ(config.effectiveShards(), 4u);
+    EXPECT_EQ(config.port, 8080);
+
+    char* invalid[] = {prog, port, bad};
+    EXPECT_THROW(ServerConfig::fromArgs(3, invalid), std::invalid_argument);
+    char* missing[] = {prog, shards};
+    EXPECT_THROW(ServerConfig::fromArgs(2, missing), std::invalid_argument);
+}
+
+TEST(ServerConfigTest, ParsesClusterOptions) {
+    char prog[] = "server", cluster[] = "--cluster", batch[] = "--claim-batch", sixtyFour[] = "64",
+         ownership[] = "--claim-ownership", tooShort[] = "10";
+    char* defaults[] = {prog};
+    EXPECT_FALSE(ServerConfig::fromArgs(1, defaults).cluster);
+
+    char* valid[] = {prog, cluster, batch, sixtyFour};
+    ServerConfig config = ServerConfig::fromArgs(4, valid);
+    EXPECT_TRUE(config.cluster);
+    EXPECT_EQ(config.claimBatch, 64);
+    EXPECT_EQ(config.claimOwnershipMs, 30000);
+
+    char* invalid[] = {prog, cluster, ownership, tooShort};
+    EXPECT_THROW(ServerConfig::fromArgs(4, invalid), std::invalid_argument);
+}
+
+TEST(BlockingExecutorTest, StrandRunsJobsInPostingOrder) {
+    BlockingExecutor executor(4);
+    auto strand = executor.makeStrand();
+    std::vector<int> seen;
+    std::atomic<int> running(0);
+    std::atomic<bool> overlapped(false);
+    for (int i = 0; i < 200; ++i) {
+        strand->post([&, i] {
+            if (running.fetch_add(1) != 0) {
+                overlapped = true;
+            }
+            seen.push_back(i);
+            running.fetch_sub(1);
+        });
+    }
+    executor.stop();
+
+    EXPECT_FALSE(overlapped);
+    ASSERT_EQ(seen.size(), 200u);
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(seen[i], i);
+    }
+}
+
+TEST(IoLoopTest, DeliversBytesThenReportsClose) {
+    struct Recorder : IoHandler {
+        std::string& received;
+        bool& closed;
+        Recorder(std::string& r, bool& c) : received(r), closed(c) {}
+        bool onData(const char* data, size_t size) override {
+            received.append(data, size);
+            return true;
+        }
+        void onClose() override { closed = true; }
+    };
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::string received;
+    bool closed = false;
+    auto loop = IoLoop::create(IoBackend::IoUring);  // epoll where unavailable
+    loop->add(fds[0], std::make_unique<Recorder>(received, closed));
+
+    ASSERT_EQ(write(fds[1], "hello", 5), 5);
+    for (int i = 0; i < 100 && received.size() < 5; ++i) {
+        loop->runOnce(10);
+    }
+    EXPECT_EQ(received, "hello");
+
+    close(fds[1]);
+    for (int i = 0; i < 100 && !closed; ++i) {
+        loop->runOnce(10);
+    }
+    EXPECT_TRUE(closed);
+    close(fds[0]);
+}
+
+TEST(WorkerSelectorTest, LeastLoadedPicksLowestScoreAfterUpdates) {
+    auto selector = WorkerSelector::create(SelectionPolicy::LeastLoaded);
+    auto& generator = Poco::UUIDGenerator::defaultGenerator();
+    Poco::UUID a = generator.createRandom(), b = generator.createRandom();
+    selector->update(a, 0.2, 1);
+    selector->update(b, 0.5, 1);
+    EXPECT_EQ(*selector->pick(), a);
+
+    selector->update(a, 0.9, 1);
+    EXPECT_EQ(*selector->pick(), b);
+    selector->remove(b);
+    EXPECT_EQ(*selector->pick(), a);
+    selector->remove(a);
+    EXPECT_FALSE(selector->pick());
+}
+
+TEST(WorkerSelectorTest, WeightedRoundRobinFollowsWeights) {
+    auto selector = WorkerSelector::create(SelectionPolicy::WeightedRoundRobin);
+    auto& generator = Poco::UUIDGenerator::defaultGenerator();
+    Poco::UUID heavy = generator.createRandom(), light = generator.createRandom();
+    selector->update(heavy, 0.0, 3);
+    selector->update(light, 0.0, 1);
+
+    int heavyPicks = 0;
+    for (int i = 0; i < 400; ++i) {
+        if (*selector->pick() == heavy) {
+            ++heavyPicks;
+        }
+    }
+    EXPECT_EQ(heavyPicks, 300);
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+namespace {
+    // Hands out one batch of claims, then nothing; remembers releases.
+    class FakeClaimStore : public ClaimStore {
+    public:
+        std::vector<Task> claimTasks(const Poco::UUID&, size_t limit, std::chrono::milliseconds) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<Task> batch;
+            for (size_t i = 0; i < limit && claimed.empty(); ++i) {
+                batch.emplace_back("claimed", std::to_string(i));
+            }
+            for (const Task& task : batch) {
+                claimed.push_back(task.getId());
+            }
+            return batch;
+        }
+        size_t renewClaims(const Poco::UUID&, std::chrono::milliseconds) override { return 0; }
+        size_t releaseClaims(const Poco::UUID&) override { return 0; }
+        size_t releaseTasks(const Poco::UUID&, const std::vector<Poco::UUID>& taskIds) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            released.insert(released.end(), taskIds.begin(), taskIds.end());
+            return taskIds.size();
+        }
+
+        std::mutex mutex;
+        std::vector<Poco::UUID> claimed;
+        std::vector<Poco::UUID> released;
+    };
+}
+
+TEST(TaskClaimerTest, ReleasesClaimsItFailedToPublish) {
+    FakeClaimStore store;
+    ClusterOptions options;
+    options.enabled = true;
+    options.claimBatch = 4;
+    options.pollInterval = std::chrono::milliseconds(5);
+    TaskClaimer claimer(store, options, Poco::UUIDGenerator::defaultGenerator().createRandom(),
+                        [] { return size_t(0); },
+                        [](std::vector<Task>&) { throw std::runtime_error("ready queue unavailable"); });
+    claimer.start();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(store.mutex);
+            if (!store.released.empty() || std::chrono::steady_clock::now() > deadline) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    claimer.stop();
+
+    EXPECT_EQ(claimer.claimed(), 4u);
+    EXPECT_EQ(store.claimed.size(), 4u);
+    EXPECT_EQ(store.released, store.claimed);
+}